@@ -0,0 +1,37 @@
+#!/bin/bash
+# PortCatcher 分类性能测试脚本
+# 用法: ./bench.sh [规则文件或快照路径] [bench 选项...]
+#   例: ./bench.sh src/ACL_rules/acl_100k.rules --packets 200000 --zipf 1.0 --algos tcam,lrme
+
+# 颜色定义
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m' # No Color
+
+echo -e "${GREEN}=== PortCatcher Bench 构建与运行脚本 ===${NC}\n"
+
+# 编译 bench（开启优化）
+echo -e "${YELLOW}[1] 编译 bench...${NC}"
+g++ -std=c++11 -pthread -O2 -o bench src/Bench.cpp src/Loader.cpp src/Function.cpp src/Classifier.cpp src/IPIndex.cpp src/Trace.cpp src/DecisionTree.cpp src/TupleSpace.cpp
+
+if [ $? -ne 0 ]; then
+    echo -e "${RED}[错误] 编译失败！${NC}"
+    exit 1
+fi
+
+echo -e "${GREEN}[成功] 编译完成${NC}\n"
+
+# 运行 bench，参数原样透传
+echo -e "${YELLOW}[2] 运行 bench...${NC}\n"
+./bench "$@"
+
+exit_code=$?
+echo ""
+if [ $exit_code -eq 0 ]; then
+    echo -e "${GREEN}[成功] bench 运行完成${NC}"
+else
+    echo -e "${RED}[错误] bench 运行失败 (退出码: $exit_code)${NC}"
+fi
+
+exit $exit_code
@@ -0,0 +1,37 @@
+#!/bin/bash
+# PortCatcher 差分正确性检查脚本
+# 用法: ./diffcheck.sh [规则文件或快照路径] [diffcheck 选项...]
+#   例: ./diffcheck.sh src/ACL_rules/acl_100k.rules --random 2000000 --boundary 2000000 --dump output/diff
+
+# 颜色定义
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m' # No Color
+
+echo -e "${GREEN}=== PortCatcher DiffCheck 构建与运行脚本 ===${NC}\n"
+
+# 编译 diffcheck（开启优化）
+echo -e "${YELLOW}[1] 编译 diffcheck...${NC}"
+g++ -std=c++11 -pthread -O2 -o diffcheck src/DiffCheck.cpp src/Loader.cpp src/Function.cpp src/Classifier.cpp src/IPIndex.cpp src/Trace.cpp src/Checker.cpp src/DecisionTree.cpp src/TupleSpace.cpp src/Incremental.cpp src/RangeEncoding.cpp src/TCAMMinimize.cpp
+
+if [ $? -ne 0 ]; then
+    echo -e "${RED}[错误] 编译失败！${NC}"
+    exit 1
+fi
+
+echo -e "${GREEN}[成功] 编译完成${NC}\n"
+
+# 运行 diffcheck，参数原样透传；存在不一致时退出码为 2
+echo -e "${YELLOW}[2] 运行 diffcheck...${NC}\n"
+./diffcheck "$@"
+
+exit_code=$?
+echo ""
+if [ $exit_code -eq 0 ]; then
+    echo -e "${GREEN}[成功] diffcheck 通过${NC}"
+else
+    echo -e "${RED}[错误] diffcheck 失败 (退出码: $exit_code)${NC}"
+fi
+
+exit $exit_code
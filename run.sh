@@ -1,6 +1,6 @@
 #!/bin/bash
 # PortCatcher 运行脚本
-# 用法: ./run.sh [规则文件路径]
+# 用法: ./run.sh [规则文件或快照路径]
 
 # 颜色定义
 GREEN='\033[0;32m'
@@ -12,7 +12,7 @@ echo -e "${GREEN}=== PortCatcher 构建与运行脚本 ===${NC}\n"
 
 # 编译项目
 echo -e "${YELLOW}[1] 编译项目...${NC}"
-g++ -std=c++11 -o portcatcher src/PortCatcher.cpp src/Loader.cpp src/Function.cpp
+g++ -std=c++11 -pthread -o portcatcher src/PortCatcher.cpp src/Loader.cpp src/Function.cpp src/Classifier.cpp src/IPIndex.cpp src/Trace.cpp src/Incremental.cpp src/RangeEncoding.cpp src/TCAMMinimize.cpp src/TableExport.cpp
 
 if [ $? -ne 0 ]; then
     echo -e "${RED}[错误] 编译失败！${NC}"
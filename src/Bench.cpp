@@ -0,0 +1,504 @@
+/** *************************************************************/
+// @Name: Bench.cpp
+// @Function: Classification throughput / latency benchmark over synthetic traces
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "Classifier.hpp"
+#include "Trace.hpp"
+#include "IPIndex.hpp"
+#include "DecisionTree.hpp"
+#include "TupleSpace.hpp"
+
+using namespace std;
+
+struct BenchOptions {
+    string rules_path = "src/ACL_rules/acl_10k.rules";
+    string trace_in;
+    string trace_out;
+    string algos = "linear,simd,tcam,lrme,lrme-batch,rfc,hicuts,hypercuts,tss";
+    SimdLevel simd_level = SIMD_AVX512;
+    bool ip_poptrie = true;     // LRME 的 IP 阶段：poptrie（超预算时自动退回）或区间索引
+    TraceConfig trace;
+    unsigned threads = 1;
+    int rounds = 1;
+    size_t latency_samples = 10000;
+    size_t batch = 64;
+    CutTreeConfig cut_tree;     // hicuts / hypercuts 的 binth 与 spfac
+};
+
+struct BenchRow {
+    string name;
+    size_t entries;
+    double build_ms;
+    size_t memory_bytes;
+    double mpps;
+    double p50_ns, p99_ns;
+    size_t hits;
+};
+
+static void print_usage() {
+    cout << "usage: bench [rules_or_snapshot]\n"
+         << "             [--packets N] [--hit-ratio F] [--zipf S] [--locality P] [--window W] [--seed N]\n"
+         << "             [--trace-in FILE] [--trace-out FILE]\n"
+         << "             [--algos linear,simd,tcam,lrme,lrme-batch,rfc,hicuts,hypercuts,tss,\n"
+         << "                      ip-linear,ip-index,ip-poptrie]\n"
+         << "             [--simd-level scalar|avx2|avx512] [--ip-stage auto|segtree]\n"
+         << "             [--binth N] [--spfac F]\n"
+         << "             [--batch N] [--threads N] [--rounds N] [--latency-samples N]\n";
+}
+
+static bool parse_args(int argc, char **argv, BenchOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_val = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "--packets" && has_val) {
+            opt.trace.packets = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--hit-ratio" && has_val) {
+            opt.trace.hit_ratio = atof(argv[++i]);
+        } else if (arg == "--zipf" && has_val) {
+            opt.trace.zipf_s = atof(argv[++i]);
+        } else if (arg == "--locality" && has_val) {
+            opt.trace.locality = atof(argv[++i]);
+        } else if (arg == "--window" && has_val) {
+            opt.trace.locality_window = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && has_val) {
+            opt.trace.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--trace-in" && has_val) {
+            opt.trace_in = argv[++i];
+        } else if (arg == "--trace-out" && has_val) {
+            opt.trace_out = argv[++i];
+        } else if (arg == "--algos" && has_val) {
+            opt.algos = argv[++i];
+        } else if (arg == "--simd-level" && has_val) {
+            string lv = argv[++i];
+            if (lv == "scalar") {
+                opt.simd_level = SIMD_SCALAR;
+            } else if (lv == "avx2") {
+                opt.simd_level = SIMD_AVX2;
+            } else if (lv == "avx512") {
+                opt.simd_level = SIMD_AVX512;
+            } else {
+                cerr << "[ERROR] Unknown SIMD level: " << lv << endl;
+                return false;
+            }
+        } else if (arg == "--ip-stage" && has_val) {
+            string st = argv[++i];
+            if (st == "auto") {
+                opt.ip_poptrie = true;
+            } else if (st == "segtree") {
+                opt.ip_poptrie = false;
+            } else {
+                cerr << "[ERROR] Unknown IP stage: " << st << endl;
+                return false;
+            }
+        } else if (arg == "--binth" && has_val) {
+            opt.cut_tree.binth = std::max<uint32_t>(1, static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)));
+        } else if (arg == "--spfac" && has_val) {
+            opt.cut_tree.spfac = atof(argv[++i]);
+        } else if (arg == "--batch" && has_val) {
+            opt.batch = std::max<size_t>(1, strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--threads" && has_val) {
+            opt.threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--rounds" && has_val) {
+            opt.rounds = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--latency-samples" && has_val) {
+            opt.latency_samples = strtoull(argv[++i], nullptr, 10);
+        } else if (!arg.empty() && arg[0] == '-') {
+            cerr << "[ERROR] Unknown option: " << arg << endl;
+            return false;
+        } else {
+            opt.rules_path = arg;
+        }
+    }
+    return true;
+}
+
+// 仅 IP 阶段：每条规则的 (src, dst, proto) 作为一个 IP_Table_Entry，返回下标最小的命中
+// （action 取对应规则的 action，吞吐测试按 action 累加，避免查询被优化掉）
+static vector<IP_Table_Entry> rules_to_ip_entries(const vector<Rule5D>& rules) {
+    vector<IP_Table_Entry> entries(rules.size());
+    for (size_t i = 0; i < rules.size(); ++i) {
+        IP_Table_Entry& e = entries[i];
+        memset(&e, 0, sizeof(e));
+        e.Src_IP_lo = rules[i].range[0][0];
+        e.Src_IP_hi = rules[i].range[0][1];
+        e.Dst_IP_lo = rules[i].range[1][0];
+        e.Dst_IP_hi = rules[i].range[1][1];
+        e.Proto = rules[i].range[4][0] == rules[i].range[4][1] ? (uint8_t)rules[i].range[4][0] : 0;
+    }
+    return entries;
+}
+
+struct IPLinearStage {
+    vector<IP_Table_Entry> entries;
+    vector<uint16_t> actions;
+    MatchResult classify(const Tuple5& t) const {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const IP_Table_Entry& e = entries[i];
+            if (t.src_ip < e.Src_IP_lo || t.src_ip > e.Src_IP_hi) continue;
+            if (t.dst_ip < e.Dst_IP_lo || t.dst_ip > e.Dst_IP_hi) continue;
+            if (e.Proto != 0 && e.Proto != t.proto) continue;
+            MatchResult m = { static_cast<uint32_t>(i), actions[i] };
+            return m;
+        }
+        MatchResult miss = { NO_MATCH_RULE, 0 };
+        return miss;
+    }
+    size_t memory_bytes() const {
+        return entries.capacity() * sizeof(IP_Table_Entry) + actions.capacity() * sizeof(uint16_t);
+    }
+};
+
+struct IPIndexStage {
+    IPRangeIndex index;
+    vector<uint16_t> actions;
+    MatchResult classify(const Tuple5& t) const {
+        uint32_t id = index.query_first(t.src_ip, t.dst_ip, t.proto);
+        MatchResult m = { id, id == IPRangeIndex::NOT_FOUND ? (uint16_t)0 : actions[id] };  // NOT_FOUND == NO_MATCH_RULE
+        return m;
+    }
+    size_t memory_bytes() const { return index.memory_bytes() + actions.capacity() * sizeof(uint16_t); }
+};
+
+struct IPPoptrieStage {
+    PoptrieIPIndex index;
+    vector<uint16_t> actions;
+    MatchResult classify(const Tuple5& t) const {
+        uint32_t id = index.query_first(t.src_ip, t.dst_ip, t.proto);
+        MatchResult m = { id, id == IPRangeIndex::NOT_FOUND ? (uint16_t)0 : actions[id] };
+        return m;
+    }
+    size_t memory_bytes() const { return index.memory_bytes() + actions.capacity() * sizeof(uint16_t); }
+};
+
+static bool algo_enabled(const BenchOptions& opt, const string& name) {
+    string list = "," + opt.algos + ",";
+    return list.find("," + name + ",") != string::npos;
+}
+
+// 单次查找延迟：每 LATENCY_GROUP 次查找只读两次时钟，避免 steady_clock::now() 的开销淹没查找本身；
+// 每组耗时先减去空组（同样两次读时钟、不做查找）的中位数，再除以组大小，
+// 对前 samples 个包得到的各组均摊值取 p50 / p99
+static const size_t LATENCY_GROUP = 16;
+
+static double clock_overhead_ns() {
+    const size_t rounds = 1000;
+    vector<double> ns(rounds);
+    for (size_t i = 0; i < rounds; ++i) {
+        auto t0 = chrono::steady_clock::now();
+        auto t1 = chrono::steady_clock::now();
+        ns[i] = chrono::duration<double, nano>(t1 - t0).count();
+    }
+    sort(ns.begin(), ns.end());
+    return ns[rounds / 2];
+}
+
+template <typename Classifier>
+static void measure_latency(const Classifier& c, const vector<Tuple5>& trace, size_t samples,
+                            double& p50, double& p99) {
+    p50 = p99 = 0;
+    size_t n = std::min(samples, trace.size());
+    if (n == 0) return;
+    double overhead = clock_overhead_ns();
+    vector<double> ns;
+    ns.reserve(n / LATENCY_GROUP + 1);
+    volatile uint32_t sink = 0;
+    for (size_t i = 0; i < n; i += LATENCY_GROUP) {
+        size_t g = std::min(LATENCY_GROUP, n - i);
+        uint32_t acc = 0;
+        auto t0 = chrono::steady_clock::now();
+        for (size_t k = 0; k < g; ++k) acc += c.classify(trace[i + k]).rule_id;
+        auto t1 = chrono::steady_clock::now();
+        sink = sink + acc;
+        double t = chrono::duration<double, nano>(t1 - t0).count() - overhead;
+        ns.push_back(std::max(0.0, t) / g);
+    }
+    sort(ns.begin(), ns.end());
+    p50 = ns[ns.size() / 2];
+    p99 = ns[std::min(ns.size() - 1, ns.size() * 99 / 100)];
+}
+
+template <typename Classifier>
+static BenchRow run_classifier(const string& name, const Classifier& c, size_t entries, double build_ms,
+                               const vector<Tuple5>& trace, const BenchOptions& opt) {
+    BenchRow row;
+    row.name = name;
+    row.entries = entries;
+    row.build_ms = build_ms;
+    row.memory_bytes = c.memory_bytes();
+    row.mpps = measure_lookup_rate(c, trace, opt.threads, opt.rounds) / 1e6;
+    measure_latency(c, trace, opt.latency_samples, row.p50_ns, row.p99_ns);
+    row.hits = 0;
+    for (const auto& t : trace) {
+        if (c.classify(t).rule_id != NO_MATCH_RULE) row.hits++;
+    }
+    cout << "[bench] " << name << " done\n";
+    return row;
+}
+
+// 批量接口：延迟按整批计时再除以批大小（每包均摊）；
+// 同时核对批量结果与逐包 classify 完全一致
+template <typename Classifier>
+static BenchRow run_batch_classifier(const string& name, const Classifier& c, size_t entries, double build_ms,
+                                     const vector<Tuple5>& trace, const BenchOptions& opt) {
+    BenchRow row;
+    row.name = name;
+    row.entries = entries;
+    row.build_ms = build_ms;
+    row.memory_bytes = c.memory_bytes();
+    row.mpps = measure_batch_rate(c, trace, opt.batch, opt.threads, opt.rounds) / 1e6;
+
+    vector<uint16_t> actions(opt.batch);
+    vector<uint32_t> rule_ids(opt.batch);
+    vector<double> ns;
+    size_t mismatches = 0;
+    row.hits = 0;
+    for (size_t i = 0; i < trace.size(); i += opt.batch) {
+        size_t n = std::min(opt.batch, trace.size() - i);
+        auto t0 = chrono::steady_clock::now();
+        c.classify_batch(trace.data() + i, n, actions.data(), rule_ids.data());
+        auto t1 = chrono::steady_clock::now();
+        if (i < opt.latency_samples) {
+            ns.push_back(chrono::duration<double, nano>(t1 - t0).count() / n);
+        }
+        for (size_t k = 0; k < n; ++k) {
+            MatchResult m = c.classify(trace[i + k]);
+            if (m.rule_id != rule_ids[k] || m.action != actions[k]) mismatches++;
+            if (rule_ids[k] != NO_MATCH_RULE) row.hits++;
+        }
+    }
+    if (mismatches) {
+        cerr << "[WARN] " << name << ": " << mismatches << " packets differ from per-packet classify" << endl;
+    }
+    sort(ns.begin(), ns.end());
+    row.p50_ns = ns.empty() ? 0 : ns[ns.size() / 2];
+    row.p99_ns = ns.empty() ? 0 : ns[std::min(ns.size() - 1, ns.size() * 99 / 100)];
+    cout << "[bench] " << name << " done\n";
+    return row;
+}
+
+static double elapsed_ms(chrono::steady_clock::time_point t0) {
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions opt;
+    if (!parse_args(argc, argv, opt)) {
+        print_usage();
+        return 1;
+    }
+
+    cout << "============================================================================\n";
+    cout << "----------------------------PortCatcher Bench-------------------------------\n";
+    cout << "============================================================================\n\n";
+
+    vector<Rule5D> rules;
+    try {
+        load_rules(opt.rules_path, rules);
+    } catch (const std::exception &e) {
+        cerr << "[ERROR] Failed to load rules: " << e.what() << endl;
+        return 1;
+    }
+    cout << "[SUCCESS] Loaded " << rules.size() << " rules from " << opt.rules_path << "\n";
+
+    vector<Tuple5> trace;
+    if (!opt.trace_in.empty()) {
+        try {
+            load_trace(opt.trace_in, trace);
+        } catch (const std::exception &e) {
+            cerr << "[ERROR] Failed to load trace: " << e.what() << endl;
+            return 1;
+        }
+        cout << "[SUCCESS] Loaded " << trace.size() << " packets from " << opt.trace_in << "\n";
+    } else {
+        trace = generate_trace(rules, opt.trace);
+        cout << "[SUCCESS] Generated " << trace.size() << " packets (hit-ratio " << opt.trace.hit_ratio
+             << ", zipf " << opt.trace.zipf_s << ", locality " << opt.trace.locality << ")\n";
+    }
+    if (!opt.trace_out.empty() && save_trace(trace, opt.trace_out)) {
+        cout << "[SUCCESS] Trace written to: " << opt.trace_out << "\n";
+    }
+    cout << "\n";
+
+    vector<BenchRow> rows;
+
+    if (algo_enabled(opt, "linear")) {
+        auto t0 = chrono::steady_clock::now();
+        LinearScanClassifier c;
+        c.build(rules);
+        rows.push_back(run_classifier("linear", c, c.entries(), elapsed_ms(t0), trace, opt));
+    }
+
+    if (algo_enabled(opt, "simd")) {
+        auto t0 = chrono::steady_clock::now();
+        SimdLinearClassifier c;
+        c.build(rules, opt.simd_level);
+        string name = string("simd/") + simd_level_name(c.level());
+        rows.push_back(run_classifier(name, c, c.entries(), elapsed_ms(t0), trace, opt));
+    }
+
+    if (algo_enabled(opt, "tcam")) {
+        auto t0 = chrono::steady_clock::now();
+        vector<TCAM_Entry> tcam_entries;
+        TCAM_Port_Expansion(rules, tcam_entries);
+        TCAMClassifier c;
+        c.build(tcam_entries);
+        rows.push_back(run_classifier("tcam", c, c.entries(), elapsed_ms(t0), trace, opt));
+    }
+
+    const char* const cut_algos[] = { "hicuts", "hypercuts" };
+    for (int k = 0; k < 2; ++k) {
+        if (!algo_enabled(opt, cut_algos[k])) continue;
+        auto t0 = chrono::steady_clock::now();
+        CutTreeConfig cfg = opt.cut_tree;
+        cfg.multi_dim = k == 1;
+        CutTreeClassifier c;
+        c.build(rules, cfg);
+        rows.push_back(run_classifier(cut_algos[k], c, c.nodes(), elapsed_ms(t0), trace, opt));
+    }
+
+    if (algo_enabled(opt, "tss")) {
+        auto t0 = chrono::steady_clock::now();
+        TupleSpaceClassifier c;
+        c.build(rules);
+        double build_ms = elapsed_ms(t0);
+
+        // 更新速率：随机删除 10% 的规则再按原 rule_id 插回
+        vector<uint32_t> churn(rules.size());
+        for (size_t i = 0; i < churn.size(); ++i) churn[i] = static_cast<uint32_t>(i);
+        std::mt19937 rng(opt.trace.seed);
+        std::shuffle(churn.begin(), churn.end(), rng);
+        churn.resize(std::max<size_t>(1, rules.size() / 10));
+        auto t1 = chrono::steady_clock::now();
+        for (uint32_t id : churn) c.erase(id);
+        double erase_ms = elapsed_ms(t1);
+        auto t2 = chrono::steady_clock::now();
+        for (uint32_t id : churn) c.insert(id, rules[id]);
+        double insert_ms = elapsed_ms(t2);
+        cout << "[TupleSpaceClassifier] " << c.tuples() << " tuples; " << churn.size() << " updates: erase "
+             << fixed << setprecision(2) << churn.size() / (erase_ms * 1e3) << " Mops/s, insert "
+             << churn.size() / (insert_ms * 1e3) << " Mops/s\n";
+        cout.unsetf(ios::fixed);
+        rows.push_back(run_classifier("tss", c, c.entries(), build_ms, trace, opt));
+    }
+
+    // lrme / rfc 共用 IP 表与 metainfo，构建时间都包含这段流水
+    bool want_lrme = algo_enabled(opt, "lrme") || algo_enabled(opt, "lrme-batch");
+    if (want_lrme || algo_enabled(opt, "rfc")) {
+        auto t0 = chrono::steady_clock::now();
+        vector<IPRule> ip_table;
+        vector<PortRule> port_table;
+        split_rules(rules, ip_table, port_table);
+        vector<MergrdR> merged_ip_table;
+        MergedItemTable metainfo;
+        load_and_create_IP_table(ip_table, port_table, merged_ip_table, metainfo);
+        vector<LRME_Entry> lrme_entries;
+        PortBlockTable optimal_metainfo = Caculate_LRME_for_Port_Table(metainfo, false, &lrme_entries);
+        vector<IP_Table_Entry> final_ip_table;
+        create_final_IP_table(merged_ip_table, optimal_metainfo, final_ip_table);
+        double pipeline_ms = elapsed_ms(t0);
+
+        if (want_lrme) {
+            auto t1 = chrono::steady_clock::now();
+            LRMEClassifier c;
+            c.build(merged_ip_table, final_ip_table, lrme_entries, optimal_metainfo, opt.ip_poptrie);
+            double build_ms = pipeline_ms + elapsed_ms(t1);
+            if (algo_enabled(opt, "lrme")) {
+                rows.push_back(run_classifier("lrme", c, c.ip_entries() + c.lrme_records(), build_ms, trace, opt));
+            }
+            if (algo_enabled(opt, "lrme-batch")) {
+                string name = "lrme-batch" + to_string(opt.batch);
+                rows.push_back(run_batch_classifier(name, c, c.ip_entries() + c.lrme_records(), build_ms, trace, opt));
+            }
+        }
+
+        if (algo_enabled(opt, "rfc")) {
+            auto t1 = chrono::steady_clock::now();
+            RFCPortClassifier c;
+            if (c.build(merged_ip_table, final_ip_table, metainfo, opt.ip_poptrie)) {
+                double build_ms = pipeline_ms + elapsed_ms(t1);
+                rows.push_back(run_classifier("rfc", c, c.ip_entries() + c.cells(), build_ms, trace, opt));
+            } else {
+                cerr << "[WARN] rfc skipped: cross-product tables over budget\n";
+            }
+        }
+    }
+
+    if (algo_enabled(opt, "ip-linear")) {
+        auto t0 = chrono::steady_clock::now();
+        IPLinearStage c;
+        c.entries = rules_to_ip_entries(rules);
+        for (const auto& r : rules) c.actions.push_back(r.action);
+        rows.push_back(run_classifier("ip-linear", c, c.entries.size(), elapsed_ms(t0), trace, opt));
+    }
+
+    if (algo_enabled(opt, "ip-index")) {
+        vector<IP_Table_Entry> entries = rules_to_ip_entries(rules);
+        auto t0 = chrono::steady_clock::now();
+        IPIndexStage c;
+        c.index.build(entries);
+        for (const auto& r : rules) c.actions.push_back(r.action);
+        double build_ms = elapsed_ms(t0);
+        double per_100k = entries.empty() ? 0.0 : 100000.0 / entries.size();
+        cout << "[IPRangeIndex] " << entries.size() << " entries, " << c.index.segments() << " src segments, "
+             << c.index.stored_items() << " stored items; per 100k entries: "
+             << fixed << setprecision(1) << build_ms * per_100k << " ms build, "
+             << c.index.memory_bytes() * per_100k / (1024.0 * 1024.0) << " MB\n";
+        cout.unsetf(ios::fixed);
+        rows.push_back(run_classifier("ip-index", c, entries.size(), build_ms, trace, opt));
+    }
+
+    if (algo_enabled(opt, "ip-poptrie")) {
+        vector<IP_Table_Entry> entries = rules_to_ip_entries(rules);
+        auto t0 = chrono::steady_clock::now();
+        IPPoptrieStage c;
+        bool ok = c.index.build(entries);
+        for (const auto& r : rules) c.actions.push_back(r.action);
+        double build_ms = elapsed_ms(t0);
+        if (!ok) {
+            cerr << "[WARN] ip-poptrie skipped: " << c.index.src_classes() << " x " << c.index.dst_classes()
+                 << " classes exceed the cross-product budget of " << PoptrieIPIndex::DEFAULT_MAX_CELLS << " cells\n";
+        } else {
+            cout << "[PoptrieIPIndex] " << entries.size() << " entries, " << c.index.src_classes() << " x "
+                 << c.index.dst_classes() << " classes, " << c.index.lists() << " distinct lists, "
+                 << c.index.stored_items() << " stored items\n";
+            rows.push_back(run_classifier("ip-poptrie", c, entries.size(), build_ms, trace, opt));
+        }
+    }
+
+    cout << "\n============================================================================\n";
+    cout << "Rules: " << rules.size() << ", packets: " << trace.size()
+         << ", threads: " << opt.threads << ", rounds: " << opt.rounds << "\n";
+    cout << "(p50/p99: per-lookup time averaged over groups of " << LATENCY_GROUP
+         << " lookups, minus the clock-read overhead)\n";
+    if (algo_enabled(opt, "lrme-batch")) {
+        cout << "(batch rows: p50/p99 are per-batch time divided by batch size)\n";
+    }
+    cout << left << setw(14) << "Algo" << right
+         << setw(12) << "Entries" << setw(12) << "Build(ms)" << setw(12) << "Mem(KB)"
+         << setw(10) << "Mpps" << setw(10) << "p50(ns)" << setw(10) << "p99(ns)" << setw(9) << "Hit%" << "\n";
+    cout << string(89, '-') << "\n";
+    cout << fixed;
+    for (const auto& r : rows) {
+        cout << left << setw(14) << r.name << right
+             << setw(12) << r.entries
+             << setw(12) << setprecision(1) << r.build_ms
+             << setw(12) << r.memory_bytes / 1024
+             << setw(10) << setprecision(3) << r.mpps
+             << setw(10) << setprecision(0) << r.p50_ns
+             << setw(10) << r.p99_ns
+             << setw(9) << setprecision(2) << (trace.empty() ? 0.0 : 100.0 * r.hits / trace.size()) << "\n";
+    }
+    cout << "============================================================================\n";
+    return 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// ---------------Binary File Helpers---------------------
+// 规则快照 / trace / 表导出三种二进制文件共用的小端读写与 checksum。
+// 文件头均为 32 字节：magic[8], u32 version, u32 record_size, u64 count, u64 checksum
+
+inline void put_u16(unsigned char *p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+inline void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (unsigned char)(v >> (8 * i));
+}
+inline void put_u64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = (unsigned char)(v >> (8 * i));
+}
+inline uint16_t get_u16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+inline uint32_t get_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+inline uint64_t get_u64(const unsigned char *p) {
+    return (uint64_t)get_u32(p) | ((uint64_t)get_u32(p + 4) << 32);
+}
+
+// checksum = FNV-1a over the record area taken as 64-bit LE words (last word zero-padded).
+// 传入上一次的返回值可以分段累计，只要除最后一段外每段长度都是 8 的倍数，结果与一次算完相同
+static const uint64_t FNV1A64_OFFSET = 0xcbf29ce484222325ULL;
+
+inline uint64_t fnv1a64_words(const unsigned char *p, size_t n, uint64_t h = FNV1A64_OFFSET) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        h ^= get_u64(p + i);
+        h *= 0x100000001b3ULL;
+    }
+    if (i < n) {
+        unsigned char tail[8] = {0};
+        memcpy(tail, p + i, n - i);
+        h ^= get_u64(tail);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
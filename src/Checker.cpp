@@ -0,0 +1,259 @@
+/** *************************************************************/
+// @Name: Checker.cpp
+// @Function: Boundary-focused traces and differential check reporting
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "Classifier.hpp"
+#include "Checker.hpp"
+
+using namespace std;
+
+// 在 [0, max] 内的边界候选值，越界的丢弃
+static void push_edge(std::vector<uint32_t>& out, int64_t v, int64_t max) {
+    if (v >= 0 && v <= max) out.push_back(static_cast<uint32_t>(v));
+}
+
+static void ip_edges(uint32_t lo, uint32_t hi, std::vector<uint32_t>& out) {
+    out.clear();
+    push_edge(out, lo, 0xFFFFFFFFLL);
+    push_edge(out, hi, 0xFFFFFFFFLL);
+    push_edge(out, (int64_t)lo - 1, 0xFFFFFFFFLL);
+    push_edge(out, (int64_t)hi + 1, 0xFFFFFFFFLL);
+}
+
+static void port_edges(uint32_t lo, uint32_t hi, std::vector<uint32_t>& out) {
+    out.clear();
+    const int64_t vals[] = {
+        lo, hi, (int64_t)lo - 1, (int64_t)lo + 1, (int64_t)hi - 1, (int64_t)hi + 1,
+        1023, 1024,
+        lo & ~31u, lo | 31u, hi & ~31u, hi | 31u,
+        (int64_t)(lo & ~31u) - 1, (int64_t)(hi | 31u) + 1
+    };
+    for (int64_t v : vals) push_edge(out, v, 0xFFFF);
+}
+
+static void proto_edges(uint32_t lo, uint32_t hi, std::vector<uint32_t>& out) {
+    out.clear();
+    push_edge(out, lo, 0xFF);
+    push_edge(out, hi, 0xFF);
+    push_edge(out, (int64_t)lo - 1, 0xFF);
+    push_edge(out, (int64_t)hi + 1, 0xFF);
+}
+
+std::vector<Tuple5> generate_boundary_trace(
+    const std::vector<Rule5D>& rules,
+    size_t n,
+    uint32_t seed
+) {
+    std::vector<Tuple5> trace;
+    if (rules.empty()) return trace;
+    trace.reserve(n);
+    std::mt19937_64 rng(seed);
+    auto pick = [&](uint32_t lo, uint32_t hi) -> uint32_t {
+        uint64_t span = (uint64_t)hi - lo + 1;
+        return lo + static_cast<uint32_t>(rng() % span);
+    };
+
+    std::vector<uint32_t> edges;
+    for (size_t i = 0; i < n; ++i) {
+        const Rule5D& r = rules[rng() % rules.size()];
+        uint32_t v[5];
+        for (int d = 0; d < 5; ++d) {
+            uint32_t hi = d == 4 ? std::min<uint32_t>(r.range[4][1], 0xFF) : r.range[d][1];
+            v[d] = pick(r.range[d][0], hi);
+        }
+
+        int moves = 1 + static_cast<int>(rng() % 2);
+        for (int k = 0; k < moves; ++k) {
+            int d = static_cast<int>(rng() % 5);
+            if (d < 2) {
+                ip_edges(r.range[d][0], r.range[d][1], edges);
+            } else if (d < 4) {
+                port_edges(r.range[d][0], r.range[d][1], edges);
+            } else {
+                proto_edges(r.range[4][0], std::min<uint32_t>(r.range[4][1], 0xFF), edges);
+            }
+            if (!edges.empty()) v[d] = edges[rng() % edges.size()];
+        }
+
+        Tuple5 t;
+        t.src_ip = v[0];
+        t.dst_ip = v[1];
+        t.src_port = static_cast<uint16_t>(v[2]);
+        t.dst_port = static_cast<uint16_t>(v[3]);
+        t.proto = static_cast<uint8_t>(v[4]);
+        trace.push_back(t);
+    }
+    return trace;
+}
+
+static string tuple_to_string(const Tuple5& t) {
+    ostringstream oss;
+    oss << ip_to_string(t.src_ip) << " " << ip_to_string(t.dst_ip)
+        << " " << t.src_port << " " << t.dst_port << " 0x" << hex << setw(2) << setfill('0') << (int)t.proto;
+    return oss.str();
+}
+
+static string match_to_string(const MatchResult& m) {
+    if (m.rule_id == NO_MATCH_RULE) return "miss";
+    ostringstream oss;
+    oss << "R" << m.rule_id << "/0x" << hex << setw(4) << setfill('0') << m.action;
+    return oss.str();
+}
+
+static string rule_to_string(const Rule5D& r) {
+    ostringstream oss;
+    oss << ip_range_to_cidr(r.range[0][0], r.range[0][1]) << " "
+        << ip_range_to_cidr(r.range[1][0], r.range[1][1]) << " "
+        << r.range[2][0] << ":" << r.range[2][1] << " "
+        << r.range[3][0] << ":" << r.range[3][1] << " "
+        << r.range[4][0] << "-" << r.range[4][1] << " action 0x"
+        << hex << setw(4) << setfill('0') << r.action;
+    return oss.str();
+}
+
+void print_diff_report(
+    const std::string& name,
+    const DiffReport& report,
+    const std::vector<Rule5D>& rules,
+    size_t max_print
+) {
+    cout << "[" << name << "] checked " << report.checked
+         << ", rule-id mismatches " << report.rule_mismatch
+         << ", action mismatches " << report.action_mismatch << "\n";
+
+    size_t n = std::min(max_print, report.disagreements.size());
+    for (size_t i = 0; i < n; ++i) {
+        const Disagreement& d = report.disagreements[i];
+        cout << "  #" << d.index << " " << tuple_to_string(d.tuple)
+             << " : oracle " << match_to_string(d.expect)
+             << ", got " << match_to_string(d.got) << "\n";
+        if (d.expect.rule_id < rules.size()) {
+            cout << "      oracle rule: " << rule_to_string(rules[d.expect.rule_id]) << "\n";
+        }
+        if (d.got.rule_id < rules.size() && d.got.rule_id != d.expect.rule_id) {
+            cout << "      got rule:    " << rule_to_string(rules[d.got.rule_id]) << "\n";
+        }
+    }
+    if (report.disagreements.size() > n) {
+        cout << "  ... " << report.disagreements.size() - n << " more\n";
+    }
+}
+
+bool write_disagreements(
+    const DiffReport& report,
+    const std::string& output_file
+) {
+    std::ofstream ofs(output_file);
+    if (!ofs.is_open()) {
+        std::cerr << "[ERROR] Failed to open output file: " << output_file << std::endl;
+        return false;
+    }
+    ofs << "# index src_ip dst_ip src_port dst_port proto oracle got\n";
+    for (const auto& d : report.disagreements) {
+        ofs << d.index << " " << tuple_to_string(d.tuple) << " "
+            << match_to_string(d.expect) << " " << match_to_string(d.got) << "\n";
+    }
+    return true;
+}
+
+// 一个 (lo, hi) 的前缀覆盖是否正确且最少
+static bool verify_port_prefixes(uint32_t lo, uint32_t hi, const std::pair<uint16_t, uint16_t>* p, size_t n) {
+    if (n == 0 || n > MAX_PORT_PREFIXES) return false;
+    uint32_t next = lo;
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t size = (~(uint32_t)p[i].second & 0xFFFFu) + 1;
+        if ((size & (size - 1)) != 0) return false;                  // mask 必须是连续的高位 1
+        if (p[i].first != next || (p[i].first & (size - 1)) != 0) return false;
+        if (size < 65536 && (p[i].first & (2 * size - 1)) == 0 && p[i].first + 2 * size - 1 <= hi) {
+            return false;                                             // 还能翻倍，不是最大块
+        }
+        next += size;
+    }
+    return next == hi + 1;
+}
+
+PrefixCheckReport check_port_prefix_kernel(
+    size_t samples,
+    uint32_t seed,
+    unsigned threads
+) {
+    if (threads == 0) threads = 1;
+    std::vector<PrefixCheckReport> parts(threads);
+
+    auto check_one = [](uint32_t lo, uint32_t hi, PrefixCheckReport& rep) {
+        std::pair<uint16_t, uint16_t> buf[MAX_PORT_PREFIXES];
+        size_t n = port_range_to_prefixes(static_cast<uint16_t>(lo), static_cast<uint16_t>(hi), buf);
+        rep.checked++;
+        if (n > rep.max_prefixes) rep.max_prefixes = n;
+        if (!verify_port_prefixes(lo, hi, buf, n)) {
+            if (rep.failures == 0) {
+                rep.first_bad_lo = lo;
+                rep.first_bad_hi = hi;
+            }
+            rep.failures++;
+        }
+    };
+
+    auto worker = [&](unsigned tid) {
+        PrefixCheckReport& rep = parts[tid];
+        if (samples == 0) {
+            // 穷举：lo 交错分给各线程，使各线程的 (lo, hi) 对数大致相同
+            for (uint32_t lo = tid; lo < 65536; lo += threads) {
+                for (uint32_t hi = lo; hi < 65536; ++hi) check_one(lo, hi, rep);
+            }
+            return;
+        }
+        std::mt19937 rng(seed + tid);
+        const size_t strata = 17 * 17;
+        for (size_t s = tid; s < strata; s += threads) {
+            uint32_t span_bits = static_cast<uint32_t>(s / 17), align = static_cast<uint32_t>(s % 17);
+            size_t per = (samples + strata - 1) / strata;
+            for (size_t i = 0; i < per; ++i) {
+                uint32_t lo = align >= 16 ? 0 : ((((uint32_t)rng() << 1) | 1u) << align) & 0xFFFFu;
+                uint32_t span = span_bits == 0 ? 0 : ((1u << (span_bits - 1)) | (rng() & ((1u << (span_bits - 1)) - 1)));
+                uint32_t hi = std::min<uint32_t>(lo + span, 65535);
+                check_one(lo, hi, rep);
+            }
+        }
+        if (tid == 0) {
+            std::vector<uint32_t> edges = { 0, 1, 2, 31, 32, 33, 1023, 1024, 1025, 32767, 32768, 65534, 65535 };
+            for (uint32_t b = 2; b <= 16; ++b) {
+                push_edge(edges, (1 << b) - 1, 0xFFFF);
+                push_edge(edges, (1 << b) + 1, 0xFFFF);
+            }
+            for (uint32_t lo : edges) {
+                for (uint32_t hi : edges) {
+                    if (lo <= hi) check_one(lo, hi, rep);
+                }
+            }
+        }
+    };
+
+    if (threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+        for (auto& th : pool) th.join();
+    }
+
+    PrefixCheckReport total;
+    for (const auto& p : parts) {
+        if (p.failures && total.failures == 0) {
+            total.first_bad_lo = p.first_bad_lo;
+            total.first_bad_hi = p.first_bad_hi;
+        }
+        total.checked += p.checked;
+        total.failures += p.failures;
+        total.max_prefixes = std::max(total.max_prefixes, p.max_prefixes);
+    }
+    return total;
+}
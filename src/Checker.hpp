@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Loader.hpp"
+#include "Classifier.hpp"
+
+// ---------------Boundary Trace---------------------
+// 以随机规则为基点，把 1~2 个维度替换成该规则的边界值：
+//   IP   : lo, hi, lo-1, hi+1
+//   端口 : lo, hi, lo±1, hi±1, 1023, 1024，以及 lo/hi 所在 32 端口块的首尾
+//   协议 : lo, hi, lo-1, hi+1
+std::vector<Tuple5> generate_boundary_trace(
+    const std::vector<Rule5D>& rules,
+    size_t n,
+    uint32_t seed = 1
+);
+
+// ---------------Differential Check---------------------
+struct Disagreement {
+    size_t index;          // trace 下标
+    Tuple5 tuple;
+    MatchResult expect;    // oracle
+    MatchResult got;       // 被测分类器
+};
+
+struct DiffReport {
+    size_t checked = 0;
+    size_t rule_mismatch = 0;     // 规则号不同（含 action 不同）
+    size_t action_mismatch = 0;   // action 不同，或一方未命中
+    std::vector<Disagreement> disagreements;
+};
+
+// 把 trace 均分给 threads 个线程，逐包比较 oracle 与 candidate；
+// 每个不一致都记录下来，合并后按 trace 下标排序
+template <typename Oracle, typename Candidate>
+DiffReport differential_check(
+    const Oracle& oracle,
+    const Candidate& candidate,
+    const std::vector<Tuple5>& trace,
+    unsigned threads
+) {
+    if (threads == 0) threads = 1;
+    std::vector<DiffReport> parts(threads);
+    auto worker = [&](unsigned tid) {
+        size_t lo = trace.size() * tid / threads;
+        size_t hi = trace.size() * (tid + 1) / threads;
+        DiffReport& rep = parts[tid];
+        for (size_t i = lo; i < hi; ++i) {
+            MatchResult a = oracle.classify(trace[i]);
+            MatchResult b = candidate.classify(trace[i]);
+            rep.checked++;
+            if (a.rule_id == b.rule_id && a.action == b.action) continue;
+            if (a.rule_id != b.rule_id) rep.rule_mismatch++;
+            bool a_hit = a.rule_id != NO_MATCH_RULE, b_hit = b.rule_id != NO_MATCH_RULE;
+            if (a_hit != b_hit || a.action != b.action) rep.action_mismatch++;
+            Disagreement d = { i, trace[i], a, b };
+            rep.disagreements.push_back(d);
+        }
+    };
+
+    if (threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+        for (auto& th : pool) th.join();
+    }
+
+    // 各线程负责连续的下标区间，按线程顺序拼接即为有序
+    DiffReport total;
+    for (auto& p : parts) {
+        total.checked += p.checked;
+        total.rule_mismatch += p.rule_mismatch;
+        total.action_mismatch += p.action_mismatch;
+        total.disagreements.insert(total.disagreements.end(), p.disagreements.begin(), p.disagreements.end());
+    }
+    return total;
+}
+
+// 打印汇总与前 max_print 个不一致（附带两条规则的原始范围）
+void print_diff_report(
+    const std::string& name,
+    const DiffReport& report,
+    const std::vector<Rule5D>& rules,
+    size_t max_print
+);
+
+// 所有不一致逐行写入文件
+bool write_disagreements(
+    const DiffReport& report,
+    const std::string& output_file
+);
+
+// ---------------Port Prefix Kernel Check---------------------
+// 校验 port_range_to_prefixes：前缀首尾相接且恰好覆盖 [lo, hi]、每块按自身大小对齐、
+// 每块都不能再翻倍（贪心最大块，即条数最少）、条数不超过 MAX_PORT_PREFIXES。
+// samples = 0 时穷举全部 lo <= hi 的 (lo, hi)（约 2^31 对）；
+// 否则按 (跨度的位数, lo 末尾 0 的个数) 17x17 分层均匀抽样，并附加常见边界端口两两组合
+struct PrefixCheckReport {
+    size_t checked = 0;
+    size_t failures = 0;
+    size_t max_prefixes = 0;
+    uint32_t first_bad_lo = 0, first_bad_hi = 0;
+};
+
+PrefixCheckReport check_port_prefix_kernel(
+    size_t samples,
+    uint32_t seed,
+    unsigned threads
+);
@@ -0,0 +1,733 @@
+/** *************************************************************/
+// @Name: Classifier.cpp
+// @Function: Software reference classifier over the generated IP + LRME tables
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "Classifier.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// ---------------Linear Scan Classifier---------------------
+void LinearScanClassifier::build(const std::vector<Rule5D>& rules) {
+    rules_.clear();
+    rules_.reserve(rules.size());
+    for (const auto& r : rules) {
+        Node n;
+        n.src_lo = r.range[0][0];
+        n.src_hi = r.range[0][1];
+        n.dst_lo = r.range[1][0];
+        n.dst_hi = r.range[1][1];
+        n.sport_lo = static_cast<uint16_t>(r.range[2][0]);
+        n.sport_hi = static_cast<uint16_t>(r.range[2][1]);
+        n.dport_lo = static_cast<uint16_t>(r.range[3][0]);
+        n.dport_hi = static_cast<uint16_t>(r.range[3][1]);
+        n.proto_lo = static_cast<uint8_t>(r.range[4][0]);
+        n.proto_hi = static_cast<uint8_t>(std::min<uint32_t>(r.range[4][1], 0xFF));
+        n.action = r.action;
+        rules_.push_back(n);
+    }
+}
+
+MatchResult LinearScanClassifier::classify(const Tuple5& t) const {
+    for (size_t i = 0; i < rules_.size(); ++i) {
+        const Node& n = rules_[i];
+        if (t.src_ip < n.src_lo || t.src_ip > n.src_hi) continue;
+        if (t.dst_ip < n.dst_lo || t.dst_ip > n.dst_hi) continue;
+        if (t.src_port < n.sport_lo || t.src_port > n.sport_hi) continue;
+        if (t.dst_port < n.dport_lo || t.dst_port > n.dport_hi) continue;
+        if (t.proto < n.proto_lo || t.proto > n.proto_hi) continue;
+        MatchResult m = { static_cast<uint32_t>(i), n.action };
+        return m;
+    }
+    MatchResult miss = { NO_MATCH_RULE, 0 };
+    return miss;
+}
+
+// ---------------SIMD Linear Scan Classifier---------------------
+static const uint32_t SIGN_BIAS = 0x80000000u;
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+    case SIMD_AVX512: return "avx512";
+    case SIMD_AVX2:   return "avx2";
+    default:          return "scalar";
+    }
+}
+
+SimdLevel detect_simd_level() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return SIMD_AVX512;
+    if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+#endif
+    return SIMD_SCALAR;
+}
+
+void SimdLinearClassifier::build(const std::vector<Rule5D>& rules, SimdLevel max_level) {
+    level_ = std::min(max_level, detect_simd_level());
+    count_ = rules.size();
+    padded_ = (count_ + 15) & ~(size_t)15;
+
+    // 补齐的规则 lo = 最大值、hi = 最小值，任何包都不会命中
+    for (int c = 0; c < NUM_COLUMNS; ++c) {
+        cols_[c].assign(padded_, (c & 1) ? SIGN_BIAS : ~SIGN_BIAS);
+    }
+    actions_.assign(padded_, 0);
+
+    for (size_t i = 0; i < count_; ++i) {
+        const Rule5D& r = rules[i];
+        for (int d = 0; d < 5; ++d) {
+            uint32_t hi = d == 4 ? std::min<uint32_t>(r.range[4][1], 0xFF) : r.range[d][1];
+            cols_[2 * d][i] = r.range[d][0] ^ SIGN_BIAS;
+            cols_[2 * d + 1][i] = hi ^ SIGN_BIAS;
+        }
+        actions_[i] = r.action;
+    }
+}
+
+size_t SimdLinearClassifier::memory_bytes() const {
+    size_t bytes = actions_.capacity() * sizeof(uint16_t);
+    for (int c = 0; c < NUM_COLUMNS; ++c) bytes += cols_[c].capacity() * sizeof(uint32_t);
+    return bytes;
+}
+
+size_t SimdLinearClassifier::scan_scalar(const uint32_t* key) const {
+    for (size_t i = 0; i < count_; ++i) {
+        bool ok = true;
+        for (int d = 0; d < 5 && ok; ++d) {
+            int32_t v = (int32_t)key[d];
+            ok = (int32_t)cols_[2 * d][i] <= v && v <= (int32_t)cols_[2 * d + 1][i];
+        }
+        if (ok) return i;
+    }
+    return count_;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("avx2")))
+size_t SimdLinearClassifier::scan_avx2(const uint32_t* key) const {
+    __m256i v[5];
+    for (int d = 0; d < 5; ++d) v[d] = _mm256_set1_epi32((int)key[d]);
+
+    for (size_t i = 0; i < padded_; i += 8) {
+        // fail = OR(lo > v, v > hi)，8 条规则一次比较
+        __m256i fail = _mm256_setzero_si256();
+        for (int d = 0; d < 5; ++d) {
+            __m256i lo = _mm256_loadu_si256((const __m256i*)(cols_[2 * d].data() + i));
+            __m256i hi = _mm256_loadu_si256((const __m256i*)(cols_[2 * d + 1].data() + i));
+            fail = _mm256_or_si256(fail, _mm256_cmpgt_epi32(lo, v[d]));
+            fail = _mm256_or_si256(fail, _mm256_cmpgt_epi32(v[d], hi));
+        }
+        uint32_t match = ~(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(fail)) & 0xFFu;
+        if (match) return i + __builtin_ctz(match);
+    }
+    return count_;
+}
+
+__attribute__((target("avx512f")))
+size_t SimdLinearClassifier::scan_avx512(const uint32_t* key) const {
+    __m512i v[5];
+    for (int d = 0; d < 5; ++d) v[d] = _mm512_set1_epi32((int)key[d]);
+
+    for (size_t i = 0; i < padded_; i += 16) {
+        // 比较结果直接是 16 位掩码，逐维收窄
+        __mmask16 ok = 0xFFFF;
+        for (int d = 0; d < 5; ++d) {
+            __m512i lo = _mm512_loadu_si512((const void*)(cols_[2 * d].data() + i));
+            __m512i hi = _mm512_loadu_si512((const void*)(cols_[2 * d + 1].data() + i));
+            ok = _mm512_mask_cmple_epi32_mask(ok, lo, v[d]);
+            ok = _mm512_mask_cmple_epi32_mask(ok, v[d], hi);
+        }
+        if (ok) return i + __builtin_ctz((uint32_t)ok);
+    }
+    return count_;
+}
+#else
+size_t SimdLinearClassifier::scan_avx2(const uint32_t* key) const { return scan_scalar(key); }
+size_t SimdLinearClassifier::scan_avx512(const uint32_t* key) const { return scan_scalar(key); }
+#endif
+
+MatchResult SimdLinearClassifier::classify(const Tuple5& t) const {
+    const uint32_t key[5] = {
+        t.src_ip ^ SIGN_BIAS, t.dst_ip ^ SIGN_BIAS,
+        t.src_port ^ SIGN_BIAS, t.dst_port ^ SIGN_BIAS,
+        t.proto ^ SIGN_BIAS
+    };
+    size_t idx;
+    switch (level_) {
+    case SIMD_AVX512: idx = scan_avx512(key); break;
+    case SIMD_AVX2:   idx = scan_avx2(key); break;
+    default:          idx = scan_scalar(key); break;
+    }
+    // 补齐的规则永不命中，idx >= count_ 即未命中
+    if (idx >= count_) {
+        MatchResult miss = { NO_MATCH_RULE, 0 };
+        return miss;
+    }
+    MatchResult m = { static_cast<uint32_t>(idx), actions_[idx] };
+    return m;
+}
+
+// ---------------TCAM Table Classifier---------------------
+void TCAMClassifier::build(const std::vector<TCAM_Entry>& tcam_entries) {
+    entries_.clear();
+    entries_.reserve(tcam_entries.size());
+    for (const auto& e : tcam_entries) {
+        Node n;
+        n.src_lo = e.Src_IP_lo;
+        n.src_hi = e.Src_IP_hi;
+        n.dst_lo = e.Dst_IP_lo;
+        n.dst_hi = e.Dst_IP_hi;
+        n.sport_prefix = e.Src_Port_prefix;
+        n.sport_mask = e.Src_Port_mask;
+        n.dport_prefix = e.Dst_Port_prefix;
+        n.dport_mask = e.Dst_Port_mask;
+        n.rule_id = e.rule_id;
+        n.action = e.action;
+        n.proto = e.Proto;
+        entries_.push_back(n);
+    }
+}
+
+MatchResult TCAMClassifier::classify(const Tuple5& t) const {
+    for (const auto& n : entries_) {
+        if (t.src_ip < n.src_lo || t.src_ip > n.src_hi) continue;
+        if (t.dst_ip < n.dst_lo || t.dst_ip > n.dst_hi) continue;
+        if ((t.src_port & n.sport_mask) != n.sport_prefix) continue;
+        if ((t.dst_port & n.dport_mask) != n.dport_prefix) continue;
+        if (n.proto != 0 && n.proto != t.proto) continue;
+        MatchResult m = { n.rule_id, n.action };
+        return m;
+    }
+    MatchResult miss = { NO_MATCH_RULE, 0 };
+    return miss;
+}
+
+// ---------------Reference Classifier (IP table + LRME)---------------------
+// 单元 key：LRMID << 30 | ANY_Flag << 24 | SrcPAI 编码 << 12 | DstPAI 编码
+//   PAI 编码：真实端口 0..2047，REV 侧 REV_PAI_BASE 起的 32 个，ANY(0xFFFF) 记为 0xFFF
+// 探测组合（每个 LRMID 12 bit）：ANY_Flag * 4 + REV 变体
+//   REV 变体 bit0 = 源端口按 REV PAI 探测，bit1 = 目的端口按 REV PAI 探测
+static const uint32_t PAI_ANY_CODE = 0xFFF;
+static const uint16_t NO_LRMID = 0xFFFF;
+// LRME 表项中没有任何规则覆盖的区域（或没有双 ANY 规则的 drop_flag）报告的规则号，排在所有真实规则之后
+static const uint32_t UNOWNED_RULE = NO_MATCH_RULE - 1;
+
+static inline uint64_t make_cell_key(uint32_t lrmid, uint32_t any_flag, uint32_t spai, uint32_t dpai) {
+    return ((uint64_t)lrmid << 30) | ((uint64_t)any_flag << 24) | ((uint64_t)spai << 12) | dpai;
+}
+
+static inline uint32_t pai_code(uint16_t pai) {
+    return pai == 0xFFFF ? PAI_ANY_CODE : pai;
+}
+
+static inline bool is_rev_pai(uint16_t pai) {
+    return pai >= REV_PAI_BASE && pai < REV_PAI_BASE + 32;
+}
+
+// 表项一侧的 PAI 是否与 ANY_Flag 一致且可被探测到
+static inline bool valid_pai(uint16_t pai, bool any) {
+    return any ? pai == 0xFFFF : (pai < 2048 || is_rev_pai(pai));
+}
+
+// 单元内的端口区域：两侧位图，ANY 侧按单个位 1 处理
+struct PortRect {
+    uint32_t src, dst;
+};
+
+static inline PortRect lrme_rect(const LRME_Entry& e) {
+    PortRect r = { (e.ANY_Flag & 1) ? 1u : e.Src_32bitmap, (e.ANY_Flag & 2) ? 1u : e.Dst_32bitmap };
+    return r;
+}
+
+// parts 的并集是否覆盖 target：逐个源端口位检查目的端口位
+static bool rects_cover(const PortRect& target, const std::vector<PortRect>& parts) {
+    for (uint32_t rows = target.src; rows; rows &= rows - 1) {
+        uint32_t s = rows & (0u - rows);
+        uint32_t row = 0;
+        for (const auto& p : parts) {
+            if (p.src & s) row |= p.dst;
+        }
+        if ((row & target.dst) != target.dst) return false;
+    }
+    return true;
+}
+
+void LRMEClassifier::build(
+    const std::vector<MergrdR>& merged_ip_table,
+    const std::vector<IP_Table_Entry>& final_ip_table,
+    const std::vector<LRME_Entry>& lrme_entries,
+    const PortBlockTable& optimal_metainfo,
+    bool use_poptrie
+) {
+    const MatchResult none = { NO_MATCH_RULE, 0 };
+
+    // 1) side map：每个 PortBlock 按 32 端口切分后的区域 -> (单元, 位图, 规则下标, action)；
+    //    双 ANY 的 PortBlock 记为该 LRMID 的 drop 规则
+    struct Owner {
+        uint64_t key;
+        PortRect rect;
+        uint32_t rule_id;
+        uint16_t action;
+    };
+    std::vector<Owner> owners;
+    owners.reserve(optimal_metainfo.total_items() * 2);
+    std::vector<MatchResult> drop_rules(optimal_metainfo.size(), none);
+    std::vector<PortBlock> subs;
+
+    for (const auto& entry : optimal_metainfo) {
+        uint32_t lrmid = entry.first;
+        if (lrmid >= merged_ip_table.size()) continue;
+        const auto& blocks = entry.second;
+        const auto& rids = merged_ip_table[lrmid].merged_R;
+        size_t n = std::min(blocks.size(), rids.size());
+
+        for (size_t k = 0; k < n; ++k) {
+            const PortBlock& block = blocks[k];
+            uint32_t rule_id = static_cast<uint32_t>(rids[k]);
+            if (block.ANY_Flag == 3) {
+                if (rule_id < drop_rules[lrmid].rule_id) {
+                    drop_rules[lrmid].rule_id = rule_id;
+                    drop_rules[lrmid].action = block.action;
+                }
+                continue;
+            }
+            subs.clear();
+            Split_Port_Block(block, subs);
+            for (const auto& sub : subs) {
+                LRME_Entry e = make_lrme_entry(sub);
+                Owner o = { make_cell_key(lrmid, e.ANY_Flag, pai_code(e.SrcPAI), pai_code(e.DstPAI)),
+                            lrme_rect(e), rule_id, block.action };
+                owners.push_back(o);
+            }
+        }
+    }
+
+    // 2) IP 阶段：LRMID 与 REV 只取自 IP_Table_Entry；drop_flag 没有 LRMID 字段，
+    //    按表项下标（与 merged_ip_table 一一对应）从 side map 取双 ANY 规则
+    ip_nodes_.clear();
+    ip_nodes_.reserve(final_ip_table.size());
+    for (size_t i = 0; i < final_ip_table.size(); ++i) {
+        const auto& e = final_ip_table[i];
+        IPNode node;
+        node.lrmid[0] = e.No_ANY_LRMID;
+        node.lrmid[1] = e.Src_ANY_LRMID;
+        node.lrmid[2] = e.Dst_ANY_LRMID;
+        node.rev = (e.No_ANY_REV_Flag ? 1 : 0) | (e.Src_ANY_REV_Flag ? 2 : 0) | (e.Dst_ANY_REV_Flag ? 4 : 0);
+        node.drop = none;
+        if (e.drop_flag) {
+            node.drop.rule_id = UNOWNED_RULE;
+            if (i < merged_ip_table.size() && merged_ip_table[i].LRMID < drop_rules.size() &&
+                drop_rules[merged_ip_table[i].LRMID].rule_id != NO_MATCH_RULE) {
+                node.drop = drop_rules[merged_ip_table[i].LRMID];
+            }
+        }
+        ip_nodes_.push_back(node);
+    }
+    ip_stage_.build(final_ip_table, use_poptrie);
+
+    // 3) 端口阶段：生成的 LRME 表项按单元分组。IP 表的 16 位 LRMID 指不到的表项、
+    //    双 ANY 表项（由 drop_flag 处理）以及 PAI 与 ANY_Flag 不一致的表项不可能被查到，跳过
+    std::vector<std::pair<uint64_t, uint32_t>> table;   // (单元 key, lrme_entries 下标)
+    table.reserve(lrme_entries.size());
+    combos_.clear();
+    for (size_t j = 0; j < lrme_entries.size(); ++j) {
+        const LRME_Entry& e = lrme_entries[j];
+        if (e.LRMID >= NO_LRMID || e.ANY_Flag == 3) continue;
+        if (!valid_pai(e.SrcPAI, e.ANY_Flag & 1) || !valid_pai(e.DstPAI, e.ANY_Flag & 2)) continue;
+        uint32_t variant = (is_rev_pai(e.SrcPAI) ? 1u : 0u) | (is_rev_pai(e.DstPAI) ? 2u : 0u);
+        if (e.LRMID >= combos_.size()) combos_.resize(e.LRMID + 1, 0);
+        combos_[e.LRMID] |= static_cast<uint16_t>(1u << (e.ANY_Flag * 4 + variant));
+        table.push_back(std::make_pair(make_cell_key(e.LRMID, e.ANY_Flag, pai_code(e.SrcPAI), pai_code(e.DstPAI)),
+                                       static_cast<uint32_t>(j)));
+    }
+
+    auto owner_less = [](const Owner& a, const Owner& b) { return a.key < b.key; };
+    std::sort(owners.begin(), owners.end(), owner_less);
+    std::sort(table.begin(), table.end());
+
+    // 4) 逐单元把规则区域归属到表项：规则区域被单元内表项完整覆盖时记一条记录，
+    //    否则只记与各表项相交的部分；表项中未被任何规则覆盖的区域记为 UNOWNED_RULE
+    std::vector<std::pair<uint64_t, LRMERec>> pending;
+    pending.reserve(owners.size() + table.size() / 8);
+    std::vector<PortRect> cell_rects, owner_rects;
+    size_t o = 0;
+    for (size_t t = 0; t < table.size(); ) {
+        uint64_t key = table[t].first;
+        const LRME_Entry& first = lrme_entries[table[t].second];
+        uint32_t src_keep = (first.ANY_Flag & 1) ? 0u : ~0u;   // ANY 侧记录位图为 0
+        uint32_t dst_keep = (first.ANY_Flag & 2) ? 0u : ~0u;
+
+        cell_rects.clear();
+        for (; t < table.size() && table[t].first == key; ++t) {
+            cell_rects.push_back(lrme_rect(lrme_entries[table[t].second]));
+        }
+        while (o < owners.size() && owners[o].key < key) ++o;
+        owner_rects.clear();
+        for (; o < owners.size() && owners[o].key == key; ++o) {
+            const Owner& ow = owners[o];
+            owner_rects.push_back(ow.rect);
+            LRMERec rec;
+            rec.rule_id = ow.rule_id;
+            rec.action = ow.action;
+            if (rects_cover(ow.rect, cell_rects)) {
+                rec.src_bm = ow.rect.src & src_keep;
+                rec.dst_bm = ow.rect.dst & dst_keep;
+                pending.push_back(std::make_pair(key, rec));
+                continue;
+            }
+            for (const auto& r : cell_rects) {
+                uint32_t s = ow.rect.src & r.src, d = ow.rect.dst & r.dst;
+                if (!s || !d) continue;
+                rec.src_bm = s & src_keep;
+                rec.dst_bm = d & dst_keep;
+                pending.push_back(std::make_pair(key, rec));
+            }
+        }
+        for (const auto& r : cell_rects) {
+            if (rects_cover(r, owner_rects)) continue;
+            LRMERec rec = { r.src & src_keep, r.dst & dst_keep, UNOWNED_RULE, 0 };
+            pending.push_back(std::make_pair(key, rec));
+        }
+    }
+
+    // 5) 按 (key, 规则号) 排序后压成 CSR：cell -> [begin, end)
+    std::sort(pending.begin(), pending.end(),
+        [](const std::pair<uint64_t, LRMERec>& a, const std::pair<uint64_t, LRMERec>& b) {
+            return a.first != b.first ? a.first < b.first : a.second.rule_id < b.second.rule_id;
+        });
+
+    size_t ncells = 0;
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (i == 0 || pending[i].first != pending[i - 1].first) ncells++;
+    }
+    cell_index_ = FlatKeyIndex<uint64_t, U64KeyHash>(ncells);
+    cells_.clear();
+    cells_.reserve(ncells);
+    recs_.clear();
+    recs_.reserve(pending.size());
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (i == 0 || pending[i].first != pending[i - 1].first) {
+            cell_index_.find_or_insert(pending[i].first, static_cast<uint32_t>(cells_.size()));
+            LRMECell c = { static_cast<uint32_t>(i), static_cast<uint32_t>(i) };
+            cells_.push_back(c);
+        }
+        recs_.push_back(pending[i].second);
+        cells_.back().end = static_cast<uint32_t>(recs_.size());
+    }
+
+    std::cout << "[LRMEClassifier] Built: " << ip_nodes_.size() << " IP entries (" << ip_stage_name() << "), "
+              << table.size() << " LRME entries in " << cells_.size() << " cells, " << recs_.size()
+              << " rule records, " << memory_bytes() / 1024 << " KB" << std::endl;
+}
+
+// 按探测组合计算哈希 key 与端口位；REV 侧端口 < 1024 时该组合不可能命中，返回 false
+bool LRMEClassifier::make_probe(uint32_t lrmid, uint32_t combo, const Tuple5& t, Probe& p) const {
+    uint32_t any_flag = combo >> 2;
+    uint32_t rev = combo & 3;
+
+    uint32_t sp = t.src_port, dp = t.dst_port;
+    uint32_t spai = PAI_ANY_CODE, dpai = PAI_ANY_CODE;
+    p.sbit = p.dbit = 0;
+    if (!(any_flag & 1)) {
+        if (rev & 1) {
+            if (sp < 1024) return false;
+            spai = REV_PAI_BASE + ((sp & 1023) >> 5);
+        } else {
+            spai = sp >> 5;
+        }
+        p.sbit = 1u << (sp & 31);
+    }
+    if (!(any_flag & 2)) {
+        if (rev & 2) {
+            if (dp < 1024) return false;
+            dpai = REV_PAI_BASE + ((dp & 1023) >> 5);
+        } else {
+            dpai = dp >> 5;
+        }
+        p.dbit = 1u << (dp & 31);
+    }
+    p.key = make_cell_key(lrmid, any_flag, spai, dpai);
+    return true;
+}
+
+void LRMEClassifier::scan_cell(const Probe& p, MatchResult& best) const {
+    const LRMECell& c = cells_[p.cell];
+    for (uint32_t r = c.begin; r < c.end; ++r) {
+        const LRMERec& rec = recs_[r];
+        if (rec.rule_id >= best.rule_id) break;   // 记录按规则号升序
+        bool s_ok = p.sbit == 0 || (rec.src_bm & p.sbit);
+        bool d_ok = p.dbit == 0 || (rec.dst_bm & p.dbit);
+        if (s_ok && d_ok) {
+            best.rule_id = rec.rule_id;
+            best.action = rec.action;
+            break;
+        }
+    }
+}
+
+// 一个 IP 表项的全部探测：LRMID 有效的类别探测非 REV 组合，REV 标志置位时再探测 REV 组合；
+// 只探测 LRME 表中确实存在的组合
+template <typename Visit>
+void LRMEClassifier::for_each_probe(const IPNode& node, const Tuple5& t, Visit visit) const {
+    for (uint32_t f = 0; f < 3; ++f) {
+        uint32_t lrmid = node.lrmid[f];
+        if (lrmid >= combos_.size()) continue;   // 含 0xFFFF（未设置）
+        uint32_t todo = (combos_[lrmid] >> (f * 4)) & (((node.rev >> f) & 1) ? 0xFu : 0x1u);
+        while (todo) {
+            uint32_t v = __builtin_ctz(todo);
+            todo &= todo - 1;
+            Probe p;
+            if (make_probe(lrmid, f * 4 + v, t, p)) visit(p);
+        }
+    }
+}
+
+MatchResult LRMEClassifier::classify(const Tuple5& t) const {
+    // IP 表项之间可以重叠（例如 0.0.0.0/0 与 10.0.0.0/8），
+    // 所以要查完所有命中的 IP 表项，取规则下标最小的结果
+    MatchResult best = { NO_MATCH_RULE, 0 };
+    ip_stage_.for_each_match(t.src_ip, t.dst_ip, t.proto, [&](uint32_t id) {
+        const IPNode& node = ip_nodes_[id];
+        if (node.drop.rule_id < best.rule_id) best = node.drop;
+        for_each_probe(node, t, [&](Probe& p) {
+            p.cell = cell_index_.find(p.key);
+            if (p.cell != FlatKeyIndex<uint64_t, U64KeyHash>::NOT_FOUND) scan_cell(p, best);
+        });
+    });
+    return best;
+}
+
+// 批量流水：每次取 BATCH_CHUNK 个包
+//   阶段 1：IP 阶段（poptrie 或区间索引），生成这批包的所有探测 (LRMID, 探测组合)
+//   阶段 2：查哈希得到 cell，同时预取 PREFETCH_DIST 个探测之后的哈希槽位
+//   阶段 3：扫描 LRME 记录，同时预取 PREFETCH_DIST 个探测之后的记录
+// 哈希槽位与 LRME 记录是随机访问，按固定距离预取，避免一次发出过多预取挤占填充缓冲
+static const size_t BATCH_CHUNK = 64;
+static const size_t PREFETCH_DIST = 8;
+
+void LRMEClassifier::classify_batch(const Tuple5* pkts, size_t n, uint16_t* actions, uint32_t* rule_ids) const {
+    // 每线程复用的探测缓冲；取一次引用，避免热循环里反复访问 TLS
+    static thread_local std::vector<Probe> tls_probes;
+    std::vector<Probe>& probes = tls_probes;
+    const uint32_t NOT_FOUND = FlatKeyIndex<uint64_t, U64KeyHash>::NOT_FOUND;
+    MatchResult best[BATCH_CHUNK];
+
+    for (size_t base = 0; base < n; base += BATCH_CHUNK) {
+        size_t m = std::min(BATCH_CHUNK, n - base);
+        probes.clear();
+
+        for (size_t i = 0; i < m; ++i) {
+            best[i].rule_id = NO_MATCH_RULE;
+            best[i].action = 0;
+        }
+
+        for (size_t i = 0; i < m; ++i) {
+            const Tuple5& t = pkts[base + i];
+            uint32_t pkt = static_cast<uint32_t>(i);
+            ip_stage_.for_each_match(t.src_ip, t.dst_ip, t.proto, [&](uint32_t id) {
+                const IPNode& node = ip_nodes_[id];
+                if (node.drop.rule_id < best[pkt].rule_id) best[pkt] = node.drop;
+                for_each_probe(node, t, [&](Probe& p) {
+                    p.pkt = pkt;
+                    probes.push_back(p);
+                });
+            });
+        }
+
+        size_t np = probes.size();
+        for (size_t j = 0; j < std::min(PREFETCH_DIST, np); ++j) {
+            cell_index_.prefetch(probes[j].key);
+        }
+        for (size_t j = 0; j < np; ++j) {
+            if (j + PREFETCH_DIST < np) cell_index_.prefetch(probes[j + PREFETCH_DIST].key);
+            probes[j].cell = cell_index_.find(probes[j].key);
+        }
+
+        for (size_t j = 0; j < std::min(PREFETCH_DIST, np); ++j) {
+            if (probes[j].cell != NOT_FOUND) __builtin_prefetch(&recs_[cells_[probes[j].cell].begin]);
+        }
+        for (size_t j = 0; j < np; ++j) {
+            if (j + PREFETCH_DIST < np && probes[j + PREFETCH_DIST].cell != NOT_FOUND) {
+                __builtin_prefetch(&recs_[cells_[probes[j + PREFETCH_DIST].cell].begin]);
+            }
+            if (probes[j].cell != NOT_FOUND) scan_cell(probes[j], best[probes[j].pkt]);
+        }
+
+        for (size_t i = 0; i < m; ++i) {
+            actions[base + i] = best[i].action;
+            if (rule_ids) rule_ids[base + i] = best[i].rule_id;
+        }
+    }
+}
+
+size_t LRMEClassifier::memory_bytes() const {
+    return ip_nodes_.capacity() * sizeof(IPNode) +
+           ip_stage_.memory_bytes() +
+           combos_.capacity() * sizeof(uint16_t) +
+           cell_index_.memory_bytes() +
+           cells_.capacity() * sizeof(LRMECell) +
+           recs_.capacity() * sizeof(LRMERec);
+}
+
+// ---------------RFC Port Classifier---------------------
+
+// 端口区间 [lo, hi] 的基本区间左端点（含 0），升序去重
+static void port_bounds(std::vector<uint32_t>& b) {
+    b.push_back(0);
+    std::sort(b.begin(), b.end());
+    b.erase(std::unique(b.begin(), b.end()), b.end());
+    if (!b.empty() && b.back() > 0xFFFF) b.pop_back();   // hi = 65535 时的 65536
+}
+
+static inline uint32_t port_class(const std::vector<uint32_t>& bounds, uint32_t port) {
+    return static_cast<uint32_t>(std::upper_bound(bounds.begin(), bounds.end(), port) - bounds.begin() - 1);
+}
+
+// 全局类 -> 局部类映射；相同映射在 remap 中只存一份，返回起点
+static uint32_t intern_remap(
+    const std::vector<uint16_t>& map,
+    std::map<std::vector<uint16_t>, uint32_t>& seen,
+    std::vector<uint16_t>& remap
+) {
+    auto it = seen.find(map);
+    if (it != seen.end()) return it->second;
+    uint32_t base = static_cast<uint32_t>(remap.size());
+    remap.insert(remap.end(), map.begin(), map.end());
+    seen.insert(std::make_pair(map, base));
+    return base;
+}
+
+bool RFCPortClassifier::build(
+    const std::vector<MergrdR>& merged_ip_table,
+    const std::vector<IP_Table_Entry>& final_ip_table,
+    const MergedItemTable& metainfo,
+    bool use_poptrie,
+    size_t max_cells
+) {
+    // 1) IP 阶段
+    size_t n_ip = std::min(final_ip_table.size(), merged_ip_table.size());
+    lrmid_of_.resize(n_ip);
+    for (size_t i = 0; i < n_ip; ++i) lrmid_of_[i] = merged_ip_table[i].LRMID;
+    if (n_ip == final_ip_table.size()) {
+        ip_stage_.build(final_ip_table, use_poptrie);
+    } else {
+        ip_stage_.build(std::vector<IP_Table_Entry>(final_ip_table.begin(), final_ip_table.begin() + n_ip), use_poptrie);
+    }
+
+    // 2) 阶段 0：全部 MergedItem 的端口端点 -> 全局等价类
+    size_t n_lrmid = std::min<size_t>(metainfo.size(), merged_ip_table.size());
+    std::vector<uint32_t> gsrc, gdst;
+    for (size_t l = 0; l < n_lrmid; ++l) {
+        for (const auto& it : metainfo[l]) {
+            gsrc.push_back(it.Src_Port_lo);
+            gsrc.push_back(it.Src_Port_hi + 1);
+            gdst.push_back(it.Dst_Port_lo);
+            gdst.push_back(it.Dst_Port_hi + 1);
+        }
+    }
+    port_bounds(gsrc);
+    port_bounds(gdst);
+    src_classes_ = static_cast<uint32_t>(gsrc.size());
+    dst_classes_ = static_cast<uint32_t>(gdst.size());
+    src_eq_.resize(1u << 16);
+    dst_eq_.resize(1u << 16);
+    for (uint32_t p = 0; p < (1u << 16); ++p) {
+        src_eq_[p] = static_cast<uint16_t>(port_class(gsrc, p));
+        dst_eq_[p] = static_cast<uint16_t>(port_class(gdst, p));
+    }
+
+    // 3) 阶段 1：每个 LRMID 的局部类、重映射与交叉乘积表
+    tables_.assign(merged_ip_table.size(), PortTable());
+    remap_.clear();
+    cells_.clear();
+    std::map<std::vector<uint16_t>, uint32_t> seen_src, seen_dst;
+    std::vector<uint32_t> lsrc, ldst;
+    std::vector<uint16_t> map_src(src_classes_), map_dst(dst_classes_);
+    const MatchResult miss = { NO_MATCH_RULE, 0 };
+
+    for (size_t l = 0; l < merged_ip_table.size(); ++l) {
+        const auto& rids = merged_ip_table[l].merged_R;
+        const MergedItem* items = l < n_lrmid && !metainfo[l].empty() ? &metainfo[l][0] : nullptr;
+        size_t n = items ? std::min(metainfo[l].size(), rids.size()) : 0;
+
+        lsrc.clear();
+        ldst.clear();
+        for (size_t k = 0; k < n; ++k) {
+            lsrc.push_back(items[k].Src_Port_lo);
+            lsrc.push_back(items[k].Src_Port_hi + 1);
+            ldst.push_back(items[k].Dst_Port_lo);
+            ldst.push_back(items[k].Dst_Port_hi + 1);
+        }
+        port_bounds(lsrc);
+        port_bounds(ldst);
+        for (uint32_t g = 0; g < src_classes_; ++g) map_src[g] = static_cast<uint16_t>(port_class(lsrc, gsrc[g]));
+        for (uint32_t g = 0; g < dst_classes_; ++g) map_dst[g] = static_cast<uint16_t>(port_class(ldst, gdst[g]));
+
+        PortTable& pt = tables_[l];
+        pt.src_map = intern_remap(map_src, seen_src, remap_);
+        pt.dst_map = intern_remap(map_dst, seen_dst, remap_);
+        pt.cell_base = static_cast<uint32_t>(cells_.size());
+        pt.dst_local = static_cast<uint32_t>(ldst.size());
+
+        size_t area = lsrc.size() * ldst.size();
+        if (cells_.size() + area > max_cells) {
+            std::cerr << "[WARN] RFCPortClassifier: cross-product tables exceed " << max_cells
+                      << " cells (LRMID " << l << ")" << std::endl;
+            return false;
+        }
+        cells_.resize(cells_.size() + area, miss);
+        MatchResult* table = &cells_[pt.cell_base];
+        for (size_t k = 0; k < n; ++k) {
+            uint32_t s_lo = port_class(lsrc, items[k].Src_Port_lo), s_hi = port_class(lsrc, items[k].Src_Port_hi);
+            uint32_t d_lo = port_class(ldst, items[k].Dst_Port_lo), d_hi = port_class(ldst, items[k].Dst_Port_hi);
+            MatchResult r = { static_cast<uint32_t>(rids[k]), items[k].action };
+            for (uint32_t s = s_lo; s <= s_hi; ++s) {
+                for (uint32_t d = d_lo; d <= d_hi; ++d) {
+                    MatchResult& c = table[s * pt.dst_local + d];
+                    if (r.rule_id < c.rule_id) c = r;
+                }
+            }
+        }
+    }
+    remap_.shrink_to_fit();
+    cells_.shrink_to_fit();
+
+    std::cout << "[RFCPortClassifier] Built: " << n_ip << " IP entries (" << ip_stage_.name() << "), "
+              << src_classes_ << " x " << dst_classes_ << " global port classes, "
+              << cells_.size() << " cross-product cells, "
+              << memory_bytes() / 1024 << " KB" << std::endl;
+    return true;
+}
+
+MatchResult RFCPortClassifier::classify(const Tuple5& t) const {
+    MatchResult best = { NO_MATCH_RULE, 0 };
+    uint32_t gs = src_eq_[t.src_port];
+    uint32_t gd = dst_eq_[t.dst_port];
+    ip_stage_.for_each_match(t.src_ip, t.dst_ip, t.proto, [&](uint32_t id) {
+        const PortTable& pt = tables_[lrmid_of_[id]];
+        const MatchResult& r = cells_[pt.cell_base + remap_[pt.src_map + gs] * pt.dst_local + remap_[pt.dst_map + gd]];
+        if (r.rule_id < best.rule_id) best = r;
+    });
+    return best;
+}
+
+size_t RFCPortClassifier::memory_bytes() const {
+    return ip_stage_.memory_bytes() +
+           lrmid_of_.capacity() * sizeof(uint32_t) +
+           (src_eq_.capacity() + dst_eq_.capacity()) * sizeof(uint16_t) +
+           tables_.capacity() * sizeof(PortTable) +
+           remap_.capacity() * sizeof(uint16_t) +
+           cells_.capacity() * sizeof(MatchResult);
+}
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "IPIndex.hpp"
+
+// ---------------Struct Declarations---------------------
+struct Tuple5 {
+    uint32_t src_ip, dst_ip;
+    uint16_t src_port, dst_port;
+    uint8_t  proto;
+};
+
+static const uint32_t NO_MATCH_RULE = 0xFFFFFFFFu;
+
+struct MatchResult {
+    uint32_t rule_id;   // 命中规则在 rules 中的下标，NO_MATCH_RULE 表示未命中
+    uint16_t action;
+};
+
+// ---------------Linear Scan Classifier---------------------
+// 按规则下标（即优先级）顺序逐条比较原始 Rule5D，首个命中即返回
+class LinearScanClassifier {
+public:
+    void build(const std::vector<Rule5D>& rules);
+
+    MatchResult classify(const Tuple5& t) const;
+
+    size_t entries() const { return rules_.size(); }
+    size_t memory_bytes() const { return rules_.capacity() * sizeof(Node); }
+
+private:
+    struct Node {
+        uint32_t src_lo, src_hi;
+        uint32_t dst_lo, dst_hi;
+        uint16_t sport_lo, sport_hi;
+        uint16_t dport_lo, dport_hi;
+        uint8_t  proto_lo, proto_hi;
+        uint16_t action;
+    };
+    std::vector<Node> rules_;
+};
+
+// ---------------SIMD Linear Scan Classifier---------------------
+// 规则转置为按列存储（SoA），每次用一条向量比较检查 8 条（AVX2）或 16 条（AVX-512）规则，
+// movemask 后取最低位即为优先级最高的命中。指令集在 build 时按 CPU 特性选择，
+// 不支持时回退到标量循环。列中存放 value ^ 0x80000000，统一用有符号比较实现无符号比较
+enum SimdLevel {
+    SIMD_SCALAR = 0,
+    SIMD_AVX2 = 1,
+    SIMD_AVX512 = 2
+};
+
+const char* simd_level_name(SimdLevel level);
+
+// 当前 CPU 支持的最高级别
+SimdLevel detect_simd_level();
+
+class SimdLinearClassifier {
+public:
+    // max_level 用于强制降级（例如对比标量路径），实际级别为 min(max_level, CPU 支持)
+    void build(const std::vector<Rule5D>& rules, SimdLevel max_level = SIMD_AVX512);
+
+    MatchResult classify(const Tuple5& t) const;
+
+    SimdLevel level() const { return level_; }
+    size_t entries() const { return count_; }
+    size_t memory_bytes() const;
+
+private:
+    enum Column {
+        SRC_LO, SRC_HI, DST_LO, DST_HI,
+        SPORT_LO, SPORT_HI, DPORT_LO, DPORT_HI,
+        PROTO_LO, PROTO_HI,
+        NUM_COLUMNS
+    };
+
+    size_t scan_scalar(const uint32_t* key) const;
+    size_t scan_avx2(const uint32_t* key) const;
+    size_t scan_avx512(const uint32_t* key) const;
+
+    SimdLevel level_ = SIMD_SCALAR;
+    size_t count_ = 0;     // 实际规则数
+    size_t padded_ = 0;    // 按 16 对齐后的长度，补齐的规则永不命中
+    std::vector<uint32_t> cols_[NUM_COLUMNS];
+    std::vector<uint16_t> actions_;
+};
+
+// ---------------TCAM Table Classifier---------------------
+// 软件模拟 TCAM_Port_Expansion 生成的表：表项按顺序比较，
+// 端口按 (port & mask) == prefix 匹配，Proto 为 0 视为通配
+class TCAMClassifier {
+public:
+    void build(const std::vector<TCAM_Entry>& tcam_entries);
+
+    MatchResult classify(const Tuple5& t) const;
+
+    size_t entries() const { return entries_.size(); }
+    size_t memory_bytes() const { return entries_.capacity() * sizeof(Node); }
+
+private:
+    struct Node {
+        uint32_t src_lo, src_hi;
+        uint32_t dst_lo, dst_hi;
+        uint16_t sport_prefix, sport_mask;
+        uint16_t dport_prefix, dport_mask;
+        uint32_t rule_id;
+        uint16_t action;
+        uint8_t  proto;
+    };
+    std::vector<Node> entries_;
+};
+
+// ---------------Reference Classifier (IP table + LRME)---------------------
+// 软件执行生成的两级表（与写出的 IP_table / Port_table 相同的表项）：
+//   1) IP 阶段：经 IPStageIndex 找出所有命中的 IP_Table_Entry（Proto 为 0 视为通配），
+//      每个表项按 No/Src/Dst_ANY_LRMID 与对应的 REV 标志探测 ANY_Flag = 0/1/2 的 LRME 单元，
+//      drop_flag 表示双 ANY 规则直接命中
+//   2) 端口阶段：按 (LRMID, ANY_Flag, SrcPAI, DstPAI) 查生成的 LRME 表项，检查 bitmap 的 port%32 位；
+//      REV 标志置位时，port >= 1024 的一侧额外按 REV PAI（REV_PAI_BASE + (port & 1023) / 32）探测
+// 表项本身不带规则号，比较 oracle 需要的规则下标与 action 来自 side map：
+// 由 optimal_metainfo 的 PortBlock 切分出每条规则覆盖的端口区域，归属到与之相交的 LRME 表项上，
+// 命中的表项取其中规则下标最小的归属；表项中没有任何规则覆盖的区域报告为一个不存在的规则号，
+// 规则覆盖、但表中缺失的区域则查不到，两种错误都会在差分检查中暴露
+class LRMEClassifier {
+public:
+    // lrme_entries 为写入 Port_table 的表项（Caculate_LRME_for_Port_Table 取回，可为 --coalesce 的结果）；
+    // merged_ip_table / optimal_metainfo 只用于 side map（final_ip_table 与 merged_ip_table 按下标一一对应）。
+    // use_poptrie：IP 阶段优先用 poptrie 交叉乘积索引，规模超出预算或为 false 时用区间索引
+    void build(
+        const std::vector<MergrdR>& merged_ip_table,
+        const std::vector<IP_Table_Entry>& final_ip_table,
+        const std::vector<LRME_Entry>& lrme_entries,
+        const PortBlockTable& optimal_metainfo,
+        bool use_poptrie = true
+    );
+
+    MatchResult classify(const Tuple5& t) const;
+
+    // 批量查找：按阶段流水处理整批包，阶段之间对哈希槽位和 LRME 记录做预取。
+    // 未命中的包 action 为 0；rule_ids 非空时同时输出规则下标（未命中为 NO_MATCH_RULE）
+    void classify_batch(const Tuple5* pkts, size_t n, uint16_t* actions, uint32_t* rule_ids = nullptr) const;
+
+    size_t ip_entries() const { return ip_nodes_.size(); }
+    const char* ip_stage_name() const { return ip_stage_.name(); }
+    size_t lrme_records() const { return recs_.size(); }
+    size_t memory_bytes() const;
+
+private:
+    struct IPNode {
+        uint16_t lrmid[3];     // ANY_Flag = 0/1/2 类别的 LRMID（No/Src/Dst_ANY_LRMID），0xFFFF 为无
+        uint8_t  rev;          // bit f：类别 f 的 REV 标志
+        MatchResult drop;      // drop_flag 对应的规则（side map），无 drop 时为 NO_MATCH_RULE
+    };
+    struct LRMECell {
+        uint32_t begin, end;
+    };
+    struct LRMERec {
+        uint32_t src_bm, dst_bm;   // ANY 侧为 0
+        uint32_t rule_id;
+        uint16_t action;
+    };
+
+    // 一次 (LRMID, 探测组合) 的查找状态
+    struct Probe {
+        uint64_t key;
+        uint32_t sbit, dbit;   // 端口在 bitmap 中的位，ANY 侧为 0
+        uint32_t pkt;          // 批内下标
+        uint32_t cell;
+    };
+
+    bool make_probe(uint32_t lrmid, uint32_t combo, const Tuple5& t, Probe& p) const;
+    void scan_cell(const Probe& p, MatchResult& best) const;
+    template <typename Visit>
+    void for_each_probe(const IPNode& node, const Tuple5& t, Visit visit) const;
+
+    std::vector<IPNode> ip_nodes_;
+    IPStageIndex ip_stage_;          // IP 阶段：返回所有命中的 ip_nodes_ 下标
+    std::vector<uint16_t> combos_;   // 每个 LRMID 在 LRME 表中存在的探测组合（见 Classifier.cpp）
+    FlatKeyIndex<uint64_t, U64KeyHash> cell_index_;
+    std::vector<LRMECell> cells_;
+    std::vector<LRMERec> recs_;
+};
+
+// ---------------RFC Port Classifier---------------------
+// 端口阶段的另一种实现（RFC 式两阶段等价类），IP 阶段与 LRMEClassifier 相同：
+//   阶段 0：源 / 目的端口各一张 65536 项的表，端口 -> 全局等价类
+//   阶段 1：每个 LRMID 把全局类重映射到本 LRMID 的局部类（相同映射只存一份），
+//          局部 (src, dst) 交叉乘积表直接给出规则下标最小的结果
+// 端口按 MergedItem 的原始区间匹配（无 PAI / bitmap 编码），查找不需要搜索
+class RFCPortClassifier {
+public:
+    // 交叉乘积格子总数超过 max_cells 时放弃构建并返回 false
+    static const size_t DEFAULT_MAX_CELLS = 1u << 26;
+
+    bool build(
+        const std::vector<MergrdR>& merged_ip_table,
+        const std::vector<IP_Table_Entry>& final_ip_table,
+        const MergedItemTable& metainfo,
+        bool use_poptrie = true,
+        size_t max_cells = DEFAULT_MAX_CELLS
+    );
+
+    MatchResult classify(const Tuple5& t) const;
+
+    size_t ip_entries() const { return lrmid_of_.size(); }
+    size_t cells() const { return cells_.size(); }
+    size_t src_classes() const { return src_classes_; }
+    size_t dst_classes() const { return dst_classes_; }
+    size_t memory_bytes() const;
+
+private:
+    struct PortTable {
+        uint32_t src_map, dst_map;    // remap_ 中的起点
+        uint32_t cell_base;
+        uint32_t dst_local;           // 局部目的类个数（行宽）
+    };
+
+    IPStageIndex ip_stage_;
+    std::vector<uint32_t> lrmid_of_;  // IP 表项下标 -> LRMID
+    std::vector<uint16_t> src_eq_, dst_eq_;
+    uint32_t src_classes_ = 0, dst_classes_ = 0;
+    std::vector<PortTable> tables_;   // 按 LRMID
+    std::vector<uint16_t> remap_;
+    std::vector<MatchResult> cells_;
+};
+
+// 吞吐测试：trace 均分给 threads 个线程，重复 rounds 遍，返回 packets/second
+// checksum 累加命中的 action，防止查找被优化掉
+template <typename Classifier>
+double measure_lookup_rate(
+    const Classifier& c,
+    const std::vector<Tuple5>& trace,
+    unsigned threads,
+    int rounds = 1,
+    uint64_t* checksum = nullptr
+) {
+    if (threads == 0) threads = 1;
+    std::vector<uint64_t> sums(threads, 0);
+    auto worker = [&](unsigned tid) {
+        size_t lo = trace.size() * tid / threads;
+        size_t hi = trace.size() * (tid + 1) / threads;
+        uint64_t s = 0;
+        for (int r = 0; r < rounds; ++r) {
+            for (size_t i = lo; i < hi; ++i) {
+                s += c.classify(trace[i]).action;
+            }
+        }
+        sums[tid] = s;
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+        for (auto& th : pool) th.join();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    if (checksum) {
+        *checksum = 0;
+        for (uint64_t s : sums) *checksum += s;
+    }
+    double sec = std::chrono::duration<double>(t1 - t0).count();
+    return sec > 0 ? (double)trace.size() * rounds / sec : 0.0;
+}
+
+// 批量吞吐测试：同 measure_lookup_rate，但每次以 batch 个包调用 classify_batch
+template <typename Classifier>
+double measure_batch_rate(
+    const Classifier& c,
+    const std::vector<Tuple5>& trace,
+    size_t batch,
+    unsigned threads,
+    int rounds = 1,
+    uint64_t* checksum = nullptr
+) {
+    if (threads == 0) threads = 1;
+    if (batch == 0) batch = 1;
+    std::vector<uint64_t> sums(threads, 0);
+    auto worker = [&](unsigned tid) {
+        size_t lo = trace.size() * tid / threads;
+        size_t hi = trace.size() * (tid + 1) / threads;
+        std::vector<uint16_t> actions(batch);
+        uint64_t s = 0;
+        for (int r = 0; r < rounds; ++r) {
+            for (size_t i = lo; i < hi; i += batch) {
+                size_t n = std::min(batch, hi - i);
+                c.classify_batch(trace.data() + i, n, actions.data());
+                for (size_t k = 0; k < n; ++k) s += actions[k];
+            }
+        }
+        sums[tid] = s;
+    };
+
+    auto t0 = std::chrono::steady_clock::now();
+    if (threads == 1) {
+        worker(0);
+    } else {
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker, t);
+        for (auto& th : pool) th.join();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    if (checksum) {
+        *checksum = 0;
+        for (uint64_t s : sums) *checksum += s;
+    }
+    double sec = std::chrono::duration<double>(t1 - t0).count();
+    return sec > 0 ? (double)trace.size() * rounds / sec : 0.0;
+}
@@ -0,0 +1,303 @@
+/** *************************************************************/
+// @Name: DecisionTree.cpp
+// @Function: HiCuts / HyperCuts decision-tree classifier over Rule5D
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Classifier.hpp"
+#include "DecisionTree.hpp"
+
+using namespace std;
+
+static const uint32_t MAX_CUTS_LOG2 = 16;   // 单个节点最多 65536 个子节点
+
+void CutTreeClassifier::build(const std::vector<Rule5D>& rules, const CutTreeConfig& config) {
+    config_ = config;
+    if (config_.binth == 0) config_.binth = 1;
+    rules_.clear();
+    rules_.reserve(rules.size());
+    for (const auto& r : rules) {
+        Box b;
+        for (int d = 0; d < DIMS; ++d) {
+            b.lo[d] = r.range[d][0];
+            b.hi[d] = r.range[d][1];
+        }
+        b.hi[4] = std::min<uint32_t>(b.hi[4], 0xFF);
+        b.action = r.action;
+        rules_.push_back(b);
+    }
+
+    nodes_.clear();
+    child_.clear();
+    leaf_rules_.clear();
+    leaf_cache_.clear();
+    empty_leaf_ = 0xFFFFFFFFu;
+    num_leaves_ = 0;
+    max_depth_ = 0;
+
+    Region root;
+    const uint32_t full_hi[DIMS] = { 0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFF, 0xFFFF, 0xFF };
+    for (int d = 0; d < DIMS; ++d) {
+        root.lo[d] = 0;
+        root.hi[d] = full_hi[d];
+    }
+    std::vector<uint32_t> ids(rules_.size());
+    for (size_t i = 0; i < ids.size(); ++i) ids[i] = static_cast<uint32_t>(i);
+    root_ = build_node(ids, root, 0);
+
+    leaf_cache_.clear();
+    nodes_.shrink_to_fit();
+    child_.shrink_to_fit();
+    leaf_rules_.shrink_to_fit();
+
+    std::cout << "[CutTreeClassifier] Built " << (config_.multi_dim ? "HyperCuts" : "HiCuts")
+              << " (binth " << config_.binth << ", spfac " << config_.spfac << "): "
+              << nodes_.size() << " nodes, " << num_leaves_ << " leaves, depth " << max_depth_
+              << ", " << leaf_rules_.size() << " leaf rule refs, "
+              << memory_bytes() / 1024 << " KB" << std::endl;
+}
+
+uint32_t CutTreeClassifier::make_leaf(const std::vector<uint32_t>& ids) {
+    if (ids.empty() && empty_leaf_ != 0xFFFFFFFFu) return empty_leaf_;
+    auto it = leaf_cache_.find(ids);
+    if (it != leaf_cache_.end()) return it->second;
+
+    Node node;
+    memset(&node, 0, sizeof(node));
+    node.leaf = 1;
+    node.base = static_cast<uint32_t>(leaf_rules_.size());
+    node.count = static_cast<uint32_t>(ids.size());
+    leaf_rules_.insert(leaf_rules_.end(), ids.begin(), ids.end());
+
+    uint32_t index = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(node);
+    leaf_cache_.insert(std::make_pair(ids, index));
+    if (ids.empty()) empty_leaf_ = index;
+    ++num_leaves_;
+    return index;
+}
+
+// 区域内规则投影的段下标范围 [first, last]
+static inline void cut_span(uint32_t lo, uint32_t hi, uint32_t rlo, uint32_t rhi, uint64_t width,
+                            uint32_t& first, uint32_t& last) {
+    first = static_cast<uint32_t>((std::max(lo, rlo) - (uint64_t)lo) / width);
+    last = static_cast<uint32_t>((std::min(hi, rhi) - (uint64_t)lo) / width);
+}
+
+void CutTreeClassifier::choose_cuts(const std::vector<uint32_t>& ids, const Region& region, uint32_t cuts_log2[DIMS]) const {
+    size_t distinct[DIMS] = {0};
+    std::vector<std::pair<uint32_t, uint32_t>> proj;
+    proj.reserve(ids.size());
+    for (int d = 0; d < DIMS; ++d) {
+        cuts_log2[d] = 0;
+        if (region.lo[d] == region.hi[d]) continue;
+        proj.clear();
+        for (uint32_t id : ids) {
+            proj.push_back(std::make_pair(std::max(rules_[id].lo[d], region.lo[d]),
+                                          std::min(rules_[id].hi[d], region.hi[d])));
+        }
+        std::sort(proj.begin(), proj.end());
+        distinct[d] = std::unique(proj.begin(), proj.end()) - proj.begin();
+    }
+
+    // 选维：HiCuts 取投影种类最多的一维；HyperCuts 取不少于平均值的所有维
+    bool chosen[DIMS] = {false};
+    size_t total = 0, cand = 0, best = 0;
+    for (int d = 0; d < DIMS; ++d) {
+        if (distinct[d] <= 1) continue;
+        total += distinct[d];
+        ++cand;
+        if (distinct[d] > distinct[best] || distinct[best] <= 1) best = d;
+    }
+    if (cand == 0) return;
+    if (config_.multi_dim) {
+        for (int d = 0; d < DIMS; ++d) chosen[d] = distinct[d] > 1 && distinct[d] * cand >= total;
+    } else {
+        chosen[best] = true;
+    }
+
+    // 每维切割数：从 2 开始倍增，直到 sum(子节点规则数) + 子节点数 > spfac * N
+    const double budget = config_.spfac * ids.size();
+    uint32_t sum_log2 = 0;
+    for (int d = 0; d < DIMS; ++d) {
+        if (!chosen[d]) continue;
+        uint64_t size = (uint64_t)region.hi[d] - region.lo[d] + 1;
+        uint32_t lg = 1;
+        while (lg < MAX_CUTS_LOG2 && (2ULL << lg) <= size) {
+            uint64_t nc = 2ULL << lg;
+            uint64_t width = (size + nc - 1) / nc;
+            uint64_t sm = nc;
+            for (uint32_t id : ids) {
+                uint32_t first, last;
+                cut_span(region.lo[d], region.hi[d], rules_[id].lo[d], rules_[id].hi[d], width, first, last);
+                sm += last - first + 1;
+            }
+            if (sm > budget) break;
+            ++lg;
+        }
+        cuts_log2[d] = lg;
+        sum_log2 += lg;
+    }
+
+    // HyperCuts：子节点总数不超过 spfac * sqrt(N)（至少 2），超出时减少切割最多的维
+    uint32_t cap_log2 = MAX_CUTS_LOG2;
+    if (config_.multi_dim) {
+        double cap = std::max(2.0, config_.spfac * std::sqrt((double)ids.size()));
+        cap_log2 = std::max<uint32_t>(1, static_cast<uint32_t>(std::floor(std::log2(cap))));
+    }
+    while (sum_log2 > std::min(cap_log2, MAX_CUTS_LOG2)) {
+        int widest = -1;
+        for (int d = 0; d < DIMS; ++d) {
+            if (cuts_log2[d] > 0 && (widest < 0 || cuts_log2[d] > cuts_log2[widest])) widest = d;
+        }
+        --cuts_log2[widest];
+        --sum_log2;
+    }
+}
+
+uint32_t CutTreeClassifier::build_node(std::vector<uint32_t>& ids, Region region, uint32_t depth) {
+    max_depth_ = std::max<size_t>(max_depth_, depth);
+
+    // 覆盖整个区域的规则之后的规则永远不会被选中
+    for (size_t k = 0; k < ids.size(); ++k) {
+        const Box& b = rules_[ids[k]];
+        bool covers = true;
+        for (int d = 0; d < DIMS && covers; ++d) {
+            covers = b.lo[d] <= region.lo[d] && b.hi[d] >= region.hi[d];
+        }
+        if (covers) {
+            ids.resize(k + 1);
+            break;
+        }
+    }
+    if (ids.size() <= config_.binth || depth >= config_.max_depth) return make_leaf(ids);
+
+    // 区域压缩到规则包围盒
+    for (int d = 0; d < DIMS; ++d) {
+        uint32_t lo = 0xFFFFFFFFu, hi = 0;
+        for (uint32_t id : ids) {
+            lo = std::min(lo, rules_[id].lo[d]);
+            hi = std::max(hi, rules_[id].hi[d]);
+        }
+        region.lo[d] = std::max(region.lo[d], lo);
+        region.hi[d] = std::min(region.hi[d], hi);
+    }
+
+    uint32_t cuts_log2[DIMS];
+    choose_cuts(ids, region, cuts_log2);
+
+    Node node;
+    memset(&node, 0, sizeof(node));
+    uint32_t total_log2 = 0;
+    for (int d = 0; d < DIMS; ++d) {
+        node.cuts_log2[d] = static_cast<uint8_t>(cuts_log2[d]);
+        node.lo[d] = region.lo[d];
+        if (cuts_log2[d] == 0) continue;
+        uint64_t size = (uint64_t)region.hi[d] - region.lo[d] + 1;
+        node.width[d] = static_cast<uint32_t>((size + (1ULL << cuts_log2[d]) - 1) >> cuts_log2[d]);
+        total_log2 += cuts_log2[d];
+    }
+    if (total_log2 == 0) return make_leaf(ids);
+
+    // 把每条规则放进它覆盖的所有子节点（混合进制下标，维度 0 在最高位）
+    size_t n_child = (size_t)1 << total_log2;
+    std::vector<std::vector<uint32_t>> children(n_child);
+    uint32_t first[DIMS], last[DIMS], cur[DIMS];
+    for (uint32_t id : ids) {
+        for (int d = 0; d < DIMS; ++d) {
+            first[d] = last[d] = 0;
+            if (cuts_log2[d]) cut_span(region.lo[d], region.hi[d], rules_[id].lo[d], rules_[id].hi[d], node.width[d], first[d], last[d]);
+            cur[d] = first[d];
+        }
+        while (true) {
+            size_t idx = 0;
+            for (int d = 0; d < DIMS; ++d) idx = (idx << cuts_log2[d]) | cur[d];
+            children[idx].push_back(id);
+            int d = DIMS - 1;
+            while (d >= 0 && cur[d] == last[d]) {
+                cur[d] = first[d];
+                --d;
+            }
+            if (d < 0) break;
+            ++cur[d];
+        }
+    }
+
+    // 没有任何子节点变小时切割无效
+    bool progress = false;
+    for (const auto& c : children) {
+        if (c.size() < ids.size()) {
+            progress = true;
+            break;
+        }
+    }
+    if (!progress) return make_leaf(ids);
+
+    node.leaf = 0;
+    node.base = static_cast<uint32_t>(child_.size());
+    child_.resize(child_.size() + n_child);
+    uint32_t index = static_cast<uint32_t>(nodes_.size());
+    nodes_.push_back(node);
+    std::vector<uint32_t>().swap(ids);
+
+    for (size_t i = 0; i < n_child; ++i) {
+        Region sub = region;
+        size_t rest = i;
+        for (int d = DIMS - 1; d >= 0; --d) {
+            if (cuts_log2[d] == 0) continue;
+            uint64_t k = rest & ((1u << cuts_log2[d]) - 1);
+            rest >>= cuts_log2[d];
+            uint64_t lo = (uint64_t)region.lo[d] + k * node.width[d];
+            uint64_t hi = std::min<uint64_t>(region.hi[d], lo + node.width[d] - 1);
+            sub.lo[d] = static_cast<uint32_t>(std::min<uint64_t>(lo, region.hi[d]));
+            sub.hi[d] = static_cast<uint32_t>(hi);
+        }
+        uint32_t c = children[i].empty() ? make_leaf(children[i]) : build_node(children[i], sub, depth + 1);
+        child_[node.base + i] = c;
+        std::vector<uint32_t>().swap(children[i]);
+    }
+    return index;
+}
+
+MatchResult CutTreeClassifier::classify(const Tuple5& t) const {
+    const uint32_t v[DIMS] = { t.src_ip, t.dst_ip, t.src_port, t.dst_port, t.proto };
+    MatchResult miss = { NO_MATCH_RULE, 0 };
+    if (nodes_.empty()) return miss;
+
+    const Node* n = &nodes_[root_];
+    while (!n->leaf) {
+        uint32_t idx = 0;
+        for (int d = 0; d < DIMS; ++d) {
+            uint32_t lg = n->cuts_log2[d];
+            if (lg == 0) continue;
+            if (v[d] < n->lo[d]) return miss;
+            uint32_t k = (v[d] - n->lo[d]) / n->width[d];
+            if (k >> lg) return miss;
+            idx = (idx << lg) | k;
+        }
+        n = &nodes_[child_[n->base + idx]];
+    }
+
+    for (uint32_t k = n->base; k < n->base + n->count; ++k) {
+        const Box& b = rules_[leaf_rules_[k]];
+        bool hit = true;
+        for (int d = 0; d < DIMS && hit; ++d) hit = v[d] >= b.lo[d] && v[d] <= b.hi[d];
+        if (hit) {
+            MatchResult m = { leaf_rules_[k], b.action };
+            return m;
+        }
+    }
+    return miss;
+}
+
+size_t CutTreeClassifier::memory_bytes() const {
+    return rules_.capacity() * sizeof(Box) +
+           nodes_.capacity() * sizeof(Node) +
+           child_.capacity() * sizeof(uint32_t) +
+           leaf_rules_.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "Loader.hpp"
+#include "Classifier.hpp"
+
+// ---------------HiCuts / HyperCuts Decision Tree---------------------
+// 直接由 Rule5D 构建的决策树分类器，作为与拆表方案对比的基线：
+//   - HiCuts：每个节点选一个维度（投影区间种类最多者）等分切割
+//   - HyperCuts：同时切割投影种类不少于平均值的多个维度
+// 切割数按 space factor 启发式倍增：子节点规则数之和 + 子节点数 <= spfac * N，
+// HyperCuts 另限制子节点总数 <= spfac * sqrt(N)。规则数 <= binth 时成为叶子，叶子内线性扫描。
+// 构建时做区域压缩（节点区域收缩到规则包围盒）并删除被覆盖整个区域的高优先级规则遮挡的规则。
+// 节点连续存放在 nodes_ 中，子节点通过 32 位下标引用（child_ 池），相同规则集的叶子共享
+struct CutTreeConfig {
+    uint32_t binth = 8;        // 叶子最多规则数
+    double   spfac = 4.0;      // space factor
+    bool     multi_dim = true; // true: HyperCuts，false: HiCuts
+    uint32_t max_depth = 64;   // 超过后强制成为叶子
+};
+
+class CutTreeClassifier {
+public:
+    void build(const std::vector<Rule5D>& rules, const CutTreeConfig& config = CutTreeConfig());
+
+    MatchResult classify(const Tuple5& t) const;
+
+    size_t entries() const { return rules_.size(); }
+    size_t nodes() const { return nodes_.size(); }
+    size_t leaves() const { return num_leaves_; }
+    size_t depth() const { return max_depth_; }
+    size_t stored_rules() const { return leaf_rules_.size(); }
+    size_t memory_bytes() const;
+
+private:
+    static const int DIMS = 5;
+
+    struct Box {
+        uint32_t lo[DIMS], hi[DIMS];
+        uint16_t action;
+    };
+
+    struct Node {
+        uint32_t lo[DIMS];        // 区域起点（仅切割维度有意义）
+        uint32_t width[DIMS];     // 每段宽度
+        uint8_t  cuts_log2[DIMS]; // 0 表示该维不切
+        uint8_t  leaf;
+        uint32_t base;            // 内部节点：child_ 起点；叶子：leaf_rules_ 起点
+        uint32_t count;           // 叶子规则数
+    };
+
+    struct Region {
+        uint32_t lo[DIMS], hi[DIMS];
+    };
+
+    uint32_t build_node(std::vector<uint32_t>& ids, Region region, uint32_t depth);
+    uint32_t make_leaf(const std::vector<uint32_t>& ids);
+    void choose_cuts(const std::vector<uint32_t>& ids, const Region& region, uint32_t cuts_log2[DIMS]) const;
+
+    CutTreeConfig config_;
+    std::vector<Box> rules_;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> child_;       // 子节点下标，按混合进制排列
+    std::vector<uint32_t> leaf_rules_;  // 叶子中的规则下标，升序（优先级顺序）
+    std::map<std::vector<uint32_t>, uint32_t> leaf_cache_;   // 仅构建期间使用
+    uint32_t empty_leaf_ = 0xFFFFFFFFu;                       // 空叶子（最常见）不走 map
+    uint32_t root_ = 0;
+    size_t num_leaves_ = 0;
+    size_t max_depth_ = 0;
+};
@@ -0,0 +1,349 @@
+/** *************************************************************/
+// @Name: DiffCheck.cpp
+// @Function: Differential check of TCAM / IP + LRME tables against a linear-scan oracle
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "Classifier.hpp"
+#include "Trace.hpp"
+#include "Checker.hpp"
+#include "DecisionTree.hpp"
+#include "TupleSpace.hpp"
+#include "Incremental.hpp"
+#include "RangeEncoding.hpp"
+#include "TCAMMinimize.hpp"
+
+using namespace std;
+
+struct CheckOptions {
+    string rules_path = "src/ACL_rules/acl_10k.rules";
+    size_t random_packets = 1000000;
+    size_t boundary_packets = 1000000;
+    uint32_t seed = 1;
+    unsigned threads = 0;
+    size_t max_print = 10;
+    string dump_prefix;
+    size_t prefix_samples = 1u << 22;   // 0 跳过；--prefix-check all 穷举
+    bool prefix_exhaustive = false;
+    string pipelines = "simd,tcam,lrme,lrme-coalesce,rfc,hicuts,hypercuts,tss,incr,tcam-srge,tcam-dirpe,tcam-layered,tcam-min,tcam-min-action";
+};
+
+static void print_usage() {
+    cout << "usage: diffcheck [rules_or_snapshot]\n"
+         << "                 [--random N] [--boundary N] [--seed N] [--threads N]\n"
+         << "                 [--print N] [--dump PREFIX] [--pipelines simd,tcam,lrme,lrme-coalesce,rfc,hicuts,hypercuts,tss,incr,\n"
+         << "                  tcam-srge,tcam-dirpe,tcam-layered,tcam-min,tcam-min-action]\n"
+         << "                 [--prefix-check N|all]\n";
+}
+
+static bool parse_args(int argc, char **argv, CheckOptions& opt) {
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        bool has_val = i + 1 < argc;
+        if (arg == "-h" || arg == "--help") {
+            return false;
+        } else if (arg == "--random" && has_val) {
+            opt.random_packets = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--boundary" && has_val) {
+            opt.boundary_packets = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && has_val) {
+            opt.seed = static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--threads" && has_val) {
+            opt.threads = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--print" && has_val) {
+            opt.max_print = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--dump" && has_val) {
+            opt.dump_prefix = argv[++i];
+        } else if (arg == "--prefix-check" && has_val) {
+            string v = argv[++i];
+            opt.prefix_exhaustive = v == "all";
+            opt.prefix_samples = opt.prefix_exhaustive ? 0 : strtoull(v.c_str(), nullptr, 10);
+        } else if (arg == "--pipelines" && has_val) {
+            opt.pipelines = argv[++i];
+        } else if (!arg.empty() && arg[0] == '-') {
+            cerr << "[ERROR] Unknown option: " << arg << endl;
+            return false;
+        } else {
+            opt.rules_path = arg;
+        }
+    }
+    return true;
+}
+
+static bool pipeline_enabled(const CheckOptions& opt, const string& name) {
+    string list = "," + opt.pipelines + ",";
+    return list.find("," + name + ",") != string::npos;
+}
+
+// 对一个被测分类器跑 random + boundary 两段 trace，返回不一致总数；
+// action_only 时只计 action（及命中 / 未命中）不同的包
+template <typename Oracle, typename Candidate>
+static size_t check_pipeline(const string& name, const Oracle& oracle, const Candidate& c,
+                             const vector<Tuple5>& random_trace, const vector<Tuple5>& boundary_trace,
+                             const vector<Rule5D>& rules, const CheckOptions& opt, bool action_only = false) {
+    size_t total = 0;
+    const pair<string, const vector<Tuple5>*> traces[] = {
+        {name + "/random", &random_trace},
+        {name + "/boundary", &boundary_trace}
+    };
+    for (const auto& tr : traces) {
+        auto t0 = chrono::steady_clock::now();
+        DiffReport rep = differential_check(oracle, c, *tr.second, opt.threads);
+        double sec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        print_diff_report(tr.first, rep, rules, opt.max_print);
+        cout << "[" << tr.first << "] " << fixed << setprecision(2) << sec << " s\n\n";
+        cout.unsetf(ios::fixed);
+        if (!opt.dump_prefix.empty()) {
+            string file = opt.dump_prefix + "_" + name + "_" + (tr.second == &random_trace ? "random" : "boundary") + ".txt";
+            if (write_disagreements(rep, file)) {
+                cout << "[SUCCESS] Disagreements written to: " << file << "\n\n";
+            }
+        }
+        total += action_only ? rep.action_mismatch : rep.disagreements.size();
+    }
+    return total;
+}
+
+int main(int argc, char **argv)
+{
+    CheckOptions opt;
+    if (!parse_args(argc, argv, opt)) {
+        print_usage();
+        return 1;
+    }
+    if (opt.threads == 0) opt.threads = std::max(1u, std::thread::hardware_concurrency());
+
+    cout << "============================================================================\n";
+    cout << "--------------------------PortCatcher DiffCheck-----------------------------\n";
+    cout << "============================================================================\n\n";
+
+    vector<Rule5D> rules;
+    try {
+        load_rules(opt.rules_path, rules);
+    } catch (const std::exception &e) {
+        cerr << "[ERROR] Failed to load rules: " << e.what() << endl;
+        return 1;
+    }
+    cout << "[SUCCESS] Loaded " << rules.size() << " rules from " << opt.rules_path << "\n";
+
+    // 随机 trace 一半命中规则内部，一半为均匀随机 5 元组
+    TraceConfig cfg;
+    cfg.packets = opt.random_packets;
+    cfg.hit_ratio = 0.5;
+    cfg.seed = opt.seed;
+    vector<Tuple5> random_trace = generate_trace(rules, cfg);
+    vector<Tuple5> boundary_trace = generate_boundary_trace(rules, opt.boundary_packets, opt.seed + 1);
+    cout << "[SUCCESS] " << random_trace.size() << " random + " << boundary_trace.size()
+         << " boundary packets, " << opt.threads << " threads\n\n";
+
+    LinearScanClassifier oracle;
+    oracle.build(rules);
+    size_t disagreements = 0;
+
+    // TCAM 展开使用的端口范围 -> 前缀内核
+    if (opt.prefix_exhaustive || opt.prefix_samples > 0) {
+        auto t0 = chrono::steady_clock::now();
+        PrefixCheckReport rep = check_port_prefix_kernel(opt.prefix_exhaustive ? 0 : opt.prefix_samples, opt.seed, opt.threads);
+        double sec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+        cout << "[port_range_to_prefixes] " << (opt.prefix_exhaustive ? "exhaustive" : "stratified") << ": checked "
+             << rep.checked << " ranges, failures " << rep.failures << ", max prefixes " << rep.max_prefixes
+             << ", " << fixed << setprecision(2) << sec << " s\n";
+        cout.unsetf(ios::fixed);
+        if (rep.failures) {
+            cout << "  first failure: [" << rep.first_bad_lo << ", " << rep.first_bad_hi << "]\n";
+        }
+        cout << "\n";
+        disagreements += rep.failures;
+    }
+
+    if (pipeline_enabled(opt, "simd")) {
+        SimdLinearClassifier c;
+        c.build(rules);
+        cout << "[SimdLinearClassifier] level: " << simd_level_name(c.level()) << "\n";
+        disagreements += check_pipeline("simd", oracle, c, random_trace, boundary_trace, rules, opt);
+    }
+
+    const char* const cut_pipelines[] = { "hicuts", "hypercuts" };
+    for (int k = 0; k < 2; ++k) {
+        if (!pipeline_enabled(opt, cut_pipelines[k])) continue;
+        CutTreeConfig cfg;
+        cfg.multi_dim = k == 1;
+        CutTreeClassifier c;
+        c.build(rules, cfg);
+        disagreements += check_pipeline(cut_pipelines[k], oracle, c, random_trace, boundary_trace, rules, opt);
+    }
+
+    // 元组空间：打乱顺序插入，再删除并插回一半规则，检查增删后的结果
+    if (pipeline_enabled(opt, "tss")) {
+        vector<uint32_t> order(rules.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<uint32_t>(i);
+        std::mt19937 rng(opt.seed);
+        std::shuffle(order.begin(), order.end(), rng);
+        TupleSpaceClassifier c;
+        for (uint32_t id : order) c.insert(id, rules[id]);
+        order.resize(order.size() / 2);
+        for (uint32_t id : order) c.erase(id);
+        std::shuffle(order.begin(), order.end(), rng);
+        for (uint32_t id : order) c.insert(id, rules[id]);
+        cout << "[TupleSpaceClassifier] " << c.entries() << " rules in " << c.tuples() << " tuples after churn\n";
+        disagreements += check_pipeline("tss", oracle, c, random_trace, boundary_trace, rules, opt);
+    }
+
+    if (pipeline_enabled(opt, "tcam")) {
+        vector<TCAM_Entry> tcam_entries;
+        TCAM_Port_Expansion(rules, tcam_entries);
+        TCAMClassifier c;
+        c.build(tcam_entries);
+        disagreements += check_pipeline("tcam", oracle, c, random_trace, boundary_trace, rules, opt);
+    }
+
+    // TCAM 表项压缩：以压缩前的 TCAM 表为 oracle，exact 要求 rule_id 与 action 都不变，action 只要求 action 不变
+    if (pipeline_enabled(opt, "tcam-min") || pipeline_enabled(opt, "tcam-min-action")) {
+        vector<TCAM_Entry> tcam_entries;
+        TCAM_Port_Expansion(rules, tcam_entries);
+        TCAMClassifier full;
+        full.build(tcam_entries);
+        const TCAMMinimizeMode modes[] = { TCAM_MIN_EXACT, TCAM_MIN_ACTION };
+        for (TCAMMinimizeMode mode : modes) {
+            string name = mode == TCAM_MIN_EXACT ? "tcam-min" : "tcam-min-action";
+            if (!pipeline_enabled(opt, name)) continue;
+            vector<TCAM_Entry> minimized = tcam_entries;
+            TCAM_Minimize_Entries(minimized, mode);
+            TCAMClassifier c;
+            c.build(minimized);
+            disagreements += check_pipeline(name, full, c, random_trace, boundary_trace, rules, opt, mode == TCAM_MIN_ACTION);
+        }
+    }
+
+    // 三态范围编码：端口经编码器转换为 key 后按表项顺序比较
+    const RangeEncoding encodings[] = { ENC_SRGE, ENC_DIRPE, ENC_LAYERED };
+    for (RangeEncoding enc : encodings) {
+        string name = string("tcam-") + range_encoding_name(enc);
+        if (!pipeline_enabled(opt, name)) continue;
+        RangeEncodingConfig cfg;
+        cfg.encoding = enc;
+        PortRangeEncoder src_encoder, dst_encoder;
+        vector<TernaryTCAMEntry> tcam_entries;
+        TCAM_Encoded_Expansion(rules, cfg, src_encoder, dst_encoder, tcam_entries);
+        EncodedTCAMClassifier c;
+        c.build(tcam_entries, src_encoder, dst_encoder);
+        disagreements += check_pipeline(name, oracle, c, random_trace, boundary_trace, rules, opt);
+    }
+
+    bool want_lrme = pipeline_enabled(opt, "lrme") || pipeline_enabled(opt, "lrme-coalesce");
+    if (want_lrme || pipeline_enabled(opt, "rfc")) {
+        vector<IPRule> ip_table;
+        vector<PortRule> port_table;
+        split_rules(rules, ip_table, port_table);
+        vector<MergrdR> merged_ip_table;
+        MergedItemTable metainfo;
+        load_and_create_IP_table(ip_table, port_table, merged_ip_table, metainfo);
+        vector<LRME_Entry> lrme_entries;
+        PortBlockTable optimal_metainfo = Caculate_LRME_for_Port_Table(metainfo, false, &lrme_entries);
+        vector<IP_Table_Entry> final_ip_table;
+        create_final_IP_table(merged_ip_table, optimal_metainfo, final_ip_table);
+        if (pipeline_enabled(opt, "lrme")) {
+            LRMEClassifier c;
+            c.build(merged_ip_table, final_ip_table, lrme_entries, optimal_metainfo);
+            disagreements += check_pipeline("lrme", oracle, c, random_trace, boundary_trace, rules, opt);
+        }
+        // --coalesce 的 LRME 表：与 Caculate_LRME_for_Port_Table(metainfo, true) 相同的步骤，只是不重写 Port_table.txt
+        if (pipeline_enabled(opt, "lrme-coalesce")) {
+            vector<PortBlock> subset;
+            Create_Port_Block_Subset(optimal_metainfo, subset);
+            vector<LRME_Entry> coalesced = Coalesce_LRME_Entries(subset);
+            LRMEClassifier c;
+            c.build(merged_ip_table, final_ip_table, coalesced, optimal_metainfo);
+            disagreements += check_pipeline("lrme-coalesce", oracle, c, random_trace, boundary_trace, rules, opt);
+        }
+        if (pipeline_enabled(opt, "rfc")) {
+            RFCPortClassifier c;
+            if (c.build(merged_ip_table, final_ip_table, metainfo)) {
+                disagreements += check_pipeline("rfc", oracle, c, random_trace, boundary_trace, rules, opt);
+            }
+        }
+    }
+
+    // 增量编译：先全量加载一半规则，再逐条加入其余规则、删除并插回 20%，
+    // 每次的 delta 回放到交换机镜像上，最后镜像须与编译器状态一致，导出的表须与 oracle 一致
+    if (pipeline_enabled(opt, "incr")) {
+        vector<uint32_t> order(rules.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<uint32_t>(i);
+        std::mt19937 rng(opt.seed);
+        std::shuffle(order.begin(), order.end(), rng);
+        size_t half = order.size() / 2;
+        vector<uint32_t> initial(order.begin(), order.begin() + half);
+        sort(initial.begin(), initial.end());
+        vector<Rule5D> initial_rules;
+        for (uint32_t id : initial) initial_rules.push_back(rules[id]);
+
+        IncrementalCompiler inc;
+        inc.load(initial_rules);
+        TableDelta delta;
+        inc.full_delta(delta);
+        TableImage image;
+        bool replay_ok = apply_table_delta(delta, image);
+        TableImage first_image = image;
+
+        size_t updates = 0, changes = 0;
+        auto t0 = chrono::steady_clock::now();
+        auto step = [&](bool add, uint32_t id) {
+            delta.clear();
+            bool ok = add ? inc.add_rule(rules[id], delta) : inc.remove_rule(rules[id].priority, delta);
+            if (!ok) {
+                cerr << "[WARN] [incr] " << (add ? "add" : "remove") << " of rule " << id << " rejected" << endl;
+                replay_ok = false;
+            }
+            replay_ok = apply_table_delta(delta, image) && replay_ok;
+            updates++;
+            changes += delta.size();
+        };
+        for (size_t i = half; i < order.size(); ++i) step(true, order[i]);
+        std::shuffle(order.begin(), order.end(), rng);
+        order.resize(order.size() / 5);
+        for (uint32_t id : order) step(false, id);
+        std::shuffle(order.begin(), order.end(), rng);
+        for (uint32_t id : order) step(true, id);
+        double sec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+
+        TableImage expect;
+        inc.snapshot(expect);
+        if (!same_table_image(image, expect)) replay_ok = false;
+        // 版本差分：首个版本 -> 最终版本的 delta 回放后也须得到最终状态
+        delta.clear();
+        diff_table_images(first_image, expect, delta);
+        if (!apply_table_delta(delta, first_image) || !same_table_image(first_image, expect)) replay_ok = false;
+        cout << "[IncrementalCompiler] " << updates << " updates in " << fixed << setprecision(3) << sec
+             << " s (" << setprecision(1) << (sec > 0 ? updates / sec : 0.0) << " /s), "
+             << changes << " table changes, " << inc.lrmids() << " LRMIDs, " << inc.lrme_entries()
+             << " LRME entries, delta replay " << (replay_ok ? "consistent" : "INCONSISTENT") << "\n";
+        cout.unsetf(ios::fixed);
+        if (!replay_ok) disagreements++;
+
+        vector<Rule5D> cur_rules;
+        vector<MergrdR> merged_ip_table;
+        MergedItemTable metainfo;
+        PortBlockTable optimal_metainfo;
+        vector<IP_Table_Entry> final_ip_table;
+        vector<LRME_Entry> lrme_entries;
+        inc.export_tables(cur_rules, merged_ip_table, metainfo, optimal_metainfo, final_ip_table, lrme_entries);
+        LRMEClassifier c;
+        c.build(merged_ip_table, final_ip_table, lrme_entries, optimal_metainfo);
+        disagreements += check_pipeline("incr", oracle, c, random_trace, boundary_trace, rules, opt);
+    }
+
+    cout << "============================================================================\n";
+    if (disagreements == 0) {
+        cout << "DiffCheck passed: all pipelines agree with the linear-scan oracle\n";
+    } else {
+        cout << "DiffCheck found " << disagreements << " disagreements\n";
+    }
+    cout << "============================================================================\n";
+    return disagreements == 0 ? 0 : 2;
+}
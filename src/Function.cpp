@@ -20,22 +20,20 @@ void merge_same_ip_entry(
 ) {
     merged_ip_table.clear();
 
-    std::map<
-        std::tuple<uint32_t,uint32_t,uint32_t,uint32_t,uint8_t>,
-        size_t
-    > key_to_index;
+    FlatKeyIndex<IPKey, IPKeyHash> key_to_index(ip_table.size());
 
     // Step 1: 合并相同的 Src_IP, Dst_IP, Protocol 的规则
     for (size_t i = 0; i < ip_table.size(); ++i) {
         const auto &rule = ip_table[i];
-        auto key = std::make_tuple(
+        IPKey key = {
             rule.src_ip_lo, rule.src_ip_hi,
             rule.dst_ip_lo, rule.dst_ip_hi,
             rule.proto
-        );
+        };
 
-        auto it = key_to_index.find(key);
-        if (it == key_to_index.end()) {
+        uint32_t next = static_cast<uint32_t>(merged_ip_table.size());
+        uint32_t idx = key_to_index.find_or_insert(key, next);
+        if (idx == next) {
             // 创建新的 MergrdR 规则
             MergrdR new_rule;
             new_rule.Src_IP_lo = rule.src_ip_lo;
@@ -47,11 +45,9 @@ void merge_same_ip_entry(
             new_rule.merged_R.clear();
             new_rule.merged_R.push_back(i);  // 记录原始规则索引
 
-            merged_ip_table.push_back(new_rule);
-            key_to_index[key] = merged_ip_table.size() - 1;
+            merged_ip_table.push_back(std::move(new_rule));
         } else {
             // 添加到已存在的合并规则中
-            size_t idx = it->second;
             merged_ip_table[idx].merged_R.push_back(i);
         }
     }
@@ -69,18 +65,16 @@ void merge_same_ip_entry(
 void Create_metainfo(
     const std::vector<MergrdR>& merged_ip_table,
     const std::vector<PortRule>& port_table,
-    std::map<uint32_t, std::vector<MergedItem>>& metainfo
+    MergedItemTable& metainfo
 ) {
     metainfo.clear();
+    metainfo.reserve(merged_ip_table.size(), port_table.size());
 
-    // 遍历每个合并后的 IP 规则
+    // 遍历每个合并后的 IP 规则（merged_ip_table 按 LRMID 从 0 递增排列）
     for (const auto& merged_rule : merged_ip_table) {
         // 1) 提取 LRMID
         uint32_t lrmid = merged_rule.LRMID;
         
-        // 为这个 LRMID 创建 MergedItem 向量
-        std::vector<MergedItem> items;
-        
         // 2) 遍历 merged_R 中的每个原始规则索引
         for (size_t orig_idx : merged_rule.merged_R) {
             // 检查索引是否有效
@@ -102,25 +96,21 @@ void Create_metainfo(
             item.Dst_Port_hi = port_rule.dst_port_hi;
             item.action = port_rule.action;
             
-            items.push_back(item);
+            metainfo.push_item(item);
         }
         
-        // 将这个 LRMID 对应的所有端口项添加到 metainfo
-        metainfo[lrmid] = items;
+        // 封口：这个 LRMID 对应的所有端口项写入完毕
+        metainfo.end_group();
     }
 
     std::cout << "[Create_metainfo] Created metainfo for " << metainfo.size() 
               << " LRMIDs (total port entries: ";
-    size_t total_entries = 0;
-    for (const auto& pair : metainfo) {
-        total_entries += pair.second.size();
-    }
-    std::cout << total_entries << ")" << std::endl;
+    std::cout << metainfo.total_items() << ")" << std::endl;
 }
 
 
 void output_metainfo(
-    const std::map<uint32_t, std::vector<MergedItem>>& metainfo,
+    const MergedItemTable& metainfo,
     const std::string& output_file
 ) {
     std::ofstream ofs(output_file);
@@ -160,19 +150,15 @@ void output_metainfo(
     ofs.close();
     
     // 统计信息
-    size_t total_entries = 0;
-    for (const auto& entry : metainfo) {
-        total_entries += entry.second.size();
-    }
     std::cout << "[output_metainfo] Wrote metainfo to: " << output_file 
-              << " (" << total_entries << " entries)" << std::endl;
+              << " (" << metainfo.total_items() << " entries)" << std::endl;
 }
 
 void load_and_create_IP_table(
     std::vector<IPRule>& ip_table,
     std::vector<PortRule>& port_table, 
     std::vector<MergrdR>& merged_ip_table,
-    std::map<uint32_t, std::vector<MergedItem>>& metainfo
+    MergedItemTable& metainfo
 ) {
     // 1) merge identical IP entries
     merge_same_ip_entry(ip_table, merged_ip_table);
@@ -185,90 +171,198 @@ void load_and_create_IP_table(
 }
 
 
-std::map<uint32_t, std::vector<PortBlock>> Optimal_for_Port_Table(
-    const std::map<uint32_t, std::vector<MergedItem>>& metainfo
+PortBlockTable Optimal_for_Port_Table(
+    const MergedItemTable& metainfo
 ) {
-    std::map<uint32_t, std::vector<PortBlock>> optimal_metainfo;
+    PortBlockTable optimal_metainfo;
     optimal_metainfo.clear();
+    optimal_metainfo.reserve(metainfo.size(), metainfo.total_items());
     
     // 遍历所有 LRMID 及其对应的 MergedItem 列表
     for (const auto& entry : metainfo) {
         uint32_t lrmid = entry.first;
         const auto& items = entry.second;
         
-        std::vector<PortBlock> port_blocks;
-        
         // 处理每个 MergedItem
         for (const auto& item : items) {
-            PortBlock block;
-            block.LRMID = lrmid;
-            block.action = item.action;
-            block.REV_Flag = false;  // 默认为 false
-            block.ANY_Flag = 0;      // 默认为 0（不包含 ANY）
+            optimal_metainfo.push_item(make_port_block(lrmid, item));
+        }
+        
+        optimal_metainfo.end_group();
+    }
+    
+    return optimal_metainfo;
+}
+
+PortBlock make_port_block(uint32_t lrmid, const MergedItem& item) {
+    PortBlock block;
+    block.LRMID = lrmid;
+    block.action = item.action;
+    block.REV_Flag = false;  // 默认为 false
+    block.REV_Side = 0;
+    block.ANY_Flag = 0;      // 默认为 0（不包含 ANY）
+    
+    bool src_is_any = false;
+    bool dst_is_any = false;
+    
+    // 处理源端口范围
+    if (item.Src_Port_lo == 0 && item.Src_Port_hi == 65535) {
+        // 规则1: 0-65535 变为 0
+        block.Src_Port_lo = 0;
+        block.Src_Port_hi = 0;
+        src_is_any = true;
+    } else if (item.Src_Port_lo == 1024 && item.Src_Port_hi == 65535) {
+        // 规则2: 1024-65535 变为 0-1023，并设置 REV_Flag
+        block.Src_Port_lo = 0;
+        block.Src_Port_hi = 1023;
+        block.REV_Flag = true;
+        block.REV_Side |= 1;
+    } else {
+        // 保持原端口范围
+        block.Src_Port_lo = item.Src_Port_lo;
+        block.Src_Port_hi = item.Src_Port_hi;
+    }
+    
+    // 处理目标端口范围
+    if (item.Dst_Port_lo == 0 && item.Dst_Port_hi == 65535) {
+        // 规则1: 0-65535 变为 0
+        block.Dst_Port_lo = 0;
+        block.Dst_Port_hi = 0;
+        dst_is_any = true;
+    } else if (item.Dst_Port_lo == 1024 && item.Dst_Port_hi == 65535) {
+        // 规则2: 1024-65535 变为 0-1023，并设置 REV_Flag
+        block.Dst_Port_lo = 0;
+        block.Dst_Port_hi = 1023;
+        block.REV_Flag = true;
+        block.REV_Side |= 2;
+    } else {
+        // 保持原端口范围
+        block.Dst_Port_lo = item.Dst_Port_lo;
+        block.Dst_Port_hi = item.Dst_Port_hi;
+    }
+    
+    // 设置 ANY_Flag
+    // 0: 不包含 ANY
+    // 1: 仅源端口是 ANY
+    // 2: 仅目标端口是 ANY
+    // 3: 源端口和目标端口都是 ANY
+    if (src_is_any && dst_is_any) {
+        block.ANY_Flag = 3;
+    } else if (src_is_any) {
+        block.ANY_Flag = 1;
+    } else if (dst_is_any) {
+        block.ANY_Flag = 2;
+    } else {
+        block.ANY_Flag = 0;
+    }
+    return block;
+}
+
+// 把一个 PortBlock 按 32 端口区间切分，结果追加到 PortBlock_Subset
+void Split_Port_Block(
+    const PortBlock& block,
+    std::vector<PortBlock>& PortBlock_Subset
+) {
+    // 全端口（0-65535）由 ANY_Flag 标记：bit0 源端口，bit1 目的端口。
+    // 不能按 0-0 判断，否则字面端口 0 的规则会被当成 ANY
+    bool src_is_any = (block.ANY_Flag & 1) != 0;
+    bool dst_is_any = (block.ANY_Flag & 2) != 0;
+    
+    // 如果源端口和目标端口都是全端口，保存原规则
+    if (src_is_any && dst_is_any) {
+        PortBlock_Subset.push_back(block);
+        return;
+    }
+    
+    // 计算源端口和目标端口的分块范围
+    std::vector<std::pair<uint16_t, uint16_t>> src_blocks;
+    std::vector<std::pair<uint16_t, uint16_t>> dst_blocks;
+    
+    // 分块源端口范围
+    if (src_is_any) {
+        // 全端口不分块，直接使用 0
+        src_blocks.push_back({0, 0});
+    } else {
+        uint16_t src_start = block.Src_Port_lo;
+        uint16_t src_end = block.Src_Port_hi;
+        
+        while (src_start <= src_end) {
+            uint16_t block_start = src_start;
+            uint16_t block_end;
             
-            bool src_is_any = false;
-            bool dst_is_any = false;
+            // 计算当前 32 的倍数区间
+            uint16_t sp = src_start / 32;
+            uint16_t next_boundary = (sp + 1) * 32;
             
-            // 处理源端口范围
-            if (item.Src_Port_lo == 0 && item.Src_Port_hi == 65535) {
-                // 规则1: 0-65535 变为 0
-                block.Src_Port_lo = 0;
-                block.Src_Port_hi = 0;
-                src_is_any = true;
-            } else if (item.Src_Port_lo == 1024 && item.Src_Port_hi == 65535) {
-                // 规则2: 1024-65535 变为 0-1023，并设置 REV_Flag
-                block.Src_Port_lo = 0;
-                block.Src_Port_hi = 1023;
-                block.REV_Flag = true;
+            if (next_boundary > src_end + 1) {
+                // 当前区间包含结束端口
+                block_end = src_end;
             } else {
-                // 保持原端口范围
-                block.Src_Port_lo = item.Src_Port_lo;
-                block.Src_Port_hi = item.Src_Port_hi;
+                // 延伸到下一个 32 的边界
+                block_end = next_boundary - 1;
             }
             
-            // 处理目标端口范围
-            if (item.Dst_Port_lo == 0 && item.Dst_Port_hi == 65535) {
-                // 规则1: 0-65535 变为 0
-                block.Dst_Port_lo = 0;
-                block.Dst_Port_hi = 0;
-                dst_is_any = true;
-            } else if (item.Dst_Port_lo == 1024 && item.Dst_Port_hi == 65535) {
-                // 规则2: 1024-65535 变为 0-1023，并设置 REV_Flag
-                block.Dst_Port_lo = 0;
-                block.Dst_Port_hi = 1023;
-                block.REV_Flag = true;
-            } else {
-                // 保持原端口范围
-                block.Dst_Port_lo = item.Dst_Port_lo;
-                block.Dst_Port_hi = item.Dst_Port_hi;
-            }
+            src_blocks.push_back({block_start, block_end});
             
-            // 设置 ANY_Flag
-            // 0: 不包含 ANY
-            // 1: 仅源端口是 ANY
-            // 2: 仅目标端口是 ANY
-            // 3: 源端口和目标端口都是 ANY
-            if (src_is_any && dst_is_any) {
-                block.ANY_Flag = 3;
-            } else if (src_is_any) {
-                block.ANY_Flag = 1;
-            } else if (dst_is_any) {
-                block.ANY_Flag = 2;
+            // 移动到下一个区间
+            if (block_end == src_end) break;
+            src_start = block_end + 1;
+        }
+    }
+    
+    // 分块目标端口范围
+    if (dst_is_any) {
+        // 全端口不分块，直接使用 0
+        dst_blocks.push_back({0, 0});
+    } else {
+        uint16_t dst_start = block.Dst_Port_lo;
+        uint16_t dst_end = block.Dst_Port_hi;
+        
+        while (dst_start <= dst_end) {
+            uint16_t block_start = dst_start;
+            uint16_t block_end;
+            
+            // 计算当前 32 的倍数区间
+            uint16_t sp = dst_start / 32;
+            uint16_t next_boundary = (sp + 1) * 32;
+            
+            if (next_boundary > dst_end + 1) {
+                // 当前区间包含结束端口
+                block_end = dst_end;
             } else {
-                block.ANY_Flag = 0;
+                // 延伸到下一个 32 的边界
+                block_end = next_boundary - 1;
             }
             
-            port_blocks.push_back(block);
+            dst_blocks.push_back({block_start, block_end});
+            
+            // 移动到下一个区间
+            if (block_end == dst_end) break;
+            dst_start = block_end + 1;
         }
-        
-        optimal_metainfo[lrmid] = port_blocks;
     }
     
-    return optimal_metainfo;
+    // 生成所有源端口和目标端口的组合
+    for (const auto& src_range : src_blocks) {
+        for (const auto& dst_range : dst_blocks) {
+            PortBlock new_block;
+            new_block.LRMID = block.LRMID;
+            new_block.Src_Port_lo = src_range.first;
+            new_block.Src_Port_hi = src_range.second;
+            new_block.Dst_Port_lo = dst_range.first;
+            new_block.Dst_Port_hi = dst_range.second;
+            new_block.REV_Flag = block.REV_Flag;
+            new_block.REV_Side = block.REV_Side;
+            new_block.ANY_Flag = block.ANY_Flag;  // 继承原 block 的 ANY_Flag
+            new_block.action = block.action;
+            
+            PortBlock_Subset.push_back(new_block);
+        }
+    }
 }
 
 void Create_Port_Block_Subset(
-    const std::map<uint32_t, std::vector<PortBlock>>& optimal_metainfo,
+    const PortBlockTable& optimal_metainfo,
     std::vector<PortBlock>& PortBlock_Subset
 ) {
     PortBlock_Subset.clear();
@@ -278,100 +372,7 @@ void Create_Port_Block_Subset(
         const auto& port_blocks = entry.second;
         
         for (const auto& block : port_blocks) {
-            // 处理特殊情况：端口为 0 表示全端口（0-65535）
-            bool src_is_any = (block.Src_Port_lo == 0 && block.Src_Port_hi == 0);
-            bool dst_is_any = (block.Dst_Port_lo == 0 && block.Dst_Port_hi == 0);
-            
-            // 如果源端口和目标端口都是全端口，保存原规则
-            if (src_is_any && dst_is_any) {
-                PortBlock_Subset.push_back(block);
-                continue;
-            }
-            
-            // 计算源端口和目标端口的分块范围
-            std::vector<std::pair<uint16_t, uint16_t>> src_blocks;
-            std::vector<std::pair<uint16_t, uint16_t>> dst_blocks;
-            
-            // 分块源端口范围
-            if (src_is_any) {
-                // 全端口不分块，直接使用 0
-                src_blocks.push_back({0, 0});
-            } else {
-                uint16_t src_start = block.Src_Port_lo;
-                uint16_t src_end = block.Src_Port_hi;
-                
-                while (src_start <= src_end) {
-                    uint16_t block_start = src_start;
-                    uint16_t block_end;
-                    
-                    // 计算当前 32 的倍数区间
-                    uint16_t sp = src_start / 32;
-                    uint16_t next_boundary = (sp + 1) * 32;
-                    
-                    if (next_boundary > src_end + 1) {
-                        // 当前区间包含结束端口
-                        block_end = src_end;
-                    } else {
-                        // 延伸到下一个 32 的边界
-                        block_end = next_boundary - 1;
-                    }
-                    
-                    src_blocks.push_back({block_start, block_end});
-                    
-                    // 移动到下一个区间
-                    if (block_end == src_end) break;
-                    src_start = block_end + 1;
-                }
-            }
-            
-            // 分块目标端口范围
-            if (dst_is_any) {
-                // 全端口不分块，直接使用 0
-                dst_blocks.push_back({0, 0});
-            } else {
-                uint16_t dst_start = block.Dst_Port_lo;
-                uint16_t dst_end = block.Dst_Port_hi;
-                
-                while (dst_start <= dst_end) {
-                    uint16_t block_start = dst_start;
-                    uint16_t block_end;
-                    
-                    // 计算当前 32 的倍数区间
-                    uint16_t sp = dst_start / 32;
-                    uint16_t next_boundary = (sp + 1) * 32;
-                    
-                    if (next_boundary > dst_end + 1) {
-                        // 当前区间包含结束端口
-                        block_end = dst_end;
-                    } else {
-                        // 延伸到下一个 32 的边界
-                        block_end = next_boundary - 1;
-                    }
-                    
-                    dst_blocks.push_back({block_start, block_end});
-                    
-                    // 移动到下一个区间
-                    if (block_end == dst_end) break;
-                    dst_start = block_end + 1;
-                }
-            }
-            
-            // 生成所有源端口和目标端口的组合
-            for (const auto& src_range : src_blocks) {
-                for (const auto& dst_range : dst_blocks) {
-                    PortBlock new_block;
-                    new_block.LRMID = block.LRMID;
-                    new_block.Src_Port_lo = src_range.first;
-                    new_block.Src_Port_hi = src_range.second;
-                    new_block.Dst_Port_lo = dst_range.first;
-                    new_block.Dst_Port_hi = dst_range.second;
-                    new_block.REV_Flag = block.REV_Flag;
-                    new_block.ANY_Flag = block.ANY_Flag;  // 继承原 block 的 ANY_Flag
-                    new_block.action = block.action;
-                    
-                    PortBlock_Subset.push_back(new_block);
-                }
-            }
+            Split_Port_Block(block, PortBlock_Subset);
         }
     }
     
@@ -380,122 +381,275 @@ void Create_Port_Block_Subset(
 }
 
 
+// 置位 [lo, hi] 的 32 位掩码（0 <= lo <= hi <= 31），常数时间
+static inline uint32_t bit_range_mask(uint32_t lo, uint32_t hi) {
+    return (0xFFFFFFFFu >> (31 - hi)) & (0xFFFFFFFFu << lo);
+}
+
+// bit 31 在左，bit 0 在右（与 std::bitset<32>::to_string 一致）
+static std::string bitmap_to_string(uint32_t bm) {
+    std::string s(32, '0');
+    for (int i = 0; i < 32; ++i) {
+        if (bm & (1u << i)) s[31 - i] = '1';
+    }
+    return s;
+}
+
+// LRME 去重用的打包 key：LRMID、ANY_Flag、Src/Dst PAI、两个 32 位 bitmap
+struct LRMEKey {
+    uint32_t LRMID;
+    uint32_t PAI;              // SrcPAI << 16 | DstPAI
+    uint64_t bitmaps;          // Src_32bitmap << 32 | Dst_32bitmap
+    uint8_t  ANY_Flag;
+
+    bool operator==(const LRMEKey& o) const {
+        return LRMID == o.LRMID && PAI == o.PAI && bitmaps == o.bitmaps && ANY_Flag == o.ANY_Flag;
+    }
+};
+
+struct LRMEKeyHash {
+    uint64_t operator()(const LRMEKey& k) const {
+        uint64_t a = ((uint64_t)k.LRMID << 32) | k.PAI;
+        return mix64(a ^ mix64(k.bitmaps ^ ((uint64_t)k.ANY_Flag << 61)));
+    }
+};
+
+static inline LRMEKey make_lrme_key(const LRME_Entry& e) {
+    LRMEKey k;
+    k.LRMID = e.LRMID;
+    k.PAI = ((uint32_t)e.SrcPAI << 16) | e.DstPAI;
+    k.bitmaps = ((uint64_t)e.Src_32bitmap << 32) | e.Dst_32bitmap;
+    k.ANY_Flag = e.ANY_Flag;
+    return k;
+}
+
+// 由一个 PortBlock（已按 32 端口切分）生成对应的 LRME_Entry
+LRME_Entry make_lrme_entry(const PortBlock& block) {
+    LRME_Entry entry;
+    entry.LRMID = block.LRMID;
+    entry.ANY_Flag = block.ANY_Flag;  // 继承 PortBlock 的 ANY_Flag
+
+    // 处理源端口（ANY 由 ANY_Flag 决定，字面端口 0 仍编码为 PAI 0 / bit 0）
+    if (block.ANY_Flag & 1) {
+        // ANY port (0-65535)：使用特殊标记
+        entry.SrcPAI = 0xFFFF;  // 特殊值表示 ANY
+        entry.Src_32bitmap = 0;  // 全部置为 0，表示 null/ANY
+    } else {
+        // 计算 PAI：端口所在的 32 区间编号（REV 侧使用单独的编号段）
+        entry.SrcPAI = static_cast<uint16_t>(block.Src_Port_lo / 32 + ((block.REV_Side & 1) ? REV_PAI_BASE : 0));
+        
+        // 计算 32-bit bitmap：置位 [lo % 32, hi % 32]
+        entry.Src_32bitmap = bit_range_mask(block.Src_Port_lo % 32, block.Src_Port_hi % 32);
+    }
+
+    // 处理目标端口（逻辑同源端口）
+    if (block.ANY_Flag & 2) {
+        // ANY port (0-65535)：使用特殊标记
+        entry.DstPAI = 0xFFFF;  // 特殊值表示 ANY
+        entry.Dst_32bitmap = 0;  // 全部置为 0，表示 null/ANY
+    } else {
+        // 计算 PAI：端口所在的 32 区间编号（REV 侧使用单独的编号段）
+        entry.DstPAI = static_cast<uint16_t>(block.Dst_Port_lo / 32 + ((block.REV_Side & 2) ? REV_PAI_BASE : 0));
+        
+        // 计算 32-bit bitmap：置位 [lo % 32, hi % 32]
+        entry.Dst_32bitmap = bit_range_mask(block.Dst_Port_lo % 32, block.Dst_Port_hi % 32);
+    }
+
+    return entry;
+}
+
+static bool lrme_lrmid_less(const LRME_Entry& x, const LRME_Entry& y) {
+    return x.LRMID < y.LRMID;
+}
+
+// 去重：合并完全相同的表项，返回删除的条数
+// 结果按 LRMID 分组（升序），组内保留首次出现的顺序。
+// PortBlock_Subset 本身按 LRMID 生成，通常已有序；否则先稳定排序
+size_t dedup_lrme_entries(std::vector<LRME_Entry>& LRME_Entries) {
+    if (!std::is_sorted(LRME_Entries.begin(), LRME_Entries.end(), lrme_lrmid_less)) {
+        std::stable_sort(LRME_Entries.begin(), LRME_Entries.end(), lrme_lrmid_less);
+    }
+
+    // 一次哈希扫描，原地压缩保留首次出现的表项
+    FlatKeyIndex<LRMEKey, LRMEKeyHash> seen(LRME_Entries.size());
+    size_t kept = 0;
+    for (size_t i = 0; i < LRME_Entries.size(); ++i) {
+        uint32_t next = static_cast<uint32_t>(kept);
+        if (seen.find_or_insert(make_lrme_key(LRME_Entries[i]), next) == next) {
+            LRME_Entries[kept++] = LRME_Entries[i];
+        }
+    }
+    size_t duplicates_removed = LRME_Entries.size() - kept;
+    LRME_Entries.resize(kept);
+    return duplicates_removed;
+}
+
 std::vector<LRME_Entry> Caculate_LRME_Enries(
     const std::vector<PortBlock>& PortBlock_Subset
 ) {
     std::vector<LRME_Entry> LRME_Entries;
-    LRME_Entries.clear();
+    LRME_Entries.reserve(PortBlock_Subset.size());
 
     // 遍历每个 PortBlock，生成对应的 LRME_Entry
     for (const auto& block : PortBlock_Subset) {
-        LRME_Entry entry;
-        entry.LRMID = block.LRMID;
-        entry.ANY_Flag = block.ANY_Flag;  // 继承 PortBlock 的 ANY_Flag
-
-        // 处理源端口
-        if (block.Src_Port_lo == 0 && block.Src_Port_hi == 0) {
-            // ANY port (0-65535)：使用特殊标记
-            entry.SrcPAI = 0xFFFF;  // 特殊值表示 ANY
-            entry.Src_32bitmap.reset();  // 全部置为 0，表示 null/ANY
-        } else {
-            // 计算 PAI：端口所在的 32 区间编号
-            entry.SrcPAI = static_cast<uint16_t>(block.Src_Port_lo / 32);
-            
-            // 计算 32-bit bitmap
-            uint32_t block_base = entry.SrcPAI * 32;
-            entry.Src_32bitmap.reset();  // 先清空所有位
-            
-            // 计算需要设置的位范围（端口 % 32）
-            uint32_t start_bit = block.Src_Port_lo - block_base;  // lo % 32
-            uint32_t end_bit = block.Src_Port_hi - block_base;    // hi % 32
-            
-            // 设置 bitmap 的对应位
-            for (uint32_t bit = start_bit; bit <= end_bit; ++bit) {
-                entry.Src_32bitmap.set(bit);
-            }
-        }
-
-        // 处理目标端口（逻辑同源端口）
-        if (block.Dst_Port_lo == 0 && block.Dst_Port_hi == 0) {
-            // ANY port (0-65535)：使用特殊标记
-            entry.DstPAI = 0xFFFF;  // 特殊值表示 ANY
-            entry.Dst_32bitmap.reset();  // 全部置为 0，表示 null/ANY
-        } else {
-            // 计算 PAI：端口所在的 32 区间编号
-            entry.DstPAI = static_cast<uint16_t>(block.Dst_Port_lo / 32);
-            
-            // 计算 32-bit bitmap
-            uint32_t block_base = entry.DstPAI * 32;
-            entry.Dst_32bitmap.reset();  // 先清空所有位
-            
-            // 计算需要设置的位范围（端口 % 32）
-            uint32_t start_bit = block.Dst_Port_lo - block_base;  // lo % 32
-            uint32_t end_bit = block.Dst_Port_hi - block_base;    // hi % 32
-            
-            // 设置 bitmap 的对应位
-            for (uint32_t bit = start_bit; bit <= end_bit; ++bit) {
-                entry.Dst_32bitmap.set(bit);
-            }
-        }
-
-        LRME_Entries.push_back(entry);
+        LRME_Entries.push_back(make_lrme_entry(block));
     }
 
     std::cout << "[Caculate_LRME_Enries] Created " << LRME_Entries.size() 
               << " LRME entries from PortBlock subset (before deduplication)" << std::endl;
 
-    // 去重：合并完全相同的表项
-    // 使用 map 来按 LRMID 分组，然后在每个组内去重
-    std::map<uint32_t, std::vector<LRME_Entry>> grouped_by_lrmid;
-    
-    for (const auto& entry : LRME_Entries) {
-        grouped_by_lrmid[entry.LRMID].push_back(entry);
+    size_t duplicates_removed = dedup_lrme_entries(LRME_Entries);
+
+    std::cout << "[Caculate_LRME_Enries] After deduplication: " << LRME_Entries.size() 
+              << " unique entries (removed " << duplicates_removed << " duplicates)" << std::endl;
+
+    return LRME_Entries;
+}
+
+// ---------------Bitmap coalescing---------------------
+// 同一 (LRMID, ANY_Flag, SrcPAI, DstPAI) 单元内的表项，如果 action/REV 相同，
+// 并且 Src bitmap 相同（或 Dst bitmap 相同），则 OR 另一侧的 bitmap 合并为一条：
+// 两个矩形共享一条边时并集仍是矩形，合并是精确的。
+// 合并相当于把后一条表项的覆盖区域提前到前一条的位置，所以要求二者之间
+// 没有 action 不同且与之重叠的表项（首次匹配语义不变）。
+// REV 表项（REV PAI 上的折叠端口，实际匹配 port >= 1024）与其它单元的真实端口表项重叠，
+// 不参与合并，并视为与所有表项重叠。
+
+// 一侧端口的重叠判断：PAI=0xFFFF 视为全端口
+static inline bool lrme_side_overlap(uint16_t pa, uint32_t ba, uint16_t pb, uint32_t bb) {
+    return pa == 0xFFFF || pb == 0xFFFF || (pa == pb && (ba & bb) != 0);
+}
+
+static inline bool lrme_overlap(const LRME_Entry& a, const LRME_Entry& b) {
+    return lrme_side_overlap(a.SrcPAI, a.Src_32bitmap, b.SrcPAI, b.Src_32bitmap) &&
+           lrme_side_overlap(a.DstPAI, a.Dst_32bitmap, b.DstPAI, b.Dst_32bitmap);
+}
+
+static inline bool lrme_has_any_side(const LRME_Entry& e) {
+    return e.SrcPAI == 0xFFFF || e.DstPAI == 0xFFFF;
+}
+
+// k 是否挡住把 e（来自 block）提前合并
+static inline bool lrme_blocks(const LRME_Entry& k, const PortBlock& k_src,
+                               const LRME_Entry& e, const PortBlock& block) {
+    if (k_src.action == block.action) return false;
+    return k_src.REV_Flag || lrme_overlap(k, e);
+}
+
+struct LRMECellKey {
+    uint32_t LRMID;
+    uint32_t PAI;       // SrcPAI << 16 | DstPAI
+    uint8_t  ANY_Flag;
+
+    bool operator==(const LRMECellKey& o) const {
+        return LRMID == o.LRMID && PAI == o.PAI && ANY_Flag == o.ANY_Flag;
     }
-    
-    // 清空原始列表，准备填入去重后的结果
-    LRME_Entries.clear();
-    
-    size_t duplicates_removed = 0;
-    
-    // 对每个 LRMID 组内的表项进行去重
-    for (auto& group_pair : grouped_by_lrmid) {
-        auto& entries = group_pair.second;
-        std::vector<LRME_Entry> unique_entries;
-        
-        for (const auto& entry : entries) {
-            // 检查是否已存在相同的表项
-            bool is_duplicate = false;
-            
-            for (const auto& existing : unique_entries) {
-                // 比较所有关键字段
-                if (existing.LRMID == entry.LRMID &&
-                    existing.ANY_Flag == entry.ANY_Flag &&
-                    existing.SrcPAI == entry.SrcPAI &&
-                    existing.DstPAI == entry.DstPAI &&
-                    existing.Src_32bitmap == entry.Src_32bitmap &&
-                    existing.Dst_32bitmap == entry.Dst_32bitmap) {
-                    is_duplicate = true;
-                    duplicates_removed++;
-                    break;
+};
+
+struct LRMECellKeyHash {
+    uint64_t operator()(const LRMECellKey& k) const {
+        return mix64((((uint64_t)k.LRMID << 32) | k.PAI) ^ ((uint64_t)k.ANY_Flag << 62));
+    }
+};
+
+std::vector<LRME_Entry> Coalesce_LRME_Entries(
+    const std::vector<PortBlock>& PortBlock_Subset,
+    size_t* saved_entries
+) {
+    // 按 LRMID 稳定排序（通常已有序）
+    std::vector<PortBlock> sorted_blocks;
+    const std::vector<PortBlock>* blocks = &PortBlock_Subset;
+    auto block_less = [](const PortBlock& x, const PortBlock& y) { return x.LRMID < y.LRMID; };
+    if (!std::is_sorted(PortBlock_Subset.begin(), PortBlock_Subset.end(), block_less)) {
+        sorted_blocks = PortBlock_Subset;
+        std::stable_sort(sorted_blocks.begin(), sorted_blocks.end(), block_less);
+        blocks = &sorted_blocks;
+    }
+
+    const uint32_t NONE = 0xFFFFFFFFu;
+    std::vector<LRME_Entry> out;             // 合并后的表项（保持优先级顺序）
+    std::vector<const PortBlock*> out_src;   // 对应的 action / REV 来源
+    std::vector<uint32_t> prev_in_cell;      // 同一单元内上一条表项的位置
+    std::vector<uint32_t> cell_last;         // 单元 -> 最后一条表项的位置
+    std::vector<uint32_t> any_pos;           // 当前 LRMID 内含 ANY 侧的表项位置
+    out.reserve(blocks->size());
+    out_src.reserve(blocks->size());
+    prev_in_cell.reserve(blocks->size());
+
+    FlatKeyIndex<LRMECellKey, LRMECellKeyHash> cell_index(blocks->size());
+    uint32_t cur_lrmid = NONE;
+    size_t merged = 0;
+
+    for (const auto& block : *blocks) {
+        if (block.LRMID != cur_lrmid) {
+            cur_lrmid = block.LRMID;
+            any_pos.clear();
+        }
+        LRME_Entry e = make_lrme_entry(block);
+        LRMECellKey ck = { e.LRMID, ((uint32_t)e.SrcPAI << 16) | e.DstPAI, (uint8_t)e.ANY_Flag };
+        uint32_t cell = cell_index.find_or_insert(ck, static_cast<uint32_t>(cell_last.size()));
+        if (cell == cell_last.size()) cell_last.push_back(NONE);
+
+        // 从后往前找同单元内可合并的表项（REV 表项不合并）
+        bool done = false;
+        if (!block.REV_Flag) {
+            for (uint32_t i = cell_last[cell]; i != NONE && !done; i = prev_in_cell[i]) {
+                const PortBlock* src = out_src[i];
+                if (lrme_blocks(out[i], *src, e, block)) break;  // 被不同 action 的表项挡住
+                if (src->action != block.action || src->REV_Flag) continue;
+                bool same_src = (out[i].Src_32bitmap == e.Src_32bitmap);
+                bool same_dst = (out[i].Dst_32bitmap == e.Dst_32bitmap);
+                if (!same_src && !same_dst) continue;
+
+                // 检查 i 之后其它单元中是否有不同 action 且重叠的表项
+                bool blocked = false;
+                if (lrme_has_any_side(e)) {
+                    for (size_t k = i + 1; k < out.size() && !blocked; ++k) {
+                        blocked = lrme_blocks(out[k], *out_src[k], e, block);
+                    }
+                } else {
+                    for (size_t a = any_pos.size(); a-- > 0 && any_pos[a] > i && !blocked; ) {
+                        size_t k = any_pos[a];
+                        blocked = lrme_blocks(out[k], *out_src[k], e, block);
+                    }
                 }
-            }
-            
-            // 如果不是重复的，添加到唯一列表
-            if (!is_duplicate) {
-                unique_entries.push_back(entry);
+                if (blocked) break;
+
+                out[i].Src_32bitmap |= e.Src_32bitmap;
+                out[i].Dst_32bitmap |= e.Dst_32bitmap;
+                merged++;
+                done = true;
             }
         }
-        
-        // 将去重后的表项添加回结果列表
-        for (const auto& entry : unique_entries) {
-            LRME_Entries.push_back(entry);
-        }
+        if (done) continue;
+
+        uint32_t pos = static_cast<uint32_t>(out.size());
+        out.push_back(e);
+        out_src.push_back(&block);
+        prev_in_cell.push_back(cell_last[cell]);
+        cell_last[cell] = pos;
+        if (lrme_has_any_side(e) || block.REV_Flag) any_pos.push_back(pos);
     }
 
-    std::cout << "[Caculate_LRME_Enries] After deduplication: " << LRME_Entries.size() 
-              << " unique entries (removed " << duplicates_removed << " duplicates)" << std::endl;
+    // 基准：不合并时去重后的表项数
+    std::vector<LRME_Entry> plain;
+    plain.reserve(blocks->size());
+    for (const auto& block : *blocks) {
+        plain.push_back(make_lrme_entry(block));
+    }
+    dedup_lrme_entries(plain);
 
-    return LRME_Entries;
+    dedup_lrme_entries(out);
+    size_t saved = plain.size() > out.size() ? plain.size() - out.size() : 0;
+    if (saved_entries) *saved_entries = saved;
+
+    std::cout << "[Coalesce_LRME_Entries] Merged " << merged << " PortBlocks into existing bitmaps; "
+              << "LRME entries " << plain.size() << " -> " << out.size()
+              << " (saved " << saved << " switch table entries, "
+              << std::fixed << std::setprecision(2)
+              << (plain.empty() ? 0.0 : 100.0 * saved / plain.size()) << "%)" << std::endl;
+
+    return out;
 }
 
 void output_LRME_entries(
@@ -519,10 +673,9 @@ void output_LRME_entries(
 
     // 遍历每个 LRME_Entry
     for (const auto& entry : LRME_Entries) {
-        // 将 bitset 转换为字符串
-        // to_string() 默认从高位到低位输出，正好是我们需要的（bit 31在左，bit 0在右）
-        std::string src_bitmap = entry.Src_32bitmap.to_string();
-        std::string dst_bitmap = entry.Dst_32bitmap.to_string();
+        // 将 bitmap 转换为字符串（bit 31在左，bit 0在右）
+        std::string src_bitmap = bitmap_to_string(entry.Src_32bitmap);
+        std::string dst_bitmap = bitmap_to_string(entry.Dst_32bitmap);
 
         // 输出 LRMID（对齐）
         ofs << std::left << std::setw(10) << entry.LRMID;
@@ -551,8 +704,10 @@ void output_LRME_entries(
 }
 
 
-std::map<uint32_t, std::vector<PortBlock>> Caculate_LRME_for_Port_Table(
-    const std::map<uint32_t, std::vector<MergedItem>>& metainfo) 
+PortBlockTable Caculate_LRME_for_Port_Table(
+    const MergedItemTable& metainfo,
+    bool coalesce,
+    std::vector<LRME_Entry>* lrme_entries) 
 {
     // 1) Two optimal propose in paper; For ANY port and ports greater than 1024
     auto optimal_metainfo = Optimal_for_Port_Table(metainfo);
@@ -561,11 +716,13 @@ std::map<uint32_t, std::vector<PortBlock>> Caculate_LRME_for_Port_Table(
     std::vector<PortBlock> PortBlock;
     Create_Port_Block_Subset(optimal_metainfo, PortBlock);
 
-    // 3) Create LRME entries for PortBlock subset
-    auto PortBlock_LRME = Caculate_LRME_Enries(PortBlock);
+    // 3) Create LRME entries for PortBlock subset (optionally coalescing bitmaps)
+    auto PortBlock_LRME = coalesce ? Coalesce_LRME_Entries(PortBlock)
+                                   : Caculate_LRME_Enries(PortBlock);
 
     // 4) Output Port LRME entries to file
     output_LRME_entries(PortBlock_LRME, "output/Port_table.txt");
+    if (lrme_entries) lrme_entries->swap(PortBlock_LRME);
 
     // 5) Return optimal_metainfo
     return optimal_metainfo;
@@ -608,73 +765,81 @@ std::string ip_range_to_cidr(uint32_t ip_lo, uint32_t ip_hi) {
 
 void create_final_IP_table(
     const std::vector<MergrdR>& merged_ip_table,
-    const std::map<uint32_t, std::vector<PortBlock>>& optimal_metainfo,
+    const PortBlockTable& optimal_metainfo,
     std::vector<IP_Table_Entry>& final_ip_table
 ) {
     final_ip_table.clear();
     
     // 遍历 merged_ip_table 中的每个 IP 规则
     for (const auto& ip_rule : merged_ip_table) {
-        IP_Table_Entry entry;
-        
-        // 1) 复制 IP 和 Protocol 信息（与 merged_ip_table 一一对应）
-        entry.Src_IP_lo = ip_rule.Src_IP_lo;
-        entry.Src_IP_hi = ip_rule.Src_IP_hi;
-        entry.Dst_IP_lo = ip_rule.Dst_IP_lo;
-        entry.Dst_IP_hi = ip_rule.Dst_IP_hi;
-        entry.Proto = ip_rule.Proto;
-        
-        // 2) 初始化 LRMID 和 REV_Flag（默认值）
-        entry.Src_ANY_LRMID = 0xFFFF;  // 使用特殊值表示未设置
-        entry.Dst_ANY_LRMID = 0xFFFF;
-        entry.No_ANY_LRMID = 0xFFFF;
-        entry.Src_ANY_REV_Flag = false;
-        entry.Dst_ANY_REV_Flag = false;
-        entry.No_ANY_REV_Flag = false;
-        entry.drop_flag = false;
-        
-        // 3) 从 optimal_metainfo 中查找对应的 LRMID
+        // 从 optimal_metainfo 中查找对应的 LRMID
         uint32_t lrmid = ip_rule.LRMID;
-        auto it = optimal_metainfo.find(lrmid);
-        
-        if (it != optimal_metainfo.end()) {
-            const auto& port_blocks = it->second;
-            
-            // 遍历该 LRMID 下的所有 PortBlock
-            for (const auto& block : port_blocks) {
-                // 根据 ANY_Flag 分类处理
-                // ANY_Flag: 0=无ANY, 1=仅Src_ANY, 2=仅Dst_ANY, 3=双ANY
-                
-                if (block.ANY_Flag == 3) {
-                    // 双 ANY：设置 drop_flag 为 true
-                    entry.drop_flag = true;
-                    // 双ANY情况下，可以选择跳过其他处理或记录特殊信息
-                    
-                } else if (block.ANY_Flag == 1) {
-                    // 仅源端口是 ANY
-                    entry.Src_ANY_LRMID = static_cast<uint16_t>(lrmid);
-                    entry.Src_ANY_REV_Flag = block.REV_Flag;
-                    
-                } else if (block.ANY_Flag == 2) {
-                    // 仅目标端口是 ANY
-                    entry.Dst_ANY_LRMID = static_cast<uint16_t>(lrmid);
-                    entry.Dst_ANY_REV_Flag = block.REV_Flag;
-                    
-                } else if (block.ANY_Flag == 0) {
-                    // 无 ANY 端口
-                    entry.No_ANY_LRMID = static_cast<uint16_t>(lrmid);
-                    entry.No_ANY_REV_Flag = block.REV_Flag;
-                }
-            }
+        if (optimal_metainfo.contains(lrmid)) {
+            const auto port_blocks = optimal_metainfo[lrmid];
+            final_ip_table.push_back(make_ip_table_entry(ip_rule, port_blocks.begin(), port_blocks.size()));
+        } else {
+            final_ip_table.push_back(make_ip_table_entry(ip_rule, nullptr, 0));
         }
-        
-        final_ip_table.push_back(entry);
     }
 
     std::cout << "[create_final_IP_table] Created final IP table with " 
               << final_ip_table.size() << " entries." << std::endl;
 }
 
+IP_Table_Entry make_ip_table_entry(
+    const MergrdR& ip_rule,
+    const PortBlock* port_blocks,
+    size_t n_blocks
+) {
+    IP_Table_Entry entry;
+    
+    // 1) 复制 IP 和 Protocol 信息（与 merged_ip_table 一一对应）
+    entry.Src_IP_lo = ip_rule.Src_IP_lo;
+    entry.Src_IP_hi = ip_rule.Src_IP_hi;
+    entry.Dst_IP_lo = ip_rule.Dst_IP_lo;
+    entry.Dst_IP_hi = ip_rule.Dst_IP_hi;
+    entry.Proto = ip_rule.Proto;
+    
+    // 2) 初始化 LRMID 和 REV_Flag（默认值）
+    entry.Src_ANY_LRMID = 0xFFFF;  // 使用特殊值表示未设置
+    entry.Dst_ANY_LRMID = 0xFFFF;
+    entry.No_ANY_LRMID = 0xFFFF;
+    entry.Src_ANY_REV_Flag = false;
+    entry.Dst_ANY_REV_Flag = false;
+    entry.No_ANY_REV_Flag = false;
+    entry.drop_flag = false;
+    
+    // 3) 遍历该 LRMID 下的所有 PortBlock
+    uint32_t lrmid = ip_rule.LRMID;
+    for (size_t i = 0; i < n_blocks; ++i) {
+        const PortBlock& block = port_blocks[i];
+        // 根据 ANY_Flag 分类处理
+        // ANY_Flag: 0=无ANY, 1=仅Src_ANY, 2=仅Dst_ANY, 3=双ANY
+        
+        if (block.ANY_Flag == 3) {
+            // 双 ANY：设置 drop_flag 为 true
+            entry.drop_flag = true;
+            // 双ANY情况下，可以选择跳过其他处理或记录特殊信息
+            
+        } else if (block.ANY_Flag == 1) {
+            // 仅源端口是 ANY
+            entry.Src_ANY_LRMID = static_cast<uint16_t>(lrmid);
+            entry.Src_ANY_REV_Flag = entry.Src_ANY_REV_Flag || block.REV_Flag;
+            
+        } else if (block.ANY_Flag == 2) {
+            // 仅目标端口是 ANY
+            entry.Dst_ANY_LRMID = static_cast<uint16_t>(lrmid);
+            entry.Dst_ANY_REV_Flag = entry.Dst_ANY_REV_Flag || block.REV_Flag;
+            
+        } else if (block.ANY_Flag == 0) {
+            // 无 ANY 端口
+            entry.No_ANY_LRMID = static_cast<uint16_t>(lrmid);
+            entry.No_ANY_REV_Flag = entry.No_ANY_REV_Flag || block.REV_Flag;
+        }
+    }
+    return entry;
+}
+
 void output_final_IP_table(
     const std::vector<IP_Table_Entry>& final_ip_table,
     const std::string& output_file
@@ -774,103 +939,119 @@ void output_final_IP_table(
 
 // 将端口范围转换为最小前缀覆盖集合（Range to Prefix）
 // 返回 <prefix_value, mask> 对的列表
-std::vector<std::pair<uint16_t, uint16_t>> port_range_to_prefixes(uint16_t lo, uint16_t hi) {
-    std::vector<std::pair<uint16_t, uint16_t>> prefixes;
-    
-    // 如果是全端口范围，返回 0/0（匹配所有）
-    if (lo == 0 && hi == 65535) {
-        prefixes.push_back({0, 0});  // mask=0 表示通配所有位
-        return prefixes;
+size_t port_range_to_prefixes(uint16_t lo, uint16_t hi, std::pair<uint16_t, uint16_t>* out) {
+    // 用 32 位半开区间 [start, end)，hi = 65535 时不会回绕
+    uint32_t start = lo;
+    uint32_t end = static_cast<uint32_t>(hi) + 1;
+    size_t n = 0;
+
+    while (start < end) {
+        // 块大小取 start 对齐允许的最大值（末尾 0 的个数）与剩余长度允许的最大值（最高位）中的较小者
+        uint32_t align = start ? static_cast<uint32_t>(__builtin_ctz(start)) : 16;
+        uint32_t fit = 31 - static_cast<uint32_t>(__builtin_clz(end - start));
+        uint32_t len = align < fit ? align : fit;
+
+        // 全端口范围得到 mask=0（通配所有位）
+        out[n].first = static_cast<uint16_t>(start);
+        out[n].second = static_cast<uint16_t>(0xFFFFu << len);
+        n++;
+        start += 1u << len;
     }
-    
-    uint16_t start = lo;
-    
-    while (start <= hi) {
-        // 找到最大的前缀长度（最小的掩码块）
-        int max_prefix_len = 0;
-        
-        // 从最大可能的块开始尝试（16位，即块大小65536）
-        for (int len = 16; len >= 0; len--) {
-            uint16_t block_size = (1 << len);
-            uint16_t mask = ~(block_size - 1);  // 生成掩码
-            uint16_t prefix = start & mask;      // 对齐到块边界
-            uint16_t block_end = prefix + block_size - 1;
-            
-            // 检查这个块是否完全在范围内，且起始点对齐
-            if (prefix == start && block_end <= hi) {
-                max_prefix_len = len;
-                break;
-            }
-        }
-        
-        // 生成该前缀块
-        uint16_t block_size = (1 << max_prefix_len);
-        uint16_t mask = ~(block_size - 1);
-        uint16_t prefix = start & mask;
-        
-        prefixes.push_back({prefix, mask});
-        
-        // 移动到下一个块
-        start = prefix + block_size;
-        
-        // 防止溢出
-        if (start == 0) break;
+    return n;
+}
+
+// 规则数少于此值时在调用线程上展开
+static const size_t TCAM_PARALLEL_MIN_RULES = 1u << 14;
+
+// 把 [0, n) 均分给 num_threads 个线程执行 fn(lo, hi)
+template <typename Fn>
+static void run_rule_chunks(size_t n, unsigned num_threads, Fn fn) {
+    if (num_threads <= 1) {
+        fn(size_t(0), n);
+        return;
     }
-    
-    return prefixes;
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < num_threads; ++t) {
+        pool.emplace_back(fn, n * t / num_threads, n * (t + 1) / num_threads);
+    }
+    for (auto& th : pool) th.join();
 }
 
 // TCAM端口展开算法主函数
 void TCAM_Port_Expansion(
     const std::vector<Rule5D>& rules,
-    std::vector<TCAM_Entry>& tcam_entries
+    std::vector<TCAM_Entry>& tcam_entries,
+    unsigned num_threads
 ) {
     tcam_entries.clear();
     
     std::cout << "[TCAM_Port_Expansion] Starting port range expansion...\n";
+
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+        if (rules.size() < TCAM_PARALLEL_MIN_RULES) num_threads = 1;
+    }
     
-    size_t total_entries = 0;
-    
-    for (size_t rule_idx = 0; rule_idx < rules.size(); rule_idx++) {
-        const auto& rule = rules[rule_idx];
-        
-        // 提取端口范围
-        uint16_t src_port_lo = rule.range[2][0];
-        uint16_t src_port_hi = rule.range[2][1];
-        uint16_t dst_port_lo = rule.range[3][0];
-        uint16_t dst_port_hi = rule.range[3][1];
-        
-        // 将源端口和目标端口范围转换为前缀集合
-        auto src_prefixes = port_range_to_prefixes(src_port_lo, src_port_hi);
-        auto dst_prefixes = port_range_to_prefixes(dst_port_lo, dst_port_hi);
-        
-        // 生成所有源端口前缀 × 目标端口前缀的组合
-        for (const auto& src_prefix : src_prefixes) {
-            for (const auto& dst_prefix : dst_prefixes) {
-                TCAM_Entry entry;
-                
-                // 复制IP信息（IP部分不变，保持掩码形式）
-                entry.Src_IP_lo = rule.range[0][0];
-                entry.Src_IP_hi = rule.range[0][1];
-                entry.Dst_IP_lo = rule.range[1][0];
-                entry.Dst_IP_hi = rule.range[1][1];
-                
-                // 端口前缀和掩码
-                entry.Src_Port_prefix = src_prefix.first;
-                entry.Src_Port_mask = src_prefix.second;
-                entry.Dst_Port_prefix = dst_prefix.first;
-                entry.Dst_Port_mask = dst_prefix.second;
-                
-                // 协议和动作
-                entry.Proto = rule.range[4][0];
-                entry.action = rule.range[5][0];
-                entry.rule_id = rule_idx;
-                
-                tcam_entries.push_back(entry);
-                total_entries++;
+    // 第一遍：每条规则展开为 源端口前缀数 × 目标端口前缀数 条表项，
+    // offset[i] 为规则 i 的第一条表项在输出中的位置
+    std::vector<size_t> offset(rules.size() + 1, 0);
+    run_rule_chunks(rules.size(), num_threads, [&](size_t lo, size_t hi) {
+        std::pair<uint16_t, uint16_t> prefixes[MAX_PORT_PREFIXES];
+        for (size_t rule_idx = lo; rule_idx < hi; ++rule_idx) {
+            const auto& rule = rules[rule_idx];
+            size_t n_src = port_range_to_prefixes(rule.range[2][0], rule.range[2][1], prefixes);
+            size_t n_dst = port_range_to_prefixes(rule.range[3][0], rule.range[3][1], prefixes);
+            offset[rule_idx + 1] = n_src * n_dst;
+        }
+    });
+    for (size_t i = 0; i < rules.size(); ++i) offset[i + 1] += offset[i];
+    tcam_entries.resize(offset[rules.size()]);
+
+    // 第二遍：各线程把自己负责的规则写到 offset 指定的位置，结果与串行展开逐项相同
+    run_rule_chunks(rules.size(), num_threads, [&](size_t lo, size_t hi) {
+        for (size_t rule_idx = lo; rule_idx < hi; ++rule_idx) {
+            const auto& rule = rules[rule_idx];
+            
+            // 提取端口范围
+            uint16_t src_port_lo = rule.range[2][0];
+            uint16_t src_port_hi = rule.range[2][1];
+            uint16_t dst_port_lo = rule.range[3][0];
+            uint16_t dst_port_hi = rule.range[3][1];
+            
+            // 将源端口和目标端口范围转换为前缀集合（写入栈上的定长缓冲区，不分配内存）
+            std::pair<uint16_t, uint16_t> src_prefixes[MAX_PORT_PREFIXES];
+            std::pair<uint16_t, uint16_t> dst_prefixes[MAX_PORT_PREFIXES];
+            size_t n_src = port_range_to_prefixes(src_port_lo, src_port_hi, src_prefixes);
+            size_t n_dst = port_range_to_prefixes(dst_port_lo, dst_port_hi, dst_prefixes);
+            
+            // 生成所有源端口前缀 × 目标端口前缀的组合
+            TCAM_Entry* out = &tcam_entries[offset[rule_idx]];
+            for (size_t si = 0; si < n_src; ++si) {
+                const auto& src_prefix = src_prefixes[si];
+                for (size_t di = 0; di < n_dst; ++di) {
+                    const auto& dst_prefix = dst_prefixes[di];
+                    TCAM_Entry& entry = *out++;
+                    
+                    // 复制IP信息（IP部分不变，保持掩码形式）
+                    entry.Src_IP_lo = rule.range[0][0];
+                    entry.Src_IP_hi = rule.range[0][1];
+                    entry.Dst_IP_lo = rule.range[1][0];
+                    entry.Dst_IP_hi = rule.range[1][1];
+                    
+                    // 端口前缀和掩码
+                    entry.Src_Port_prefix = src_prefix.first;
+                    entry.Src_Port_mask = src_prefix.second;
+                    entry.Dst_Port_prefix = dst_prefix.first;
+                    entry.Dst_Port_mask = dst_prefix.second;
+                    
+                    // 协议和动作（range 只有 5 维，动作取 Rule5D::action）
+                    entry.Proto = rule.range[4][0];
+                    entry.action = rule.action;
+                    entry.rule_id = rule_idx;
+                }
             }
         }
-    }
+    });
     
     std::cout << "[TCAM_Port_Expansion] Expansion completed: " 
               << rules.size() << " rules -> " 
@@ -1,11 +1,145 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
 #include <vector>
 #include <map>
 #include <tuple>
 #include <bitset>
 #include <string>
 
+// ---------------Hash Helpers---------------------
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+// 线性探测的扁平哈希表：Key -> uint32_t 下标
+// 容量在构造时按 2 倍元素数取 2 的幂，插入过程中不再扩容；
+// 需要动态增删时由调用方在 size() 接近容量时调用 rehash，删除用 erase（后移删除，无墓碑）
+template <typename Key, typename Hash>
+class FlatKeyIndex {
+public:
+    explicit FlatKeyIndex(size_t expected = 0) {
+        size_t cap = 16;
+        while (cap < expected * 2) cap <<= 1;
+        slots_.resize(cap);
+        mask_ = cap - 1;
+    }
+
+    static const uint32_t NOT_FOUND = 0xFFFFFFFFu;
+
+    // 查找 key；不存在时返回 NOT_FOUND
+    uint32_t find(const Key& key) const {
+        size_t pos = Hash()(key) & mask_;
+        while (true) {
+            const Slot& s = slots_[pos];
+            if (s.value == EMPTY) return NOT_FOUND;
+            if (s.key == key) return s.value;
+            pos = (pos + 1) & mask_;
+        }
+    }
+
+    // 查找 key；不存在时插入 (key, value)。返回已有值或 value
+    uint32_t find_or_insert(const Key& key, uint32_t value) {
+        size_t pos = Hash()(key) & mask_;
+        while (true) {
+            Slot& s = slots_[pos];
+            if (s.value == EMPTY) {
+                s.key = key;
+                s.value = value;
+                ++count_;
+                return value;
+            }
+            if (s.key == key) {
+                return s.value;
+            }
+            pos = (pos + 1) & mask_;
+        }
+    }
+
+    // 预取 key 的起始探测槽位（批量查找时提前发出访存）
+    void prefetch(const Key& key) const {
+        __builtin_prefetch(&slots_[Hash()(key) & mask_]);
+    }
+
+    // 删除 key：之后的探测链整体前移，保持查找无需墓碑
+    bool erase(const Key& key) {
+        size_t pos = Hash()(key) & mask_;
+        while (true) {
+            if (slots_[pos].value == EMPTY) return false;
+            if (slots_[pos].key == key) break;
+            pos = (pos + 1) & mask_;
+        }
+        slots_[pos].value = EMPTY;
+        --count_;
+        size_t next = pos;
+        while (true) {
+            next = (next + 1) & mask_;
+            if (slots_[next].value == EMPTY) return true;
+            size_t home = Hash()(slots_[next].key) & mask_;
+            // home 不在 (pos, next] 之间时，该元素可以前移到 pos
+            bool stays = pos <= next ? (home > pos && home <= next) : (home > pos || home <= next);
+            if (!stays) {
+                slots_[pos] = slots_[next];
+                slots_[next].value = EMPTY;
+                pos = next;
+            }
+        }
+    }
+
+    // 按新的预期元素数重建（容量取不小于 2 倍元素数的 2 的幂）
+    void rehash(size_t expected) {
+        FlatKeyIndex bigger(std::max(expected, count_));
+        for (const Slot& s : slots_) {
+            if (s.value != EMPTY) bigger.find_or_insert(s.key, s.value);
+        }
+        *this = bigger;
+    }
+
+    size_t size() const { return count_; }
+    size_t capacity() const { return slots_.size(); }
+    size_t memory_bytes() const { return slots_.size() * sizeof(Slot); }
+
+private:
+    static const uint32_t EMPTY = 0xFFFFFFFFu;
+    struct Slot {
+        Key key;
+        uint32_t value = EMPTY;
+    };
+    std::vector<Slot> slots_;
+    size_t mask_;
+    size_t count_ = 0;
+};
+
+struct U64KeyHash {
+    uint64_t operator()(uint64_t k) const { return mix64(k); }
+};
+
+// Src/Dst IP range + Proto (136 bit) 打包成的 key，用于开放寻址哈希
+struct IPKey {
+    uint32_t src_lo, src_hi, dst_lo, dst_hi;
+    uint8_t  proto;
+
+    bool operator==(const IPKey& o) const {
+        return src_lo == o.src_lo && src_hi == o.src_hi &&
+               dst_lo == o.dst_lo && dst_hi == o.dst_hi && proto == o.proto;
+    }
+};
+
+struct IPKeyHash {
+    uint64_t operator()(const IPKey& k) const {
+        uint64_t a = ((uint64_t)k.src_lo << 32) | k.src_hi;
+        uint64_t b = ((uint64_t)k.dst_lo << 32) | k.dst_hi;
+        return mix64(a ^ mix64(b ^ ((uint64_t)k.proto << 56)));
+    }
+};
+
 // ---------------Struct Declarations---------------------
 struct MergedItem {
     uint32_t LRMID;
@@ -29,23 +163,110 @@ struct PortBlock{
     uint16_t Src_Port_lo, Src_Port_hi;
     uint16_t Dst_Port_lo, Dst_Port_hi;
     bool REV_Flag;
+    uint8_t REV_Side;   // bit0 源端口侧、bit1 目的端口侧由 1024-65535 改写而来；REV_Flag = (REV_Side != 0)
     uint8_t ANY_Flag;
     uint16_t action;
 };
 
+// REV 侧的 PAI 单独编号：REV_PAI_BASE + (port & 1023) / 32。
+// 真实端口的 PAI 为 0..2047，ANY 为 0xFFFF，三者互不重叠，
+// 所以同一 (LRMID, ANY_Flag) 下 REV 与非 REV 的表项可以共存，查找时按 IP 表项的 REV 标志多探测一次
+static const uint16_t REV_PAI_BASE = 0x800;
+
+// 固定 16 字节布局，整表可以直接 memcpy / 排序 / 哈希
+// LRMID 与 ANY_Flag(0~3) 共用一个 32 位字，LRMID 上限为 2^30
 struct LRME_Entry{
-    uint32_t LRMID;
-    uint8_t ANY_Flag;
+    uint32_t LRMID : 30;
+    uint32_t ANY_Flag : 2;
     uint16_t SrcPAI, DstPAI;  // Port Address Interval
-    std::bitset<32> Src_32bitmap, Dst_32bitmap;  // 32位二进制位图
+    uint32_t Src_32bitmap, Dst_32bitmap;  // 32位二进制位图，bit i 对应端口 PAI*32+i
 };
+static_assert(sizeof(LRME_Entry) == 16, "LRME_Entry must stay 16 bytes");
+
+// CSR（压缩行）布局的按 LRMID 分组表：
+//   offsets_[id] .. offsets_[id+1] 为 LRMID=id 的表项在 items_ 中的区间
+// LRMID 从 0 连续分配，所以不需要 map；遍历时 entry.first 为 LRMID，
+// entry.second 为该组表项的只读视图，与原 map<uint32_t, vector<T>> 用法一致
+template <typename T>
+class LRMIDTable {
+public:
+    class Span {
+    public:
+        Span(const T* b, const T* e) : b_(b), e_(e) {}
+        const T* begin() const { return b_; }
+        const T* end() const { return e_; }
+        size_t size() const { return static_cast<size_t>(e_ - b_); }
+        bool empty() const { return b_ == e_; }
+        const T& operator[](size_t i) const { return b_[i]; }
+    private:
+        const T* b_;
+        const T* e_;
+    };
+
+    struct Group {
+        uint32_t first;   // LRMID
+        Span second;      // 该 LRMID 下的表项
+    };
+
+    class const_iterator {
+    public:
+        const_iterator(const LRMIDTable* t, uint32_t id) : t_(t), id_(id) {}
+        Group operator*() const { return Group{id_, (*t_)[id_]}; }
+        const_iterator& operator++() { ++id_; return *this; }
+        bool operator!=(const const_iterator& o) const { return id_ != o.id_; }
+        bool operator==(const const_iterator& o) const { return id_ == o.id_; }
+    private:
+        const LRMIDTable* t_;
+        uint32_t id_;
+    };
+
+    LRMIDTable() : offsets_(1, 0) {}
+
+    void clear() {
+        items_.clear();
+        offsets_.assign(1, 0);
+    }
+    void reserve(size_t groups, size_t items) {
+        offsets_.reserve(groups + 1);
+        items_.reserve(items);
+    }
+
+    // 构建：先 push_item 当前组的所有表项，再 end_group 封口，LRMID 依次 +1
+    void push_item(const T& item) { items_.push_back(item); }
+    uint32_t end_group() {
+        offsets_.push_back(static_cast<uint32_t>(items_.size()));
+        return static_cast<uint32_t>(offsets_.size() - 2);
+    }
+
+    size_t size() const { return offsets_.size() - 1; }      // LRMID 数量
+    size_t total_items() const { return items_.size(); }
+    bool contains(uint32_t lrmid) const { return lrmid < size(); }
+    Span operator[](uint32_t lrmid) const {
+        return Span(items_.data() + offsets_[lrmid], items_.data() + offsets_[lrmid + 1]);
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, static_cast<uint32_t>(size())); }
+
+    const std::vector<T>& items() const { return items_; }
+    std::vector<T>& items() { return items_; }
+    const std::vector<uint32_t>& offsets() const { return offsets_; }
+    std::vector<uint32_t>& offsets() { return offsets_; }
+
+private:
+    std::vector<T> items_;
+    std::vector<uint32_t> offsets_;
+};
+
+using MergedItemTable = LRMIDTable<MergedItem>;
+using PortBlockTable = LRMIDTable<PortBlock>;
 
 struct IP_Table_Entry{
     uint32_t Src_IP_lo, Src_IP_hi;
     uint32_t Dst_IP_lo, Dst_IP_hi;
     uint8_t  Proto;
     uint16_t Src_ANY_LRMID, Dst_ANY_LRMID, No_ANY_LRMID;
-    bool Src_ANY_REV_Flag, Dst_ANY_REV_Flag, No_ANY_REV_Flag;
+    bool Src_ANY_REV_Flag, Dst_ANY_REV_Flag, No_ANY_REV_Flag;   // 该类别存在 REV 表项（需要探测 REV PAI）
     bool drop_flag;  // true if double ANY (src and dst both ANY)
 };
 
@@ -59,11 +280,11 @@ void merge_same_ip_entry(
 void Create_metainfo(
     const std::vector<MergrdR>& merged_ip_table,
     const std::vector<PortRule>& port_table,
-    std::map<uint32_t, std::vector<MergedItem>>& metainfo
+    MergedItemTable& metainfo
 );
 
 void output_metainfo(
-    const std::map<uint32_t, std::vector<MergedItem>>& metainfo,
+    const MergedItemTable& metainfo,
     const std::string& output_file
 );
 
@@ -71,42 +292,81 @@ void load_and_create_IP_table(
     std::vector<IPRule>& ip_table,
     std::vector<PortRule>& port_table, 
     std::vector<MergrdR>& merged_ip_table,
-    std::map<uint32_t, std::vector<MergedItem>>& metainfo
+    MergedItemTable& metainfo
+);
+
+PortBlockTable Optimal_for_Port_Table(
+    const MergedItemTable& metainfo
 );
 
-std::map<uint32_t, std::vector<PortBlock>> Optimal_for_Port_Table(
-    const std::map<uint32_t, std::vector<MergedItem>>& metainfo
+// 单个 MergedItem -> PortBlock（ANY 端口记为 0-0 并由 ANY_Flag 标记，1024-65535 改写为 0-1023 并置 REV_Flag / REV_Side）
+// 之后的切分与 LRME 编码只按 ANY_Flag 识别 ANY，字面端口 0 编码为 PAI 0 的 bit 0
+PortBlock make_port_block(uint32_t lrmid, const MergedItem& item);
+
+// 单个 PortBlock 的 32 端口切分（Create_Port_Block_Subset 的内层）
+void Split_Port_Block(
+    const PortBlock& block,
+    std::vector<PortBlock>& PortBlock_Subset
 );
 
 void Create_Port_Block_Subset(
-    const std::map<uint32_t, std::vector<PortBlock>>& optimal_metainfo,
+    const PortBlockTable& optimal_metainfo,
     std::vector<PortBlock>& PortBlock_Subset
 );
 
+// 单个（已切分的）PortBlock -> LRME_Entry，ANY 端口的 PAI 为 0xFFFF，REV 侧的 PAI 从 REV_PAI_BASE 起编号
+LRME_Entry make_lrme_entry(const PortBlock& block);
+
 std::vector<LRME_Entry> Caculate_LRME_Enries(
     const std::vector<PortBlock>& PortBlock_Subset
 );
 
+// 原地删除完全相同的 LRME 表项（按 LRMID 分组、组内保留首次出现顺序），返回删除条数
+size_t dedup_lrme_entries(std::vector<LRME_Entry>& LRME_Entries);
+
+// 可选的位图合并：同一 (LRMID, PAI) 单元内 action 相同的表项 OR 合并，
+// 只在语义不变时进行；saved_entries 返回相比仅去重节省的表项数
+std::vector<LRME_Entry> Coalesce_LRME_Entries(
+    const std::vector<PortBlock>& PortBlock_Subset,
+    size_t* saved_entries = nullptr
+);
+
 void output_LRME_entries(
     const std::vector<LRME_Entry>& LRME_Entries,
     const std::string& output_file
 );
 
-std::map<uint32_t, std::vector<PortBlock>> Caculate_LRME_for_Port_Table(
-    const std::map<uint32_t, std::vector<MergedItem>>& metainfo
+// coalesce = true 时用 Coalesce_LRME_Entries 代替 Caculate_LRME_Enries；
+// lrme_entries 非空时同时取回写入 Port_table.txt 的 LRME 表项
+PortBlockTable Caculate_LRME_for_Port_Table(
+    const MergedItemTable& metainfo,
+    bool coalesce = false,
+    std::vector<LRME_Entry>* lrme_entries = nullptr
 );
 
 void create_final_IP_table(
     const std::vector<MergrdR>& merged_ip_table,
-    const std::map<uint32_t, std::vector<PortBlock>>& optimal_metainfo,
+    const PortBlockTable& optimal_metainfo,
     std::vector<IP_Table_Entry>& final_ip_table
 );
 
+// 一个 IP 表项：由该 LRMID 的 PortBlock 决定各 ANY 类别的 LRMID 与 drop_flag，
+// 类别内任一 PortBlock 带 REV 时该类别的 REV 标志置位
+IP_Table_Entry make_ip_table_entry(
+    const MergrdR& ip_rule,
+    const PortBlock* port_blocks,
+    size_t n_blocks
+);
+
 void output_final_IP_table(
     const std::vector<IP_Table_Entry>& final_ip_table,
     const std::string& output_file
 );
 
+// 点分十进制 / CIDR（非对齐区间输出为 lo-hi）
+std::string ip_to_string(uint32_t ip);
+std::string ip_range_to_cidr(uint32_t ip_lo, uint32_t ip_hi);
+
 // ---------------TCAM-based Port Expansion Algorithm---------------------
 struct TCAM_Entry {
     uint32_t Src_IP_lo, Src_IP_hi;
@@ -120,13 +380,20 @@ struct TCAM_Entry {
     uint32_t rule_id;              // 原始规则ID
 };
 
-// 将端口范围转换为最小前缀覆盖集合
-std::vector<std::pair<uint16_t, uint16_t>> port_range_to_prefixes(uint16_t lo, uint16_t hi);
+// 16 位端口范围的最小前缀覆盖最多 2*16-2 = 30 个前缀
+static const size_t MAX_PORT_PREFIXES = 30;
+
+// 将端口范围转换为最小前缀覆盖集合，(prefix, mask) 依次写入 out（至少 MAX_PORT_PREFIXES 项），返回个数。
+// 每个前缀 O(1)：块大小由 start 的末尾 0 个数与剩余长度的最高位决定
+size_t port_range_to_prefixes(uint16_t lo, uint16_t hi, std::pair<uint16_t, uint16_t>* out);
 
-// TCAM端口展开算法主函数
+// TCAM端口展开算法主函数：第一遍并行统计每条规则的表项数并做前缀和得到输出偏移，
+// 第二遍并行写入按总数一次分配好的数组，表项顺序与串行展开相同。
+// num_threads = 0：每个硬件线程一段（规则较少时串行）
 void TCAM_Port_Expansion(
     const std::vector<Rule5D>& rules,
-    std::vector<TCAM_Entry>& tcam_entries
+    std::vector<TCAM_Entry>& tcam_entries,
+    unsigned num_threads = 0
 );
 
 // 输出TCAM表到文件
@@ -0,0 +1,270 @@
+/** *************************************************************/
+// @Name: IPIndex.cpp
+// @Function: IP_Table_Entry indexes: segment x interval tree, poptrie cross-product
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "IPIndex.hpp"
+
+using namespace std;
+
+// 线段树规范分解：把叶子区间 [a, b] 拆成 O(log K) 个节点（自底向上的迭代写法）
+template <typename Emit>
+static void canonical_nodes(size_t leaves, size_t a, size_t b, Emit emit) {
+    size_t l = a + leaves, r = b + leaves + 1;
+    while (l < r) {
+        if (l & 1) emit(l++);
+        if (r & 1) emit(--r);
+        l >>= 1;
+        r >>= 1;
+    }
+}
+
+// 基本区间左端点：0 以及所有区间的 lo 与 hi+1，升序去重
+static void elementary_bounds(const std::vector<IP_Table_Entry>& entries, bool src, std::vector<uint32_t>& out) {
+    out.clear();
+    out.reserve(entries.size() * 2 + 1);
+    out.push_back(0);
+    for (const auto& e : entries) {
+        uint32_t lo = src ? e.Src_IP_lo : e.Dst_IP_lo;
+        uint32_t hi = src ? e.Src_IP_hi : e.Dst_IP_hi;
+        out.push_back(lo);
+        if (hi != 0xFFFFFFFFu) out.push_back(hi + 1);
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    out.shrink_to_fit();
+}
+
+static inline uint32_t bound_index(const std::vector<uint32_t>& bounds, uint32_t ip) {
+    return static_cast<uint32_t>(std::upper_bound(bounds.begin(), bounds.end(), ip) - bounds.begin() - 1);
+}
+
+void IPRangeIndex::build(const std::vector<IP_Table_Entry>& entries) {
+    num_entries_ = entries.size();
+
+    // 1) 源 IP 基本区间
+    elementary_bounds(entries, true, bounds_);
+
+    leaves_ = 1;
+    while (leaves_ < bounds_.size()) leaves_ <<= 1;
+
+    // 2) 规范节点计数 -> CSR 偏移 -> 填充
+    std::vector<std::pair<uint32_t, uint32_t>> seg_range(entries.size());
+    offsets_.assign(2 * leaves_ + 1, 0);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        seg_range[i].first = bound_index(bounds_, entries[i].Src_IP_lo);
+        seg_range[i].second = bound_index(bounds_, entries[i].Src_IP_hi);
+        canonical_nodes(leaves_, seg_range[i].first, seg_range[i].second,
+                        [&](size_t node) { offsets_[node + 1]++; });
+    }
+    for (size_t k = 1; k < offsets_.size(); ++k) offsets_[k] += offsets_[k - 1];
+
+    items_.assign(offsets_.back(), DstItem());
+    std::vector<uint32_t> cursor(offsets_.begin(), offsets_.end() - 1);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto& e = entries[i];
+        DstItem item;
+        item.lo = e.Dst_IP_lo;
+        item.hi = e.Dst_IP_hi;
+        item.max_hi = e.Dst_IP_hi;
+        item.id = static_cast<uint32_t>(i);
+        item.proto = e.Proto;
+        canonical_nodes(leaves_, seg_range[i].first, seg_range[i].second,
+                        [&](size_t node) { items_[cursor[node]++] = item; });
+    }
+
+    // 3) 每个节点按 dst lo 排序并计算隐式子树的 max_hi
+    for (size_t node = 1; node < 2 * leaves_; ++node) {
+        if (offsets_[node] != offsets_[node + 1]) finalize_node(offsets_[node], offsets_[node + 1]);
+    }
+}
+
+// 后序递归：子树 [l, r) 的 max_hi 存在中点
+uint32_t IPRangeIndex::fill_max_hi(uint32_t l, uint32_t r) {
+    if (l >= r) return 0;
+    uint32_t mid = l + (r - l) / 2;
+    uint32_t m = items_[mid].hi;
+    m = std::max(m, fill_max_hi(l, mid));
+    m = std::max(m, fill_max_hi(mid + 1, r));
+    items_[mid].max_hi = m;
+    return m;
+}
+
+void IPRangeIndex::finalize_node(uint32_t begin, uint32_t end) {
+    std::sort(items_.begin() + begin, items_.begin() + end,
+        [](const DstItem& a, const DstItem& b) {
+            return a.lo != b.lo ? a.lo < b.lo : a.id < b.id;
+        });
+    fill_max_hi(begin, end);
+}
+
+void IPRangeIndex::query(uint32_t src_ip, uint32_t dst_ip, uint8_t proto, std::vector<uint32_t>& out) const {
+    for_each_match(src_ip, dst_ip, proto, [&](uint32_t id) { out.push_back(id); });
+}
+
+uint32_t IPRangeIndex::query_first(uint32_t src_ip, uint32_t dst_ip, uint8_t proto) const {
+    uint32_t best = NOT_FOUND;
+    for_each_match(src_ip, dst_ip, proto, [&](uint32_t id) { if (id < best) best = id; });
+    return best;
+}
+
+size_t IPRangeIndex::memory_bytes() const {
+    return bounds_.capacity() * sizeof(uint32_t) +
+           offsets_.capacity() * sizeof(uint32_t) +
+           items_.capacity() * sizeof(DstItem);
+}
+
+// ---------------IPPoptrie---------------------
+
+uint32_t IPPoptrie::class_of(uint32_t ip) const {
+    return bound_index(bounds_, ip);
+}
+
+void IPPoptrie::build(const std::vector<uint32_t>& bounds) {
+    bounds_ = bounds;
+    nodes_.clear();
+    leaves_.clear();
+    top_.assign(1u << 16, 0);
+    for (uint32_t i = 0; i < (1u << 16); ++i) {
+        uint32_t start = i << 16;
+        uint32_t c = class_of(start);
+        if (c == class_of(start | 0xFFFF)) {
+            top_[i] = c;
+        } else {
+            uint32_t index = static_cast<uint32_t>(nodes_.size());
+            nodes_.push_back(Node());
+            build_node(index, start, 8);
+            top_[i] = index | NODE_FLAG;
+        }
+    }
+    nodes_.shrink_to_fit();
+    leaves_.shrink_to_fit();
+    // 查找只用 trie，端点数组不再需要
+    std::vector<uint32_t>().swap(bounds_);
+}
+
+// 节点覆盖 [start, start + 256 << shift)，槽位宽 1 << shift
+void IPPoptrie::build_node(uint32_t index, uint32_t start, uint32_t shift) {
+    Node node;
+    memset(&node, 0, sizeof(node));
+    node.base0 = static_cast<uint32_t>(leaves_.size());
+    std::vector<uint32_t> child_starts;
+    bool have_leaf = false;
+    uint32_t prev = 0;
+    for (uint32_t slot = 0; slot < 256; ++slot) {
+        uint32_t s = start + (slot << shift);
+        uint32_t c = class_of(s);
+        if (shift > 0 && c != class_of(s + ((1u << shift) - 1))) {
+            node.vec[slot >> 6] |= 1ULL << (slot & 63);
+            child_starts.push_back(s);
+            continue;
+        }
+        if (!have_leaf || c != prev) {
+            node.leafvec[slot >> 6] |= 1ULL << (slot & 63);
+            leaves_.push_back(c);
+        }
+        have_leaf = true;
+        prev = c;
+    }
+
+    // 子节点连续分配，再逐个递归填充
+    node.base1 = static_cast<uint32_t>(nodes_.size());
+    nodes_.resize(nodes_.size() + child_starts.size());
+    nodes_[index] = node;
+    for (size_t k = 0; k < child_starts.size(); ++k) {
+        build_node(node.base1 + static_cast<uint32_t>(k), child_starts[k], shift - 8);
+    }
+}
+
+size_t IPPoptrie::memory_bytes() const {
+    return top_.capacity() * sizeof(uint32_t) +
+           nodes_.capacity() * sizeof(Node) +
+           leaves_.capacity() * sizeof(uint32_t);
+}
+
+// ---------------PoptrieIPIndex---------------------
+
+bool PoptrieIPIndex::build(const std::vector<IP_Table_Entry>& entries, size_t max_cells) {
+    num_entries_ = entries.size();
+    std::vector<uint32_t> src_bounds, dst_bounds;
+    elementary_bounds(entries, true, src_bounds);
+    elementary_bounds(entries, false, dst_bounds);
+    src_classes_ = static_cast<uint32_t>(src_bounds.size());
+    dst_classes_ = static_cast<uint32_t>(dst_bounds.size());
+    cells_.clear();
+    offsets_.clear();
+    items_.clear();
+    if ((uint64_t)src_classes_ * dst_classes_ > max_cells) return false;
+
+    // 每个表项在两维上覆盖的类区间；按源类起点分桶
+    struct Span {
+        uint32_t s_lo, s_hi, d_lo, d_hi;
+    };
+    std::vector<Span> spans(entries.size());
+    std::vector<std::vector<uint32_t>> starts(src_classes_);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const auto& e = entries[i];
+        spans[i].s_lo = bound_index(src_bounds, e.Src_IP_lo);
+        spans[i].s_hi = bound_index(src_bounds, e.Src_IP_hi);
+        spans[i].d_lo = bound_index(dst_bounds, e.Dst_IP_lo);
+        spans[i].d_hi = bound_index(dst_bounds, e.Dst_IP_hi);
+        starts[spans[i].s_lo].push_back(static_cast<uint32_t>(i));
+    }
+
+    // 逐行扫描源类：维护覆盖当前源类的表项（按下标升序），
+    // 展开到各目的类得到该行每个格子的列表，相同列表共用一个编号
+    cells_.assign((size_t)src_classes_ * dst_classes_, 0);
+    offsets_.push_back(0);
+    std::map<std::vector<uint32_t>, uint32_t> list_ids;
+    std::vector<std::vector<uint32_t>> row(dst_classes_);
+    std::vector<uint32_t> active;
+    for (uint32_t s = 0; s < src_classes_; ++s) {
+        size_t kept = 0;
+        for (uint32_t id : active) {
+            if (spans[id].s_hi >= s) active[kept++] = id;
+        }
+        active.resize(kept);
+        if (!starts[s].empty()) {
+            active.insert(active.end(), starts[s].begin(), starts[s].end());
+            std::sort(active.begin(), active.end());
+        }
+
+        for (auto& list : row) list.clear();
+        for (uint32_t id : active) {
+            for (uint32_t d = spans[id].d_lo; d <= spans[id].d_hi; ++d) row[d].push_back(id);
+        }
+        for (uint32_t d = 0; d < dst_classes_; ++d) {
+            auto it = list_ids.find(row[d]);
+            if (it == list_ids.end()) {
+                uint32_t list = static_cast<uint32_t>(offsets_.size() - 1);
+                for (uint32_t id : row[d]) {
+                    Item item = { id, entries[id].Proto };
+                    items_.push_back(item);
+                }
+                offsets_.push_back(static_cast<uint32_t>(items_.size()));
+                it = list_ids.insert(std::make_pair(row[d], list)).first;
+            }
+            cells_[(size_t)s * dst_classes_ + d] = it->second;
+        }
+    }
+    items_.shrink_to_fit();
+    offsets_.shrink_to_fit();
+
+    src_trie_.build(src_bounds);
+    dst_trie_.build(dst_bounds);
+    return true;
+}
+
+size_t PoptrieIPIndex::memory_bytes() const {
+    return src_trie_.memory_bytes() + dst_trie_.memory_bytes() +
+           cells_.capacity() * sizeof(uint32_t) +
+           offsets_.capacity() * sizeof(uint32_t) +
+           items_.capacity() * sizeof(Item);
+}
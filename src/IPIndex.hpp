@@ -0,0 +1,226 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+
+// ---------------2D IP Range Index---------------------
+// IP_Table_Entry 的 (源 IP 区间 × 目的 IP 区间 × 协议) 索引，表项下标即优先级（越小越高）
+//   1) 源 IP：所有区间端点切成基本区间，在基本区间上建线段树，
+//      每个表项挂到覆盖其源区间的 O(log K) 个规范节点上
+//   2) 目的 IP：每个线段树节点上的表项按 Dst_IP_lo 排序，
+//      隐式平衡二叉树（数组中点为根）在每个子树上记录 Dst_IP_hi 最大值，
+//      刺穿查询时剪掉 max_hi < dst 或 lo > dst 的子树
+// 查询沿源 IP 所在叶子到根的路径访问 O(log K) 个节点
+class IPRangeIndex {
+public:
+    void build(const std::vector<IP_Table_Entry>& entries);
+
+    // 所有命中的表项下标（无序追加到 out）
+    void query(uint32_t src_ip, uint32_t dst_ip, uint8_t proto, std::vector<uint32_t>& out) const;
+
+    // 优先级最高（下标最小）的命中表项，未命中返回 NOT_FOUND
+    uint32_t query_first(uint32_t src_ip, uint32_t dst_ip, uint8_t proto) const;
+
+    // 对每个命中的表项下标调用 visit(id)，不分配内存
+    template <typename Visit>
+    void for_each_match(uint32_t src_ip, uint32_t dst_ip, uint8_t proto, Visit visit) const {
+        if (bounds_.empty()) return;
+        size_t seg = std::upper_bound(bounds_.begin(), bounds_.end(), src_ip) - bounds_.begin() - 1;
+        for (size_t node = seg + leaves_; node >= 1; node >>= 1) {
+            if (offsets_[node] != offsets_[node + 1]) {
+                stab(offsets_[node], offsets_[node + 1], dst_ip, proto, visit);
+            }
+        }
+    }
+
+    static const uint32_t NOT_FOUND = 0xFFFFFFFFu;
+
+    size_t entries() const { return num_entries_; }
+    size_t segments() const { return bounds_.size(); }
+    size_t stored_items() const { return items_.size(); }
+    size_t memory_bytes() const;
+
+private:
+    struct DstItem {
+        uint32_t lo, hi;
+        uint32_t max_hi;   // 隐式子树 [l, r) 内 hi 的最大值，存于中点
+        uint32_t id;
+        uint8_t  proto;
+    };
+
+    void finalize_node(uint32_t begin, uint32_t end);
+    uint32_t fill_max_hi(uint32_t l, uint32_t r);
+
+    // 节点内目的 IP 刺穿查询，显式栈深度不超过隐式树高
+    template <typename Visit>
+    void stab(uint32_t begin, uint32_t end, uint32_t dst_ip, uint8_t proto, Visit& visit) const {
+        uint32_t stack_l[64], stack_r[64];
+        int top = 0;
+        stack_l[top] = begin;
+        stack_r[top] = end;
+        ++top;
+        while (top > 0) {
+            --top;
+            uint32_t l = stack_l[top], r = stack_r[top];
+            while (l < r) {
+                uint32_t mid = l + (r - l) / 2;
+                const DstItem& it = items_[mid];
+                if (it.max_hi < dst_ip) break;            // 整棵子树都在 dst 左侧
+                if (it.lo <= dst_ip) {
+                    if (it.hi >= dst_ip && (it.proto == 0 || it.proto == proto)) visit(it.id);
+                    stack_l[top] = mid + 1;                // 右子树稍后处理
+                    stack_r[top] = r;
+                    ++top;
+                }
+                r = mid;                                   // lo > dst 时右子树全部跳过
+            }
+        }
+    }
+
+    size_t num_entries_ = 0;
+    size_t leaves_ = 0;                 // 线段树叶子数（2 的幂）
+    std::vector<uint32_t> bounds_;      // 基本区间左端点，升序，bounds_[0] = 0
+    std::vector<uint32_t> offsets_;     // 线段树节点 -> items_ 区间（CSR）
+    std::vector<DstItem> items_;
+};
+
+// ---------------Poptrie (16-8-8)---------------------
+// 单维 IP -> 基本区间编号（等价类）的多比特 trie
+//   第 0 层：高 16 位直接索引 65536 项，值为类编号或（最高位置 1）子节点下标
+//   第 1/2 层：每个节点 8 比特步长 256 个槽位，
+//     vec 标记哪些槽位是子节点，leafvec 标记叶子槽位中类编号变化的位置，
+//     子节点和叶子各自连续存放，下标由 popcount 算出（叶子按游程压缩）
+class IPPoptrie {
+public:
+    // bounds：基本区间左端点，升序且 bounds[0] = 0
+    void build(const std::vector<uint32_t>& bounds);
+
+    uint32_t lookup(uint32_t ip) const {
+        uint32_t v = top_[ip >> 16];
+        if (!(v & NODE_FLAG)) return v;
+        const Node* node = &nodes_[v & ~NODE_FLAG];
+        uint32_t slot = (ip >> 8) & 0xFF;
+        if (test(node->vec, slot)) {
+            node = &nodes_[node->base1 + rank(node->vec, slot) - 1];
+            slot = ip & 0xFF;
+        }
+        return leaves_[node->base0 + rank(node->leafvec, slot) - 1];
+    }
+
+    size_t nodes() const { return nodes_.size(); }
+    size_t memory_bytes() const;
+
+private:
+    static const uint32_t NODE_FLAG = 0x80000000u;
+
+    struct Node {
+        uint64_t vec[4];
+        uint64_t leafvec[4];
+        uint32_t base0;    // 叶子起点
+        uint32_t base1;    // 子节点起点
+    };
+
+    static bool test(const uint64_t* bits, uint32_t slot) {
+        return (bits[slot >> 6] >> (slot & 63)) & 1;
+    }
+    // bits 中 [0, slot] 的置位数
+    static uint32_t rank(const uint64_t* bits, uint32_t slot) {
+        uint32_t w = slot >> 6;
+        uint32_t n = __builtin_popcountll(bits[w] & ((2ULL << (slot & 63)) - 1));
+        for (uint32_t k = 0; k < w; ++k) n += __builtin_popcountll(bits[k]);
+        return n;
+    }
+
+    uint32_t class_of(uint32_t ip) const;
+    void build_node(uint32_t index, uint32_t start, uint32_t shift);
+
+    std::vector<uint32_t> bounds_;
+    std::vector<uint32_t> top_;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> leaves_;
+};
+
+// ---------------Poptrie Cross-Product IP Index---------------------
+// 与 IPRangeIndex 接口相同：源 / 目的各一棵 IPPoptrie 得到等价类 (s, d)，
+// 交叉乘积表 cells_[s * D + d] 指向命中表项列表（按下标升序，相同列表只存一份）。
+// 查询是两次 trie 查找加一次表查，与表项数无关；
+// 交叉乘积规模超过预算时 build 返回 false，调用方应退回 IPRangeIndex
+class PoptrieIPIndex {
+public:
+    static const size_t DEFAULT_MAX_CELLS = 1u << 22;
+
+    bool build(const std::vector<IP_Table_Entry>& entries, size_t max_cells = DEFAULT_MAX_CELLS);
+
+    // 按下标升序对每个命中的表项调用 visit(id)
+    template <typename Visit>
+    void for_each_match(uint32_t src_ip, uint32_t dst_ip, uint8_t proto, Visit visit) const {
+        uint32_t list = cells_[src_trie_.lookup(src_ip) * dst_classes_ + dst_trie_.lookup(dst_ip)];
+        for (uint32_t k = offsets_[list]; k < offsets_[list + 1]; ++k) {
+            if (items_[k].proto == 0 || items_[k].proto == proto) visit(items_[k].id);
+        }
+    }
+
+    uint32_t query_first(uint32_t src_ip, uint32_t dst_ip, uint8_t proto) const {
+        uint32_t list = cells_[src_trie_.lookup(src_ip) * dst_classes_ + dst_trie_.lookup(dst_ip)];
+        for (uint32_t k = offsets_[list]; k < offsets_[list + 1]; ++k) {
+            if (items_[k].proto == 0 || items_[k].proto == proto) return items_[k].id;
+        }
+        return IPRangeIndex::NOT_FOUND;
+    }
+
+    size_t entries() const { return num_entries_; }
+    size_t src_classes() const { return src_classes_; }
+    size_t dst_classes() const { return dst_classes_; }
+    size_t cells() const { return cells_.size(); }
+    size_t lists() const { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+    size_t stored_items() const { return items_.size(); }
+    size_t memory_bytes() const;
+
+private:
+    struct Item {
+        uint32_t id;
+        uint32_t proto;
+    };
+
+    size_t num_entries_ = 0;
+    uint32_t src_classes_ = 0, dst_classes_ = 0;
+    IPPoptrie src_trie_, dst_trie_;
+    std::vector<uint32_t> cells_;     // (s, d) -> 列表编号
+    std::vector<uint32_t> offsets_;   // 列表编号 -> items_ 区间（CSR）
+    std::vector<Item> items_;
+};
+
+// ---------------IP Stage Index---------------------
+// 分类器 IP 阶段：优先 PoptrieIPIndex，交叉乘积超出预算（或 use_poptrie = false）时用 IPRangeIndex
+class IPStageIndex {
+public:
+    void build(const std::vector<IP_Table_Entry>& entries, bool use_poptrie = true) {
+        use_poptrie_ = use_poptrie && poptrie_.build(entries);
+        if (use_poptrie_) {
+            range_ = IPRangeIndex();
+        } else {
+            poptrie_ = PoptrieIPIndex();
+            range_.build(entries);
+        }
+    }
+
+    template <typename Visit>
+    void for_each_match(uint32_t src_ip, uint32_t dst_ip, uint8_t proto, Visit visit) const {
+        if (use_poptrie_) {
+            poptrie_.for_each_match(src_ip, dst_ip, proto, visit);
+        } else {
+            range_.for_each_match(src_ip, dst_ip, proto, visit);
+        }
+    }
+
+    const char* name() const { return use_poptrie_ ? "poptrie" : "segtree"; }
+    size_t memory_bytes() const { return poptrie_.memory_bytes() + range_.memory_bytes(); }
+
+private:
+    bool use_poptrie_ = false;
+    PoptrieIPIndex poptrie_;
+    IPRangeIndex range_;
+};
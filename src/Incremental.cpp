@@ -0,0 +1,609 @@
+/** *************************************************************/
+// @Name: Incremental.cpp
+// @Function: Incremental rule insert / delete with per-LRMID table deltas
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "Incremental.hpp"
+
+using namespace std;
+
+// ---------------Table Delta---------------------
+void TableDelta::clear() {
+    ip_add.clear();
+    ip_modify.clear();
+    ip_delete.clear();
+    lrme_add.clear();
+    lrme_delete.clear();
+}
+
+bool TableDelta::empty() const {
+    return size() == 0;
+}
+
+size_t TableDelta::size() const {
+    return ip_add.size() + ip_modify.size() + ip_delete.size() + lrme_add.size() + lrme_delete.size();
+}
+
+bool same_ip_table_entry(const IP_Table_Entry& a, const IP_Table_Entry& b) {
+    return a.Src_IP_lo == b.Src_IP_lo && a.Src_IP_hi == b.Src_IP_hi &&
+           a.Dst_IP_lo == b.Dst_IP_lo && a.Dst_IP_hi == b.Dst_IP_hi &&
+           a.Proto == b.Proto &&
+           a.Src_ANY_LRMID == b.Src_ANY_LRMID && a.Dst_ANY_LRMID == b.Dst_ANY_LRMID &&
+           a.No_ANY_LRMID == b.No_ANY_LRMID &&
+           a.Src_ANY_REV_Flag == b.Src_ANY_REV_Flag && a.Dst_ANY_REV_Flag == b.Dst_ANY_REV_Flag &&
+           a.No_ANY_REV_Flag == b.No_ANY_REV_Flag && a.drop_flag == b.drop_flag;
+}
+
+bool same_lrme_entry(const LRME_Entry& a, const LRME_Entry& b) {
+    return a.LRMID == b.LRMID && a.ANY_Flag == b.ANY_Flag &&
+           a.SrcPAI == b.SrcPAI && a.DstPAI == b.DstPAI &&
+           a.Src_32bitmap == b.Src_32bitmap && a.Dst_32bitmap == b.Dst_32bitmap;
+}
+
+bool lrme_entry_less(const LRME_Entry& a, const LRME_Entry& b) {
+    if (a.LRMID != b.LRMID) return a.LRMID < b.LRMID;
+    if (a.ANY_Flag != b.ANY_Flag) return a.ANY_Flag < b.ANY_Flag;
+    if (a.SrcPAI != b.SrcPAI) return a.SrcPAI < b.SrcPAI;
+    if (a.DstPAI != b.DstPAI) return a.DstPAI < b.DstPAI;
+    if (a.Src_32bitmap != b.Src_32bitmap) return a.Src_32bitmap < b.Src_32bitmap;
+    return a.Dst_32bitmap < b.Dst_32bitmap;
+}
+
+bool apply_table_delta(const TableDelta& delta, TableImage& image) {
+    bool ok = true;
+    // 先删后加：同一 delta 内 LRMID 被回收又复用时顺序才正确
+    for (uint32_t lrmid : delta.ip_delete) {
+        if (image.ip.erase(lrmid) == 0) {
+            cerr << "[WARN] [apply_table_delta] delete of missing IP entry, LRMID " << lrmid << endl;
+            ok = false;
+        }
+    }
+    for (const auto& e : delta.lrme_delete) {
+        auto it = image.lrme.find(e.LRMID);
+        bool found = false;
+        if (it != image.lrme.end()) {
+            auto& list = it->second;
+            auto pos = lower_bound(list.begin(), list.end(), e, lrme_entry_less);
+            if (pos != list.end() && same_lrme_entry(*pos, e)) {
+                list.erase(pos);
+                found = true;
+                if (list.empty()) image.lrme.erase(it);
+            }
+        }
+        if (!found) {
+            cerr << "[WARN] [apply_table_delta] delete of missing LRME entry, LRMID " << e.LRMID << endl;
+            ok = false;
+        }
+    }
+    for (const auto& d : delta.ip_modify) {
+        auto it = image.ip.find(d.lrmid);
+        if (it == image.ip.end()) {
+            cerr << "[WARN] [apply_table_delta] modify of missing IP entry, LRMID " << d.lrmid << endl;
+            ok = false;
+            continue;
+        }
+        it->second = d.entry;
+    }
+    for (const auto& d : delta.ip_add) {
+        if (!image.ip.insert(make_pair(d.lrmid, d.entry)).second) {
+            cerr << "[WARN] [apply_table_delta] duplicate IP entry, LRMID " << d.lrmid << endl;
+            ok = false;
+        }
+    }
+    for (const auto& e : delta.lrme_add) {
+        auto& list = image.lrme[e.LRMID];
+        auto pos = lower_bound(list.begin(), list.end(), e, lrme_entry_less);
+        if (pos != list.end() && same_lrme_entry(*pos, e)) {
+            cerr << "[WARN] [apply_table_delta] duplicate LRME entry, LRMID " << e.LRMID << endl;
+            ok = false;
+            continue;
+        }
+        list.insert(pos, e);
+    }
+    return ok;
+}
+
+bool same_table_image(const TableImage& a, const TableImage& b) {
+    if (a.ip.size() != b.ip.size() || a.lrme.size() != b.lrme.size()) return false;
+    for (auto ia = a.ip.begin(), ib = b.ip.begin(); ia != a.ip.end(); ++ia, ++ib) {
+        if (ia->first != ib->first || !same_ip_table_entry(ia->second, ib->second)) return false;
+    }
+    for (auto la = a.lrme.begin(), lb = b.lrme.begin(); la != a.lrme.end(); ++la, ++lb) {
+        if (la->first != lb->first || la->second.size() != lb->second.size()) return false;
+        for (size_t i = 0; i < la->second.size(); ++i) {
+            if (!same_lrme_entry(la->second[i], lb->second[i])) return false;
+        }
+    }
+    return true;
+}
+
+void diff_table_images(const TableImage& from, const TableImage& to, TableDelta& delta) {
+    auto a = from.ip.begin(), b = to.ip.begin();
+    while (a != from.ip.end() || b != to.ip.end()) {
+        if (b == to.ip.end() || (a != from.ip.end() && a->first < b->first)) {
+            delta.ip_delete.push_back(a->first);
+            ++a;
+        } else if (a == from.ip.end() || b->first < a->first) {
+            IPDelta d = { b->first, b->second };
+            delta.ip_add.push_back(d);
+            ++b;
+        } else {
+            if (!same_ip_table_entry(a->second, b->second)) {
+                IPDelta d = { b->first, b->second };
+                delta.ip_modify.push_back(d);
+            }
+            ++a;
+            ++b;
+        }
+    }
+
+    // 每个 LRMID 的表项已按 lrme_entry_less 排序，且 LRMID 是排序的第一关键字
+    static const vector<LRME_Entry> none;
+    auto la = from.lrme.begin(), lb = to.lrme.begin();
+    while (la != from.lrme.end() || lb != to.lrme.end()) {
+        const vector<LRME_Entry>* old_list = &none;
+        const vector<LRME_Entry>* new_list = &none;
+        if (lb == to.lrme.end() || (la != from.lrme.end() && la->first < lb->first)) {
+            old_list = &(la++)->second;
+        } else if (la == from.lrme.end() || lb->first < la->first) {
+            new_list = &(lb++)->second;
+        } else {
+            old_list = &(la++)->second;
+            new_list = &(lb++)->second;
+        }
+        set_difference(old_list->begin(), old_list->end(), new_list->begin(), new_list->end(),
+                       back_inserter(delta.lrme_delete), lrme_entry_less);
+        set_difference(new_list->begin(), new_list->end(), old_list->begin(), old_list->end(),
+                       back_inserter(delta.lrme_add), lrme_entry_less);
+    }
+}
+
+// IP_Table_Entry 的 LRMID 字段为 16 位，0xFFFF 表示未设置，所以可用编号为 0..0xFFFE
+static const uint32_t MAX_LRMID = 0xFFFF;
+
+bool save_lrmid_map(const std::vector<LRMIDBinding>& bindings, const std::string& output_file) {
+    ofstream ofs(output_file);
+    if (!ofs.is_open()) {
+        cerr << "[ERROR] Failed to open output file: " << output_file << endl;
+        return false;
+    }
+    ofs << "# LRMID Src_IP_lo Src_IP_hi Dst_IP_lo Dst_IP_hi Proto\n";
+    for (const auto& b : bindings) {
+        ofs << b.lrmid << " " << b.key.src_lo << " " << b.key.src_hi << " "
+            << b.key.dst_lo << " " << b.key.dst_hi << " " << (unsigned)b.key.proto << "\n";
+    }
+    ofs.close();
+    if (!ofs) {
+        cerr << "[ERROR] Failed to write LRMID map: " << output_file << endl;
+        return false;
+    }
+    return true;
+}
+
+bool load_lrmid_map(const std::string& file, std::vector<LRMIDBinding>& bindings) {
+    bindings.clear();
+    ifstream ifs(file);
+    if (!ifs.is_open()) {
+        cerr << "[ERROR] Failed to open LRMID map: " << file << endl;
+        return false;
+    }
+    string line;
+    size_t line_no = 0;
+    while (getline(ifs, line)) {
+        line_no++;
+        size_t p = line.find_first_not_of(" \t\r");
+        if (p == string::npos || line[p] == '#') continue;
+        istringstream iss(line);
+        unsigned long long v[6];
+        if (!(iss >> v[0] >> v[1] >> v[2] >> v[3] >> v[4] >> v[5]) ||
+            v[0] >= MAX_LRMID || v[1] > 0xFFFFFFFFull || v[2] > 0xFFFFFFFFull ||
+            v[3] > 0xFFFFFFFFull || v[4] > 0xFFFFFFFFull || v[5] > 0xFFull) {
+            cerr << "[WARN] " << file << ":" << line_no << " invalid LRMID binding, skipped" << endl;
+            continue;
+        }
+        LRMIDBinding b;
+        b.lrmid = static_cast<uint32_t>(v[0]);
+        b.key.src_lo = static_cast<uint32_t>(v[1]);
+        b.key.src_hi = static_cast<uint32_t>(v[2]);
+        b.key.dst_lo = static_cast<uint32_t>(v[3]);
+        b.key.dst_hi = static_cast<uint32_t>(v[4]);
+        b.key.proto = static_cast<uint8_t>(v[5]);
+        bindings.push_back(b);
+    }
+    return true;
+}
+
+static string lrmid_field(uint16_t lrmid, bool rev) {
+    if (lrmid == 0xFFFF) return "-";
+    return to_string(lrmid) + (rev ? "/REV" : "");
+}
+
+static void write_ip_line(ofstream& ofs, char op, uint32_t lrmid, const IP_Table_Entry& e) {
+    ofs << op << " IP   " << left << setw(8) << lrmid
+        << setw(20) << ip_range_to_cidr(e.Src_IP_lo, e.Src_IP_hi)
+        << setw(20) << ip_range_to_cidr(e.Dst_IP_lo, e.Dst_IP_hi)
+        << "0x" << hex << right << setfill('0') << setw(2) << (int)e.Proto << dec << setfill(' ') << left
+        << " SrcANY=" << setw(10) << lrmid_field(e.Src_ANY_LRMID, e.Src_ANY_REV_Flag)
+        << " DstANY=" << setw(10) << lrmid_field(e.Dst_ANY_LRMID, e.Dst_ANY_REV_Flag)
+        << " NoANY=" << setw(10) << lrmid_field(e.No_ANY_LRMID, e.No_ANY_REV_Flag)
+        << " drop=" << (e.drop_flag ? 1 : 0) << "\n";
+}
+
+static void write_lrme_line(ofstream& ofs, char op, const LRME_Entry& e) {
+    ofs << op << " LRME " << left << setw(8) << e.LRMID
+        << "ANY=" << e.ANY_Flag
+        << " SrcPAI=" << setw(6) << (e.SrcPAI == 0xFFFF ? string("ANY") : to_string(e.SrcPAI))
+        << " DstPAI=" << setw(6) << (e.DstPAI == 0xFFFF ? string("ANY") : to_string(e.DstPAI))
+        << hex << setfill('0')
+        << " Src=0x" << right << setw(8) << e.Src_32bitmap
+        << " Dst=0x" << setw(8) << e.Dst_32bitmap
+        << dec << setfill(' ') << "\n";
+}
+
+void output_table_delta(
+    const TableDelta& delta,
+    const std::string& output_file
+) {
+    ofstream ofs(output_file);
+    if (!ofs.is_open()) {
+        cerr << "[ERROR] Failed to open output file: " << output_file << endl;
+        return;
+    }
+
+    // 下发顺序：先删（释放 LRMID / 表项），再改，最后加
+    for (uint32_t lrmid : delta.ip_delete) ofs << "- IP   " << lrmid << "\n";
+    for (const auto& e : delta.lrme_delete) write_lrme_line(ofs, '-', e);
+    for (const auto& d : delta.ip_modify) write_ip_line(ofs, '~', d.lrmid, d.entry);
+    for (const auto& d : delta.ip_add) write_ip_line(ofs, '+', d.lrmid, d.entry);
+    for (const auto& e : delta.lrme_add) write_lrme_line(ofs, '+', e);
+
+    cout << "[output_table_delta] IP +" << delta.ip_add.size() << " ~" << delta.ip_modify.size()
+         << " -" << delta.ip_delete.size() << ", LRME +" << delta.lrme_add.size()
+         << " -" << delta.lrme_delete.size() << " written to: " << output_file << endl;
+}
+
+// ---------------Incremental Compiler---------------------
+IPKey IncrementalCompiler::key_of(const Rule5D& rule) {
+    IPKey key = {
+        rule.range[0][0], rule.range[0][1],
+        rule.range[1][0], rule.range[1][1],
+        static_cast<uint8_t>(rule.range[4][0])
+    };
+    return key;
+}
+
+uint32_t IncrementalCompiler::lrmid_of(uint32_t priority) const {
+    auto it = rules_.find(priority);
+    return it == rules_.end() ? FlatKeyIndex<IPKey, IPKeyHash>::NOT_FOUND : it->second.lrmid;
+}
+
+// 已存在的 IP key 返回其 LRMID，否则复用最小的空闲 LRMID 或追加新编号
+uint32_t IncrementalCompiler::allocate_lrmid(const IPKey& key) {
+    uint32_t lrmid = key_index_.find(key);
+    if (lrmid != FlatKeyIndex<IPKey, IPKeyHash>::NOT_FOUND) return lrmid;
+
+    if (!free_lrmids_.empty()) {
+        lrmid = *free_lrmids_.begin();
+        free_lrmids_.erase(free_lrmids_.begin());
+    } else {
+        lrmid = static_cast<uint32_t>(groups_.size());
+        groups_.push_back(Group());
+    }
+    if ((key_index_.size() + 1) * 2 > key_index_.capacity()) key_index_.rehash(key_index_.size() * 2 + 1);
+    key_index_.find_or_insert(key, lrmid);
+
+    Group& g = groups_[lrmid];
+    g.key = key;
+    g.live = false;   // 由 recompile 置位
+    g.prios.clear();
+    g.lrme_refs.clear();
+    return lrmid;
+}
+
+// 与全量流程相同的步骤：MergedItem -> PortBlock -> 32 端口切分 -> LRME
+static MergedItem merged_item_of(uint32_t lrmid, const Rule5D& r) {
+    MergedItem item;
+    item.LRMID = lrmid;
+    item.Src_Port_lo = static_cast<uint16_t>(r.range[2][0]);
+    item.Src_Port_hi = static_cast<uint16_t>(r.range[2][1]);
+    item.Dst_Port_lo = static_cast<uint16_t>(r.range[3][0]);
+    item.Dst_Port_hi = static_cast<uint16_t>(r.range[3][1]);
+    item.action = r.action;
+    return item;
+}
+
+void IncrementalCompiler::rule_lrme_entries(uint32_t lrmid, const Rule5D& rule, vector<LRME_Entry>& out) {
+    vector<PortBlock> subset;
+    Split_Port_Block(make_port_block(lrmid, merged_item_of(lrmid, rule)), subset);
+    out.clear();
+    out.reserve(subset.size());
+    for (const auto& block : subset) out.push_back(make_lrme_entry(block));
+}
+
+// IP 表项由组内全部 PortBlock 决定（同类 ANY 中任一条带 REV 即置位 REV）
+IP_Table_Entry IncrementalCompiler::group_ip_entry(uint32_t lrmid) const {
+    const Group& g = groups_[lrmid];
+    vector<PortBlock> blocks;
+    blocks.reserve(g.prios.size());
+    for (uint32_t prio : g.prios) {
+        blocks.push_back(make_port_block(lrmid, merged_item_of(lrmid, rules_.find(prio)->second.rule)));
+    }
+
+    MergrdR ip_rule;
+    ip_rule.Src_IP_lo = g.key.src_lo;
+    ip_rule.Src_IP_hi = g.key.src_hi;
+    ip_rule.Dst_IP_lo = g.key.dst_lo;
+    ip_rule.Dst_IP_hi = g.key.dst_hi;
+    ip_rule.Proto = g.key.proto;
+    ip_rule.LRMID = lrmid;
+    return make_ip_table_entry(ip_rule, blocks.data(), blocks.size());
+}
+
+void IncrementalCompiler::release_lrmid(uint32_t lrmid) {
+    Group& g = groups_[lrmid];
+    key_index_.erase(g.key);
+    free_lrmids_.insert(lrmid);
+    g.live = false;
+    g.lrme_refs.clear();
+    live_groups_--;
+}
+
+void IncrementalCompiler::load(
+    const std::vector<Rule5D>& rules,
+    const std::vector<LRMIDBinding>& pinned
+) {
+    rules_.clear();
+    groups_.clear();
+    free_lrmids_.clear();
+    key_index_ = FlatKeyIndex<IPKey, IPKeyHash>(rules.size() + pinned.size());
+    live_groups_ = 0;
+    lrme_count_ = 0;
+
+    // 1) 预置固定编号；重复的 key 或 LRMID 只保留第一条。
+    //    编号不小于 min(MAX_LRMID, rules + pinned) 的绑定直接拒绝：
+    //    既放不进 16 位的 IP 表字段，也会让 groups_ / 空闲集合按编号无界增长
+    size_t limit = std::min<size_t>(MAX_LRMID, rules.size() + pinned.size());
+    vector<char> taken;
+    size_t conflicts = 0, rejected = 0;
+    for (const auto& b : pinned) {
+        if (b.lrmid >= limit) {
+            rejected++;
+            continue;
+        }
+        if (b.lrmid >= groups_.size()) {
+            groups_.resize(b.lrmid + 1);
+            taken.resize(b.lrmid + 1, 0);
+        }
+        if (taken[b.lrmid] || key_index_.find(b.key) != FlatKeyIndex<IPKey, IPKeyHash>::NOT_FOUND) {
+            conflicts++;
+            continue;
+        }
+        taken[b.lrmid] = 1;
+        groups_[b.lrmid].key = b.key;
+        key_index_.find_or_insert(b.key, b.lrmid);
+    }
+
+    // 2) 新规则集中不再出现的固定编号以及编号空洞进入空闲集合
+    vector<char> used(groups_.size(), 0);
+    for (const auto& r : rules) {
+        uint32_t lrmid = key_index_.find(key_of(r));
+        if (lrmid != FlatKeyIndex<IPKey, IPKeyHash>::NOT_FOUND) used[lrmid] = 1;
+    }
+    size_t kept = 0;
+    for (uint32_t lrmid = 0; lrmid < groups_.size(); ++lrmid) {
+        if (used[lrmid]) {
+            kept++;
+            continue;
+        }
+        if (taken[lrmid]) key_index_.erase(groups_[lrmid].key);
+        free_lrmids_.insert(lrmid);
+    }
+
+    // 3) 逐条加入规则，未固定的 IP key 按首次出现顺序分配编号
+    size_t skipped = 0;
+    vector<LRME_Entry> entries;
+    for (const auto& r : rules) {
+        if (rules_.count(r.priority)) {
+            skipped++;
+            continue;
+        }
+        uint32_t lrmid = allocate_lrmid(key_of(r));
+        RuleSlot slot = { r, lrmid };
+        rules_.insert(make_pair(r.priority, slot));
+        Group& g = groups_[lrmid];
+        g.prios.insert(upper_bound(g.prios.begin(), g.prios.end(), r.priority), r.priority);
+        rule_lrme_entries(lrmid, r, entries);
+        for (const auto& e : entries) {
+            if (++g.lrme_refs[e] == 1) lrme_count_++;
+        }
+    }
+
+    for (uint32_t lrmid = 0; lrmid < groups_.size(); ++lrmid) {
+        Group& g = groups_[lrmid];
+        if (g.prios.empty()) continue;
+        g.ip = group_ip_entry(lrmid);
+        g.live = true;
+        live_groups_++;
+    }
+
+    if (skipped) {
+        cerr << "[WARN] [IncrementalCompiler::load] " << skipped << " rules with duplicate priority skipped" << endl;
+    }
+    if (conflicts) {
+        cerr << "[WARN] [IncrementalCompiler::load] " << conflicts << " conflicting LRMID bindings ignored" << endl;
+    }
+    if (rejected) {
+        cerr << "[WARN] [IncrementalCompiler::load] " << rejected << " LRMID bindings >= " << limit
+             << " rejected" << endl;
+    }
+    cout << "[IncrementalCompiler::load] " << rules_.size() << " rules, " << live_groups_
+         << " LRMIDs";
+    if (!pinned.empty()) cout << " (" << kept << " kept from " << pinned.size() << " pinned)";
+    cout << ", " << lrme_count_ << " LRME entries" << endl;
+}
+
+bool IncrementalCompiler::add_rule(const Rule5D& rule, TableDelta& delta) {
+    if (rules_.count(rule.priority)) return false;
+
+    uint32_t lrmid = allocate_lrmid(key_of(rule));
+    RuleSlot slot = { rule, lrmid };
+    rules_.insert(make_pair(rule.priority, slot));
+    Group& g = groups_[lrmid];
+    g.prios.insert(upper_bound(g.prios.begin(), g.prios.end(), rule.priority), rule.priority);
+
+    IP_Table_Entry ip = group_ip_entry(lrmid);
+    IPDelta d = { lrmid, ip };
+    if (!g.live) {
+        delta.ip_add.push_back(d);
+        g.live = true;
+        live_groups_++;
+    } else if (!same_ip_table_entry(g.ip, ip)) {
+        delta.ip_modify.push_back(d);
+    }
+    g.ip = ip;
+
+    vector<LRME_Entry> entries;
+    rule_lrme_entries(lrmid, rule, entries);
+    for (const auto& e : entries) {
+        if (++g.lrme_refs[e] == 1) {
+            delta.lrme_add.push_back(e);
+            lrme_count_++;
+        }
+    }
+    return true;
+}
+
+bool IncrementalCompiler::remove_rule(uint32_t priority, TableDelta& delta) {
+    auto it = rules_.find(priority);
+    if (it == rules_.end()) return false;
+
+    uint32_t lrmid = it->second.lrmid;
+    vector<LRME_Entry> entries;
+    rule_lrme_entries(lrmid, it->second.rule, entries);
+    rules_.erase(it);
+    Group& g = groups_[lrmid];
+    g.prios.erase(lower_bound(g.prios.begin(), g.prios.end(), priority));
+
+    for (const auto& e : entries) {
+        auto ref = g.lrme_refs.find(e);
+        if (ref == g.lrme_refs.end()) continue;
+        if (--ref->second == 0) {
+            g.lrme_refs.erase(ref);
+            delta.lrme_delete.push_back(e);
+            lrme_count_--;
+        }
+    }
+
+    if (g.prios.empty()) {
+        delta.ip_delete.push_back(lrmid);
+        release_lrmid(lrmid);
+        return true;
+    }
+    IP_Table_Entry ip = group_ip_entry(lrmid);
+    if (!same_ip_table_entry(g.ip, ip)) {
+        IPDelta d = { lrmid, ip };
+        delta.ip_modify.push_back(d);
+        g.ip = ip;
+    }
+    return true;
+}
+
+void IncrementalCompiler::full_delta(TableDelta& delta) const {
+    for (uint32_t lrmid = 0; lrmid < groups_.size(); ++lrmid) {
+        const Group& g = groups_[lrmid];
+        if (!g.live) continue;
+        IPDelta d = { lrmid, g.ip };
+        delta.ip_add.push_back(d);
+        for (const auto& kv : g.lrme_refs) delta.lrme_add.push_back(kv.first);
+    }
+}
+
+void IncrementalCompiler::snapshot(TableImage& image) const {
+    image.ip.clear();
+    image.lrme.clear();
+    for (uint32_t lrmid = 0; lrmid < groups_.size(); ++lrmid) {
+        const Group& g = groups_[lrmid];
+        if (!g.live) continue;
+        image.ip[lrmid] = g.ip;
+        vector<LRME_Entry>& list = image.lrme[lrmid];
+        for (const auto& kv : g.lrme_refs) list.push_back(kv.first);   // map 已按内容排序
+    }
+}
+
+std::vector<LRMIDBinding> IncrementalCompiler::bindings() const {
+    vector<LRMIDBinding> out;
+    out.reserve(live_groups_);
+    for (uint32_t lrmid = 0; lrmid < groups_.size(); ++lrmid) {
+        if (!groups_[lrmid].live) continue;
+        LRMIDBinding b = { groups_[lrmid].key, lrmid };
+        out.push_back(b);
+    }
+    return out;
+}
+
+void IncrementalCompiler::export_tables(
+    std::vector<Rule5D>& rules,
+    std::vector<MergrdR>& merged_ip_table,
+    MergedItemTable& metainfo,
+    PortBlockTable& optimal_metainfo,
+    std::vector<IP_Table_Entry>& final_ip_table,
+    std::vector<LRME_Entry>& lrme_entries
+) const {
+    rules.clear();
+    merged_ip_table.clear();
+    metainfo.clear();
+    optimal_metainfo.clear();
+    final_ip_table.clear();
+    lrme_entries.clear();
+    lrme_entries.reserve(lrme_count_);
+
+    // priority -> rules 下标
+    unordered_map<uint32_t, size_t> index_of;
+    index_of.reserve(rules_.size());
+    rules.reserve(rules_.size());
+    for (const auto& kv : rules_) {
+        index_of[kv.first] = rules.size();
+        rules.push_back(kv.second.rule);
+    }
+
+    metainfo.reserve(live_groups_, rules_.size());
+    optimal_metainfo.reserve(live_groups_, rules_.size());
+    for (uint32_t slot = 0; slot < groups_.size(); ++slot) {
+        const Group& g = groups_[slot];
+        if (!g.live) continue;
+        uint32_t lrmid = static_cast<uint32_t>(merged_ip_table.size());
+
+        MergrdR m;
+        m.Src_IP_lo = g.key.src_lo;
+        m.Src_IP_hi = g.key.src_hi;
+        m.Dst_IP_lo = g.key.dst_lo;
+        m.Dst_IP_hi = g.key.dst_hi;
+        m.Proto = g.key.proto;
+        m.LRMID = lrmid;
+        for (uint32_t prio : g.prios) {
+            size_t idx = index_of[prio];
+            m.merged_R.push_back(idx);
+            MergedItem item = merged_item_of(lrmid, rules[idx]);
+            metainfo.push_item(item);
+            optimal_metainfo.push_item(make_port_block(lrmid, item));
+        }
+        metainfo.end_group();
+        optimal_metainfo.end_group();
+
+        const auto blocks = optimal_metainfo[lrmid];
+        final_ip_table.push_back(make_ip_table_entry(m, blocks.begin(), blocks.size()));
+        merged_ip_table.push_back(std::move(m));
+        for (const auto& kv : g.lrme_refs) {
+            LRME_Entry e = kv.first;
+            e.LRMID = lrmid;
+            lrme_entries.push_back(e);
+        }
+    }
+}
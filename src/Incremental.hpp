@@ -0,0 +1,145 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+
+// ---------------Table Delta---------------------
+// 交换机控制面需要下发的变化：IP 表项按 LRMID 寻址（一个 LRMID 对应一条 IP 表项），
+// LRME 表项没有独立编号，按完整内容（LRMID, ANY_Flag, PAI, bitmap）增删
+struct IPDelta {
+    uint32_t lrmid;
+    IP_Table_Entry entry;
+};
+
+struct TableDelta {
+    std::vector<IPDelta> ip_add;
+    std::vector<IPDelta> ip_modify;
+    std::vector<uint32_t> ip_delete;        // LRMID
+    std::vector<LRME_Entry> lrme_add;
+    std::vector<LRME_Entry> lrme_delete;
+
+    void clear();
+    bool empty() const;
+    size_t size() const;   // 总变更条数
+};
+
+// 交换机侧表内容的镜像（LRMID -> IP 表项 / LRME 表项），用于验证 delta 的可回放性
+struct TableImage {
+    std::map<uint32_t, IP_Table_Entry> ip;
+    std::map<uint32_t, std::vector<LRME_Entry>> lrme;   // 每个 LRMID 的表项，按内容排序
+};
+
+bool same_ip_table_entry(const IP_Table_Entry& a, const IP_Table_Entry& b);
+bool same_lrme_entry(const LRME_Entry& a, const LRME_Entry& b);
+bool lrme_entry_less(const LRME_Entry& a, const LRME_Entry& b);
+
+// 把 delta 回放到 image；出现删除不存在 / 重复添加等不一致时打印 [WARN] 并返回 false
+bool apply_table_delta(const TableDelta& delta, TableImage& image);
+
+bool same_table_image(const TableImage& a, const TableImage& b);
+
+// 两个版本的表之间的最小变更：LRMID 相同的 IP 表项比较内容，LRME 按内容做集合差
+void diff_table_images(const TableImage& from, const TableImage& to, TableDelta& delta);
+
+// 人可读的 delta 文件：每行 "<+|~|-> IP|LRME <LRMID> 字段..."
+void output_table_delta(
+    const TableDelta& delta,
+    const std::string& output_file
+);
+
+// ---------------LRMID Map---------------------
+// IP key (Src/Dst IP range + Proto) 与 LRMID 的绑定，用于跨版本保持编号。
+// 文本格式：每行 "<LRMID> <Src_IP_lo> <Src_IP_hi> <Dst_IP_lo> <Dst_IP_hi> <Proto>"（十进制），# 开头为注释
+// LRMID 须小于 0xFFFF（IP 表的 16 位 LRMID 字段中 0xFFFF 表示未设置），否则该行按无效跳过；
+// save_lrmid_map 写完后检查流状态，写失败时返回 false
+struct LRMIDBinding {
+    IPKey key;
+    uint32_t lrmid;
+};
+
+bool save_lrmid_map(const std::vector<LRMIDBinding>& bindings, const std::string& output_file);
+bool load_lrmid_map(const std::string& file, std::vector<LRMIDBinding>& bindings);
+
+// ---------------Incremental Compiler---------------------
+// 增量维护 merged_ip_table / metainfo / PortBlock / LRME / IP_Table_Entry：
+//   - 规则按 priority 标识（越小越优先），相同 (Src IP, Dst IP, Proto) 的规则共享一个 LRMID
+//   - add_rule / remove_rule 只触及该规则所在的 LRMID：组内 LRME 表项带引用计数，
+//     只生成该条规则的 LRME 表项，计数 0->1 / 1->0 的表项即为 delta；IP 表项由组内 PortBlock 重算
+//   - LRMID 一经分配保持不变；组内规则全部删除后回收，之后新出现的 IP key 优先复用最小的空闲 LRMID
+// 不带 pinned 的 load 与 merge_same_ip_entry 的 LRMID 分配相同（按规则顺序首次出现），
+// 所以初始表与全量流程逐项一致；之后的编号只在 snapshot 中保持，export_tables 会重新压缩编号
+class IncrementalCompiler {
+public:
+    // 全量构建（清空原有状态），不产生 delta；priority 重复的规则只保留第一条。
+    // pinned 中的 IP key 若仍出现在 rules 中则沿用其 LRMID，其余 key 复用空出的最小编号
+    // LRMID >= min(0xFFFF, rules.size() + pinned.size()) 的绑定被拒绝（打印 [WARN]），该 key 重新分配编号
+    void load(
+        const std::vector<Rule5D>& rules,
+        const std::vector<LRMIDBinding>& pinned = std::vector<LRMIDBinding>()
+    );
+
+    // rule.priority 已存在时返回 false
+    bool add_rule(const Rule5D& rule, TableDelta& delta);
+    // priority 不存在时返回 false
+    bool remove_rule(uint32_t priority, TableDelta& delta);
+
+    // 当前全部表项作为一次 delta 的新增部分（交换机从空表开始下发）
+    void full_delta(TableDelta& delta) const;
+    void snapshot(TableImage& image) const;
+    // 当前存活的 IP key -> LRMID，按 LRMID 升序
+    std::vector<LRMIDBinding> bindings() const;
+
+    // 导出与全量流程相同格式的表：rules 按 priority 升序，LRMID 按编号顺序压缩为 0..n-1，
+    // merged_R 为 rules 中的下标，lrme_entries 为当前下发的 LRME 表项（按压缩后的 LRMID 分组）。
+    // 可直接交给 LRMEClassifier 等分类器
+    void export_tables(
+        std::vector<Rule5D>& rules,
+        std::vector<MergrdR>& merged_ip_table,
+        MergedItemTable& metainfo,
+        PortBlockTable& optimal_metainfo,
+        std::vector<IP_Table_Entry>& final_ip_table,
+        std::vector<LRME_Entry>& lrme_entries
+    ) const;
+
+    size_t rules() const { return rules_.size(); }
+    size_t lrmids() const { return live_groups_; }
+    size_t lrmid_slots() const { return groups_.size(); }   // 含已回收的编号
+    size_t lrme_entries() const { return lrme_count_; }
+    bool contains(uint32_t priority) const { return rules_.count(priority) != 0; }
+    // 该 priority 所在的 LRMID；不存在时返回 FlatKeyIndex<...>::NOT_FOUND
+    uint32_t lrmid_of(uint32_t priority) const;
+
+private:
+    struct LRMELess {
+        bool operator()(const LRME_Entry& a, const LRME_Entry& b) const { return lrme_entry_less(a, b); }
+    };
+    struct Group {
+        IPKey key;
+        bool live = false;
+        std::vector<uint32_t> prios;                          // 组内规则，priority 升序
+        std::map<LRME_Entry, uint32_t, LRMELess> lrme_refs;   // 去重后的 LRME 表项 -> 生成它的规则数
+        IP_Table_Entry ip;
+    };
+    struct RuleSlot {
+        Rule5D rule;
+        uint32_t lrmid;
+    };
+
+    static IPKey key_of(const Rule5D& rule);
+    uint32_t allocate_lrmid(const IPKey& key);
+    static void rule_lrme_entries(uint32_t lrmid, const Rule5D& rule, std::vector<LRME_Entry>& out);
+    IP_Table_Entry group_ip_entry(uint32_t lrmid) const;
+    void release_lrmid(uint32_t lrmid);
+
+    std::map<uint32_t, RuleSlot> rules_;          // priority -> 规则
+    std::vector<Group> groups_;                   // 下标即 LRMID
+    FlatKeyIndex<IPKey, IPKeyHash> key_index_;    // IP key -> LRMID（仅存活的组）
+    std::set<uint32_t> free_lrmids_;
+    size_t live_groups_ = 0;
+    size_t lrme_count_ = 0;
+};
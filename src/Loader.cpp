@@ -7,8 +7,13 @@
 
 #include <bits/stdc++.h>
 #include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "Loader.hpp"
+#include "BinaryIO.hpp"
 
 using namespace std;
 using u32 = uint32_t;
@@ -45,113 +50,420 @@ static std::pair<uint32_t,uint32_t> ip_range_from_parts(unsigned a, unsigned b,
 }
 
 
-void load_rules_from_file(const string &file, vector<Rule5D> &rules_out) {
-    FILE *fp = fopen(file.c_str(), "r");
-    if (!fp) {
-        fprintf(stderr, "error - cannot open rules file: %s\n", file.c_str());
-        exit(1);
+// Same layout as the old sscanf pattern. A blank in the format matches any run
+// of spaces/tabs (including none), so one pass covers both separators.
+static const char RULE_FORMAT[] =
+    "@%u.%u.%u.%u/%u %u.%u.%u.%u/%u %u : %u %u : %u %x/%x %x/%x";
+static const int RULE_FIELDS = 18;
+
+enum LineStatus {
+    LINE_OK,
+    LINE_BAD_FORMAT,
+    LINE_BAD_OCTET,
+    LINE_BAD_PORT,
+    LINE_BAD_ORDER
+};
+
+static const char *line_status_msg(LineStatus st) {
+    switch (st) {
+        case LINE_BAD_FORMAT: return "invalid format";
+        case LINE_BAD_OCTET:  return "invalid IP octet (must be 0-255)";
+        case LINE_BAD_PORT:   return "port out of range (must be 0-65535)";
+        case LINE_BAD_ORDER:  return "invalid port range (lo > hi)";
+        default:              return "ok";
     }
+}
 
-    unsigned sip1,sip2,sip3,sip4, smask;
-    unsigned dip1,dip2,dip3,dip4, dmask;
-    unsigned sport1, sport2, dport1, dport2;
-    unsigned protocol, protocol_mask;
-    unsigned action_flags, action_mask;
+static inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+}
 
-    u32 rule_count = 0;
-    u32 line_count = 0;
-    char buf[1024];
-    
-    // read lines until EOF using single buffered path
-    while (fgets(buf, sizeof(buf), fp)) {
-        line_count++;
-        
-        // Try multiple format patterns (spaces or tabs)
-        int ret = sscanf(buf, "@%u.%u.%u.%u/%u %u.%u.%u.%u/%u %u : %u %u : %u %x/%x %x/%x",
-                         &sip1,&sip2,&sip3,&sip4,&smask,
-                         &dip1,&dip2,&dip3,&dip4,&dmask,
-                         &sport1,&sport2,&dport1,&dport2,
-                         &protocol,&protocol_mask,
-                         &action_flags,&action_mask);
-        
-        if (ret < 17) {
-            // Try tab-separated format
-            ret = sscanf(buf, "@%u.%u.%u.%u/%u\t%u.%u.%u.%u/%u\t%u : %u\t%u : %u\t%x/%x\t%x/%x",
-                         &sip1,&sip2,&sip3,&sip4,&smask,
-                         &dip1,&dip2,&dip3,&dip4,&dmask,
-                         &sport1,&sport2,&dport1,&dport2,
-                         &protocol,&protocol_mask,
-                         &action_flags,&action_mask);
+static inline int hex_val(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// One numeric conversion with scanf semantics: leading blanks, optional sign,
+// optional 0x for hex, saturating accumulate then truncate to 32 bits.
+static bool scan_number(const char *&p, const char *end, int base, unsigned &out) {
+    while (p < end && is_blank(*p)) ++p;
+    bool neg = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+        neg = (*p == '-');
+        ++p;
+    }
+    if (base == 16 && end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+        p += 2;
+        if (p == end || hex_val(*p) < 0) {  // "0x" alone reads as 0
+            out = 0;
+            return true;
         }
-        
-        if (ret < 17) {
-            // skip invalid line
-            fprintf(stderr, "[WARN] Line %u: invalid format, skipping\n", line_count);
-            continue;
+    }
+    const char *digits = p;
+    uint64_t v = 0;
+    bool sat = false;
+    while (p < end) {
+        int d = (base == 16) ? hex_val(*p) : ((*p >= '0' && *p <= '9') ? *p - '0' : -1);
+        if (d < 0) break;
+        if (v > (UINT64_MAX - (uint64_t)d) / (uint64_t)base) sat = true;
+        else v = v * base + (uint64_t)d;
+        ++p;
+    }
+    if (p == digits) return false;
+    if (sat) v = UINT64_MAX;
+    else if (neg) v = 0 - v;
+    out = static_cast<unsigned>(v);
+    return true;
+}
+
+// Walk RULE_FORMAT over [p, end). Returns the number of fields converted,
+// i.e. what sscanf would have returned for the same line.
+static int scan_rule_line(const char *p, const char *end, unsigned *fields) {
+    int n = 0;
+    for (const char *f = RULE_FORMAT; *f; ++f) {
+        if (*f == ' ') {
+            while (p < end && is_blank(*p)) ++p;
+        } else if (*f == '%') {
+            ++f;
+            if (!scan_number(p, end, (*f == 'x') ? 16 : 10, fields[n])) return n;
+            ++n;
+        } else {
+            if (p == end || *p != *f) return n;
+            ++p;
         }
-        
-        // Validate IP octet ranges (must be 0-255)
-        if (sip1 > 255 || sip2 > 255 || sip3 > 255 || sip4 > 255 ||
-            dip1 > 255 || dip2 > 255 || dip3 > 255 || dip4 > 255) {
-            fprintf(stderr, "[WARN] Line %u: invalid IP octet (must be 0-255), skipping\n", line_count);
-            continue;
+    }
+    return n;
+}
+
+// Validate one text line and fill r (everything but priority).
+static LineStatus parse_rule_line(const char *p, const char *end, Rule5D &r) {
+    unsigned f[RULE_FIELDS];
+    f[RULE_FIELDS - 1] = 0;
+    if (scan_rule_line(p, end, f) < 17) {
+        return LINE_BAD_FORMAT;
+    }
+    unsigned sip1 = f[0], sip2 = f[1], sip3 = f[2], sip4 = f[3], smask = f[4];
+    unsigned dip1 = f[5], dip2 = f[6], dip3 = f[7], dip4 = f[8], dmask = f[9];
+    unsigned sport1 = f[10], sport2 = f[11], dport1 = f[12], dport2 = f[13];
+    unsigned protocol = f[14], protocol_mask = f[15];
+    unsigned action_flags = f[16];
+
+    // Validate IP octet ranges (must be 0-255)
+    if (sip1 > 255 || sip2 > 255 || sip3 > 255 || sip4 > 255 ||
+        dip1 > 255 || dip2 > 255 || dip3 > 255 || dip4 > 255) {
+        return LINE_BAD_OCTET;
+    }
+
+    // Validate port ranges (must be 0-65535)
+    if (sport1 > 65535 || sport2 > 65535 || dport1 > 65535 || dport2 > 65535) {
+        return LINE_BAD_PORT;
+    }
+
+    // Validate port ordering (lo should be <= hi)
+    if (sport1 > sport2 || dport1 > dport2) {
+        return LINE_BAD_ORDER;
+    }
+
+    // src IP
+    auto sr = ip_range_from_parts(sip1,sip2,sip3,sip4, smask);
+    r.range[0][0] = sr.first;
+    r.range[0][1] = sr.second;
+    // dst IP
+    auto dr = ip_range_from_parts(dip1,dip2,dip3,dip4, dmask);
+    r.range[1][0] = dr.first;
+    r.range[1][1] = dr.second;
+    // source port
+    r.range[2][0] = (u32)sport1;
+    r.range[2][1] = (u32)sport2;
+    // dest port
+    r.range[3][0] = (u32)dport1;
+    r.range[3][1] = (u32)dport2;
+    // protocol
+    if (protocol_mask == 0xFF) {
+        r.range[4][0] = (u32)protocol;
+        r.range[4][1] = (u32)protocol;
+    } else if (protocol_mask == 0x00) {
+        r.range[4][0] = 0u;
+        r.range[4][1] = 0xFFu;
+    } else {
+        // if other masks appear, for now treat as full range (or you can refine)
+        r.range[4][0] = 0u;
+        r.range[4][1] = 0xFFu;
+    }
+
+    // prefix_length fields: keep same semantics as original simple loader
+    r.prefix_length[0] = (int)smask;
+    r.prefix_length[1] = (int)dmask;
+    r.prefix_length[2] = (sport1 == sport2) ? 0 : 1;
+    r.prefix_length[3] = (dport1 == dport2) ? 0 : 1;
+    r.prefix_length[4] = (protocol_mask != 0x00) ? 0 : 1;
+
+    r.action = static_cast<uint16_t>(action_flags);  //action
+    return LINE_OK;
+}
+
+// Read-only mapping of a whole file; data() is not NUL-terminated.
+class MappedFile {
+public:
+    // ok() is only true once the file is known to be a regular file and is
+    // mapped (or empty); open/fstat/mmap failures all leave ok_ false.
+    explicit MappedFile(const string &file) : fd_(-1), data_(nullptr), size_(0), ok_(false) {
+        fd_ = open(file.c_str(), O_RDONLY);
+        if (fd_ < 0) return;
+        struct stat st;
+        if (fstat(fd_, &st) != 0 || !S_ISREG(st.st_mode)) return;
+        size_ = static_cast<size_t>(st.st_size);
+        if (size_ == 0) {
+            ok_ = true;
+            return;
         }
-        
-        // Validate port ranges (must be 0-65535)
-        if (sport1 > 65535 || sport2 > 65535 || dport1 > 65535 || dport2 > 65535) {
-            fprintf(stderr, "[WARN] Line %u: port out of range (must be 0-65535), skipping\n", line_count);
-            continue;
+        void *m = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (m == MAP_FAILED) {
+            size_ = 0;
+            return;
         }
-        
-        // Validate port ordering (lo should be <= hi)
-        if (sport1 > sport2 || dport1 > dport2) {
-            fprintf(stderr, "[WARN] Line %u: invalid port range (lo > hi), skipping\n", line_count);
-            continue;
+        madvise(m, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(m);
+        ok_ = true;
+    }
+    ~MappedFile() {
+        if (data_) munmap(const_cast<char *>(data_), size_);
+        if (fd_ >= 0) close(fd_);
+    }
+    bool ok() const { return ok_; }
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    MappedFile(const MappedFile &);
+    MappedFile &operator=(const MappedFile &);
+
+    int fd_;
+    const char *data_;
+    size_t size_;
+    bool ok_;
+};
+
+// Output of parsing one newline-aligned slice of the file. Warnings are kept
+// with chunk-local line numbers so they can be printed in file order later.
+struct ChunkResult {
+    vector<Rule5D> rules;
+    vector<pair<u32, LineStatus>> warns;
+    u32 lines = 0;
+    std::exception_ptr err;
+};
+
+static void parse_chunk(const char *p, const char *end, ChunkResult &out) {
+    try {
+        while (p < end) {
+            const char *eol = (const char *)memchr(p, '\n', end - p);
+            if (!eol) eol = end;
+            out.lines++;
+
+            Rule5D r;
+            LineStatus st = parse_rule_line(p, eol, r);
+            if (st != LINE_OK) {
+                out.warns.push_back({out.lines, st});
+            } else {
+                out.rules.emplace_back(r);
+            }
+            p = eol + 1;
         }
+    } catch (...) {
+        out.err = std::current_exception();
+    }
+}
 
-        Rule5D r;
-        // src IP
-        auto sr = ip_range_from_parts(sip1,sip2,sip3,sip4, smask);
-        r.range[0][0] = sr.first;
-        r.range[0][1] = sr.second;
-        // dst IP
-        auto dr = ip_range_from_parts(dip1,dip2,dip3,dip4, dmask);
-        r.range[1][0] = dr.first;
-        r.range[1][1] = dr.second;
-        // source port
-        r.range[2][0] = (u32)sport1;
-        r.range[2][1] = (u32)sport2;
-        // dest port
-        r.range[3][0] = (u32)dport1;
-        r.range[3][1] = (u32)dport2;
-        // protocol
-        if (protocol_mask == 0xFF) {
-            r.range[4][0] = (u32)protocol;
-            r.range[4][1] = (u32)protocol;
-        } else if (protocol_mask == 0x00) {
-            r.range[4][0] = 0u;
-            r.range[4][1] = 0xFFu;
-        } else {
-            // if other masks appear, for now treat as full range (or you can refine)
-            r.range[4][0] = 0u;
-            r.range[4][1] = 0xFFu;
+// Files smaller than this are parsed on the calling thread.
+static const size_t PARALLEL_MIN_BYTES = 1u << 20;
+
+void load_rules_from_file(const string &file, vector<Rule5D> &rules_out, unsigned num_threads) {
+    MappedFile mf(file);
+    if (!mf.ok()) {
+        fprintf(stderr, "error - cannot open rules file: %s\n", file.c_str());
+        exit(1);
+    }
+
+    const char *base = mf.data();
+    const char *end = base + mf.size();
+
+    if (num_threads == 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+        if (mf.size() < PARALLEL_MIN_BYTES) num_threads = 1;
+    }
+
+    // Split at newline boundaries so every chunk starts on a fresh line
+    vector<const char *> cuts(1, base);
+    for (unsigned t = 1; t < num_threads; ++t) {
+        const char *q = base + mf.size() / num_threads * t;
+        if (q < cuts.back()) q = cuts.back();
+        const char *nl = (const char *)memchr(q, '\n', end - q);
+        if (!nl) break;
+        if (nl + 1 > cuts.back()) cuts.push_back(nl + 1);
+    }
+    cuts.push_back(end);
+    size_t nchunks = cuts.size() - 1;
+
+    vector<ChunkResult> chunks(nchunks);
+    // rough pre-size: rule lines in these files are ~70-100 bytes
+    for (size_t c = 0; c < nchunks; ++c) {
+        chunks[c].rules.reserve((cuts[c + 1] - cuts[c]) / 64 + 1);
+    }
+    if (nchunks == 1) {
+        parse_chunk(cuts[0], cuts[1], chunks[0]);
+    } else {
+        vector<std::thread> pool;
+        for (size_t c = 0; c < nchunks; ++c) {
+            pool.emplace_back(parse_chunk, cuts[c], cuts[c + 1], std::ref(chunks[c]));
+        }
+        for (auto &th : pool) th.join();
+    }
+
+    // Stitch in file order: priority is the running rule count, line numbers
+    // are offset by the lines of all previous chunks.
+    size_t total = 0;
+    for (const auto &ch : chunks) total += ch.rules.size();
+    rules_out.reserve(rules_out.size() + total);
+
+    u32 rule_count = 0;
+    u32 line_base = 0;
+    for (auto &ch : chunks) {
+        for (const auto &w : ch.warns) {
+            // skip invalid line
+            fprintf(stderr, "[WARN] Line %u: %s, skipping\n", line_base + w.first, line_status_msg(w.second));
+        }
+        for (auto &r : ch.rules) {
+            ++rule_count;
+            r.priority = rule_count;
+            rules_out.emplace_back(r);
         }
+        vector<Rule5D>().swap(ch.rules);
+        if (ch.err) std::rethrow_exception(ch.err);
+        line_base += ch.lines;
+    }
+}
+
+// ---------------Binary rule snapshot---------------------
+// Layout (all integers little-endian):
+//   header : magic[8] "PCRULES\0", u32 version, u32 record_size,
+//            u64 count, u64 checksum                        (32 bytes)
+//   record : 5 x (u32 lo, u32 hi), 5 x i32 prefix_length,
+//            u32 priority, u16 action, u16 pad               (68 bytes)
+// checksum = FNV-1a over the record area taken as 64-bit LE words
+// (last word zero-padded).
+static const char SNAPSHOT_MAGIC[8] = {'P','C','R','U','L','E','S','\0'};
+static const u32 SNAPSHOT_VERSION = 1;
+static const size_t SNAPSHOT_HEADER_SIZE = 32;
+static const size_t SNAPSHOT_RECORD_SIZE = 68;
+
+static void encode_rule(const Rule5D &r, unsigned char *p) {
+    for (int d = 0; d < 5; ++d) {
+        put_u32(p + d * 8, r.range[d][0]);
+        put_u32(p + d * 8 + 4, r.range[d][1]);
+    }
+    for (int d = 0; d < 5; ++d) {
+        put_u32(p + 40 + d * 4, (uint32_t)r.prefix_length[d]);
+    }
+    put_u32(p + 60, r.priority);
+    put_u16(p + 64, r.action);
+    put_u16(p + 66, 0);
+}
+
+static void decode_rule(const unsigned char *p, Rule5D &r) {
+    for (int d = 0; d < 5; ++d) {
+        r.range[d][0] = get_u32(p + d * 8);
+        r.range[d][1] = get_u32(p + d * 8 + 4);
+    }
+    for (int d = 0; d < 5; ++d) {
+        r.prefix_length[d] = (int)get_u32(p + 40 + d * 4);
+    }
+    r.priority = get_u32(p + 60);
+    r.action = get_u16(p + 64);
+}
+
+bool save_rules_snapshot(const vector<Rule5D> &rules, const string &file) {
+    vector<unsigned char> body(rules.size() * SNAPSHOT_RECORD_SIZE);
+    for (size_t i = 0; i < rules.size(); ++i) {
+        encode_rule(rules[i], body.data() + i * SNAPSHOT_RECORD_SIZE);
+    }
+
+    unsigned char hdr[SNAPSHOT_HEADER_SIZE];
+    memcpy(hdr, SNAPSHOT_MAGIC, 8);
+    put_u32(hdr + 8, SNAPSHOT_VERSION);
+    put_u32(hdr + 12, (u32)SNAPSHOT_RECORD_SIZE);
+    put_u64(hdr + 16, (uint64_t)rules.size());
+    put_u64(hdr + 24, fnv1a64_words(body.data(), body.size()));
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        fprintf(stderr, "[ERROR] Failed to open snapshot file: %s\n", file.c_str());
+        return false;
+    }
+    bool ok = fwrite(hdr, 1, sizeof(hdr), fp) == sizeof(hdr) &&
+              fwrite(body.data(), 1, body.size(), fp) == body.size();
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "[ERROR] Failed to write snapshot file: %s\n", file.c_str());
+    }
+    return ok;
+}
+
+static bool has_snapshot_magic(const MappedFile &mf) {
+    return mf.size() >= SNAPSHOT_HEADER_SIZE &&
+           memcmp(mf.data(), SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0;
+}
+
+static void decode_snapshot(const MappedFile &mf, const string &file, vector<Rule5D> &rules_out) {
+    if (!has_snapshot_magic(mf)) {
+        throw std::runtime_error("not a rule snapshot: " + file);
+    }
+    const unsigned char *hdr = (const unsigned char *)mf.data();
+    u32 version = get_u32(hdr + 8);
+    u32 record_size = get_u32(hdr + 12);
+    uint64_t count = get_u64(hdr + 16);
+    uint64_t checksum = get_u64(hdr + 24);
 
-        // prefix_length fields: keep same semantics as original simple loader
-        r.prefix_length[0] = (int)smask;
-        r.prefix_length[1] = (int)dmask;
-        r.prefix_length[2] = (sport1 == sport2) ? 0 : 1;
-        r.prefix_length[3] = (dport1 == dport2) ? 0 : 1;
-        r.prefix_length[4] = (protocol_mask != 0x00) ? 0 : 1;
+    if (version != SNAPSHOT_VERSION || record_size != SNAPSHOT_RECORD_SIZE) {
+        throw std::runtime_error("unsupported snapshot version/record size in " + file);
+    }
+    uint64_t body_size = (uint64_t)(mf.size() - SNAPSHOT_HEADER_SIZE);
+    if (count > body_size / SNAPSHOT_RECORD_SIZE || count * SNAPSHOT_RECORD_SIZE != body_size) {
+        throw std::runtime_error("truncated snapshot: " + file);
+    }
+    const unsigned char *body = hdr + SNAPSHOT_HEADER_SIZE;
+    if (fnv1a64_words(body, (size_t)body_size) != checksum) {
+        throw std::runtime_error("snapshot checksum mismatch: " + file);
+    }
 
-        ++rule_count;
-        r.priority = rule_count;
-        r.action = static_cast<uint16_t>(action_flags);  //action
+    size_t base = rules_out.size();
+    rules_out.resize(base + (size_t)count);
+    for (size_t i = 0; i < (size_t)count; ++i) {
+        decode_rule(body + i * SNAPSHOT_RECORD_SIZE, rules_out[base + i]);
+    }
+}
 
-        rules_out.emplace_back(r);
+void load_rules_snapshot(const string &file, vector<Rule5D> &rules_out) {
+    MappedFile mf(file);
+    if (!mf.ok()) {
+        fprintf(stderr, "error - cannot open rules file: %s\n", file.c_str());
+        exit(1);
     }
+    decode_snapshot(mf, file, rules_out);
+}
+
+bool is_rules_snapshot(const string &file) {
+    MappedFile mf(file);
+    return mf.ok() && has_snapshot_magic(mf);
+}
 
-    fclose(fp);
+void load_rules(const string &file, vector<Rule5D> &rules_out, unsigned num_threads) {
+    if (is_rules_snapshot(file)) {
+        load_rules_snapshot(file, rules_out);
+    } else {
+        load_rules_from_file(file, rules_out, num_threads);
+    }
 }
 
 void split_rules(
@@ -33,11 +33,34 @@ struct PortRule {
 };
 
 // ---------------Function Declarations---------------------
+// num_threads = 0: one chunk per hardware thread (serial for small files)
 void load_rules_from_file(
+    const std::string &file,
+    std::vector<Rule5D> &rules_out,
+    unsigned num_threads = 0
+);
+
+// Binary snapshot of a parsed rule set (versioned header, fixed 68-byte
+// little-endian records, checksum). See Loader.cpp for the exact layout.
+bool save_rules_snapshot(
+    const std::vector<Rule5D> &rules,
+    const std::string &file
+);
+
+void load_rules_snapshot(
     const std::string &file,
     std::vector<Rule5D> &rules_out
 );
 
+bool is_rules_snapshot(const std::string &file);
+
+// Loads either a .rules text file or a snapshot, detected by magic bytes
+void load_rules(
+    const std::string &file,
+    std::vector<Rule5D> &rules_out,
+    unsigned num_threads = 0
+);
+
 void split_rules(
     const std::vector<Rule5D>& all_rules,
     std::vector<IPRule>& ip_table,
@@ -10,15 +10,57 @@
 
 #include "Loader.hpp"
 #include "Function.hpp"
+#include "Classifier.hpp"
+#include "Trace.hpp"
+#include "Incremental.hpp"
+#include "RangeEncoding.hpp"
+#include "TCAMMinimize.hpp"
+#include "TableExport.hpp"
 
 using namespace std;
 
 int main(int argc, char **argv)
 {
     // Parse command-line arguments
+    // usage: portcatcher [rules_or_snapshot] [--save-snapshot <file>] [--coalesce] [--classify <packets>]
+    //                   [--diff <old_rules_or_snapshot> [--lrmid-map <file>]]
+    //                   [--tcam-encoding prefix,srge,dirpe,layered|all] [--dirpe-chunk <bits>] [--layer-bits <bits>]
+    //                   [--tcam-minimize exact|action] [--export bin,p4rt-json,p4rt-txt|all]
     string rules_path = "src/ACL_rules/test.rules";
-    if (argc >= 2) {
-        rules_path = string(argv[1]);
+    string snapshot_out;
+    string diff_old_path;
+    string lrmid_map_in;
+    string tcam_encodings;
+    RangeEncodingConfig encoding_cfg;
+    string tcam_minimize;
+    string export_formats;
+    bool coalesce = false;
+    size_t classify_packets = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--save-snapshot" && i + 1 < argc) {
+            snapshot_out = argv[++i];
+        } else if (arg == "--coalesce") {
+            coalesce = true;
+        } else if (arg == "--classify" && i + 1 < argc) {
+            classify_packets = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--diff" && i + 1 < argc) {
+            diff_old_path = argv[++i];
+        } else if (arg == "--lrmid-map" && i + 1 < argc) {
+            lrmid_map_in = argv[++i];
+        } else if (arg == "--tcam-encoding" && i + 1 < argc) {
+            tcam_encodings = argv[++i];
+        } else if (arg == "--export" && i + 1 < argc) {
+            export_formats = argv[++i];
+        } else if (arg == "--tcam-minimize" && i + 1 < argc) {
+            tcam_minimize = argv[++i];
+        } else if (arg == "--dirpe-chunk" && i + 1 < argc) {
+            encoding_cfg.dirpe_chunk_bits = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--layer-bits" && i + 1 < argc) {
+            encoding_cfg.layered_extra_bits = static_cast<unsigned>(strtoul(argv[++i], nullptr, 10));
+        } else {
+            rules_path = arg;
+        }
     }
 
     cout << "============================================================================\n";
@@ -29,7 +71,8 @@ int main(int argc, char **argv)
     cout << "[STEP 1] Loading rules from: " << rules_path << endl;
     vector<Rule5D> rules;
     try {
-        load_rules_from_file(rules_path, rules);
+        // .rules text or binary snapshot, detected from the file header
+        load_rules(rules_path, rules);
     } catch (const std::exception &e) {
         cerr << "[ERROR] Failed to load rules: " << e.what() << endl;
         return 1;
@@ -37,6 +80,55 @@ int main(int argc, char **argv)
 
     cout << "[SUCCESS] Loaded " << rules.size() << " rules\n\n";
 
+    if (!snapshot_out.empty()) {
+        if (save_rules_snapshot(rules, snapshot_out)) {
+            cout << "[SUCCESS] Rule snapshot written to: " << snapshot_out << "\n\n";
+        }
+    }
+
+    // Diff mode: compile the old version (LRMIDs from --lrmid-map, else first-seen order
+    // like the full pipeline), compile the new version reusing those LRMIDs, and emit
+    // only the IP / LRME entries that changed
+    if (!diff_old_path.empty()) {
+        cout << "[DIFF] Loading old version from: " << diff_old_path << endl;
+        vector<Rule5D> old_rules;
+        try {
+            load_rules(diff_old_path, old_rules);
+        } catch (const std::exception &e) {
+            cerr << "[ERROR] Failed to load rules: " << e.what() << endl;
+            return 1;
+        }
+        vector<LRMIDBinding> old_bindings;
+        if (!lrmid_map_in.empty() && !load_lrmid_map(lrmid_map_in, old_bindings)) return 1;
+
+        IncrementalCompiler old_version, new_version;
+        old_version.load(old_rules, old_bindings);
+        new_version.load(rules, old_version.bindings());
+
+        TableImage old_image, new_image;
+        old_version.snapshot(old_image);
+        new_version.snapshot(new_image);
+        TableDelta delta;
+        diff_table_images(old_image, new_image, delta);
+
+        size_t unchanged = 0;
+        for (const auto& kv : new_image.ip) {
+            auto it = old_image.ip.find(kv.first);
+            if (it != old_image.ip.end() && same_ip_table_entry(it->second, kv.second)) unchanged++;
+        }
+        cout << "[DIFF] Old: " << old_rules.size() << " rules, " << old_version.lrmids() << " LRMIDs, "
+             << old_version.lrme_entries() << " LRME entries\n";
+        cout << "[DIFF] New: " << rules.size() << " rules, " << new_version.lrmids() << " LRMIDs, "
+             << new_version.lrme_entries() << " LRME entries\n";
+        cout << "[DIFF] IP entries unchanged: " << unchanged << ", total changes: " << delta.size() << "\n";
+
+        output_table_delta(delta, "output/delta.txt");
+        if (save_lrmid_map(new_version.bindings(), "output/lrmid_map.txt")) {
+            cout << "[SUCCESS] LRMID map written to: output/lrmid_map.txt\n";
+        }
+        return 0;
+    }
+
     // Step 2: Split rules into IP and Port tables
     cout << "[STEP 2] Splitting rules into IP and Port tables...\n";
     vector<IPRule> ip_table;
@@ -49,14 +141,15 @@ int main(int argc, char **argv)
     // (load_and_create_IP_table internally handles IP merge, intersection detection, and metainfo generation)
     cout << "[STEP 3] Creating IP Table and port metadata...\n";
     vector<MergrdR> merged_ip_table;
-    std::map<uint32_t, std::vector<MergedItem>> metainfo;  // key: LRMID, value: port items
+    MergedItemTable metainfo;  // key: LRMID, value: port items
     load_and_create_IP_table(ip_table, port_table, merged_ip_table, metainfo);
     cout << "[SUCCESS] IP Table and metadata processing completed (Merged to " << merged_ip_table.size() << " unique IP entries)\n\n";
 
     // Step 4: Create LRME for Port Table
     cout << "[STEP 4] Creating Port Table...\n";
-    std::map<uint32_t, std::vector<PortBlock>> optimal_metainfo = 
-    Caculate_LRME_for_Port_Table(metainfo);
+    vector<LRME_Entry> lrme_entries;
+    PortBlockTable optimal_metainfo = 
+    Caculate_LRME_for_Port_Table(metainfo, coalesce, &lrme_entries);
     
     // Step 5: Create REV and LRM-ID set for IP Table
     cout << "[STEP 5] Creating Final IP Table ...\n";
@@ -79,6 +172,29 @@ int main(int argc, char **argv)
     cout << "  - IP_table.txt\n";
     cout << "============================================================================\n";
 
+    // Optional: run the generated IP + LRME tables as a software classifier
+    if (classify_packets > 0) {
+        cout << "\n[CLASSIFY] Building reference classifier over IP + LRME tables...\n";
+        LRMEClassifier classifier;
+        classifier.build(merged_ip_table, final_ip_table, lrme_entries, optimal_metainfo);
+        TraceConfig trace_cfg;
+        trace_cfg.packets = classify_packets;
+        trace_cfg.hit_ratio = 1.0;
+        vector<Tuple5> trace = generate_trace(rules, trace_cfg);
+
+        uint64_t checksum = 0;
+        double pps1 = measure_lookup_rate(classifier, trace, 1, 1, &checksum);
+        unsigned nthreads = std::max(1u, std::thread::hardware_concurrency());
+        double ppsN = measure_lookup_rate(classifier, trace, nthreads, 1);
+        cout << "[CLASSIFY] " << trace.size() << " packets, checksum " << checksum << "\n";
+        cout << "[CLASSIFY] 1 thread:  " << fixed << setprecision(3) << pps1 / 1e6 << " Mpps\n";
+        cout << "[CLASSIFY] " << nthreads << " threads: " << ppsN / 1e6 << " Mpps\n";
+        cout << "[CLASSIFY] Memory: " << classifier.memory_bytes() / 1024 << " KB\n";
+        cout.unsetf(ios::fixed);
+        cout << setprecision(6);
+        cout << "============================================================================\n";
+    }
+
     // Partition 2, we design the Port Expansion Algorithm Based on TCAM
     cout << "============================================================================\n";
     cout << "-----------------Port Expansion Algorithm Based on TCAM---------------------\n";
@@ -89,6 +205,18 @@ int main(int argc, char **argv)
     TCAM_Port_Expansion(rules, tcam_entries);
     cout << "[SUCCESS] TCAM port expansion completed\n\n";
 
+    // Optional: remove covered entries and merge sibling entries before writing the table
+    if (!tcam_minimize.empty()) {
+        TCAMMinimizeMode mode;
+        if (parse_tcam_minimize_mode(tcam_minimize, mode)) {
+            cout << "[STEP 1b] Minimizing TCAM entries (" << tcam_minimize_mode_name(mode) << ")...\n";
+            TCAM_Minimize_Entries(tcam_entries, mode);
+            cout << "[SUCCESS] TCAM minimization completed\n\n";
+        } else {
+            cerr << "[WARN] Unknown TCAM minimize mode: " << tcam_minimize << endl;
+        }
+    }
+
     cout << "[STEP 2] Outputting TCAM table to file...\n";
     output_TCAM_table(tcam_entries, "output/TCAM_table.txt");
     cout << "[SUCCESS] TCAM table output completed\n\n";
@@ -103,5 +231,57 @@ int main(int argc, char **argv)
     cout << "  - TCAM_table.txt\n";
     cout << "============================================================================\n";
 
+    // Optional: compare ternary range encoders (entries and TCAM bits per encoder)
+    if (!tcam_encodings.empty()) {
+        if (tcam_encodings == "all") tcam_encodings = "prefix,srge,dirpe,layered";
+        cout << "\n[ENCODING] Ternary range encoding report (dirpe chunk " << encoding_cfg.dirpe_chunk_bits
+             << " bits, layered budget " << encoding_cfg.layered_extra_bits << " bits per port field)\n";
+        vector<TCAMEncodingReport> reports;
+        stringstream ss(tcam_encodings);
+        string name;
+        while (getline(ss, name, ',')) {
+            RangeEncodingConfig cfg = encoding_cfg;
+            if (!parse_range_encoding(name, cfg.encoding)) {
+                cerr << "[WARN] Unknown TCAM encoding: " << name << endl;
+                continue;
+            }
+            PortRangeEncoder src_encoder, dst_encoder;
+            vector<TernaryTCAMEntry> encoded;
+            TCAMEncodingReport report;
+            TCAM_Encoded_Expansion(rules, cfg, src_encoder, dst_encoder, encoded, &report);
+            reports.push_back(report);
+        }
+        print_tcam_encoding_report(reports);
+        cout << "============================================================================\n";
+    }
+
+    // Optional: machine-readable exports of the generated tables (fixed-width binary
+    // records with a schema header, and P4Runtime table entries for the switch)
+    if (!export_formats.empty()) {
+        if (export_formats == "all") export_formats = "bin,p4rt-json,p4rt-txt";
+        cout << "\n[EXPORT] Writing table exports...\n";
+        P4RuntimeTables p4_tables;
+        p4_tables.ip_table = &final_ip_table;
+        p4_tables.lrme_entries = &lrme_entries;
+        p4_tables.tcam_entries = &tcam_entries;
+        stringstream ss(export_formats);
+        string format;
+        while (getline(ss, format, ',')) {
+            if (format == "bin") {
+                export_metainfo_binary(metainfo, "output/metainfo.bin");
+                export_LRME_entries_binary(lrme_entries, "output/Port_table.bin");
+                export_IP_table_binary(final_ip_table, "output/IP_table.bin");
+                export_TCAM_table_binary(tcam_entries, "output/TCAM_table.bin");
+            } else if (format == "p4rt-json") {
+                export_p4runtime_json(p4_tables, "output/p4rt_entries.json");
+            } else if (format == "p4rt-txt") {
+                export_p4runtime_text(p4_tables, "output/p4rt_entries.txt");
+            } else {
+                cerr << "[WARN] Unknown export format: " << format << endl;
+            }
+        }
+        cout << "============================================================================\n";
+    }
+
     return 0;
 }
\ No newline at end of file
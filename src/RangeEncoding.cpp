@@ -0,0 +1,435 @@
+/** *************************************************************/
+// @Name: RangeEncoding.cpp
+// @Function: Ternary port range encoders (prefix / SRGE / DIRPE / layered) for TCAM expansion
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "Classifier.hpp"
+#include "RangeEncoding.hpp"
+
+using namespace std;
+
+const char* range_encoding_name(RangeEncoding encoding) {
+    switch (encoding) {
+        case ENC_SRGE: return "srge";
+        case ENC_DIRPE: return "dirpe";
+        case ENC_LAYERED: return "layered";
+        default: return "prefix";
+    }
+}
+
+bool parse_range_encoding(const std::string& name, RangeEncoding& encoding) {
+    if (name == "prefix") encoding = ENC_PREFIX;
+    else if (name == "srge") encoding = ENC_SRGE;
+    else if (name == "dirpe") encoding = ENC_DIRPE;
+    else if (name == "layered") encoding = ENC_LAYERED;
+    else return false;
+    return true;
+}
+
+static inline uint64_t low_bits(unsigned n) {
+    return n >= 64 ? ~0ull : ((1ull << n) - 1);
+}
+
+static inline uint16_t gray_code(uint16_t port) {
+    return static_cast<uint16_t>(port ^ (port >> 1));
+}
+
+// 编号 1..m 需要的位数
+static inline unsigned code_bits(size_t m) {
+    unsigned b = 0;
+    while ((1ull << b) < m + 1) b++;
+    return b;
+}
+
+// ---------------PortRangeEncoder---------------------
+void PortRangeEncoder::build(const RangeEncodingConfig& config, const std::vector<std::pair<uint16_t, uint16_t>>& ranges) {
+    config_ = config;
+    chunk_bits_.clear();
+    chunk_shift_.clear();
+    layer_bits_.clear();
+    layer_shift_.clear();
+    range_code_.clear();
+    keys_.assign(65536, 0);
+
+    if (config_.encoding == ENC_DIRPE) {
+        unsigned chunk = std::min(std::max(config_.dirpe_chunk_bits, 1u), 4u);
+        config_.dirpe_chunk_bits = chunk;
+        // 从低位起分段，最高段可能不足 chunk 位
+        unsigned port_bits = 0, key_bits = 0;
+        while (port_bits < 16) {
+            unsigned b = std::min(chunk, 16 - port_bits);
+            chunk_bits_.push_back(b);
+            chunk_shift_.push_back(key_bits);
+            port_bits += b;
+            key_bits += (1u << b) - 1;
+        }
+        width_ = key_bits;
+        for (uint32_t p = 0; p < 65536; ++p) {
+            uint64_t key = 0;
+            unsigned off = 0;
+            for (size_t i = 0; i < chunk_bits_.size(); ++i) {
+                uint32_t v = (p >> off) & ((1u << chunk_bits_[i]) - 1);
+                key |= low_bits(v) << chunk_shift_[i];
+                off += chunk_bits_[i];
+            }
+            keys_[p] = key;
+        }
+        return;
+    }
+
+    width_ = 16;
+    if (config_.encoding == ENC_SRGE) {
+        for (uint32_t p = 0; p < 65536; ++p) keys_[p] = gray_code(static_cast<uint16_t>(p));
+        return;
+    }
+    for (uint32_t p = 0; p < 65536; ++p) keys_[p] = p;
+    if (config_.encoding == ENC_LAYERED) {
+        config_.layered_extra_bits = std::min(config_.layered_extra_bits, 48u);
+        build_layers(ranges);
+    }
+}
+
+// 贪心分层：按 频率 × (前缀展开条数 - 1) 从大到小尝试放入已有的层（与层内范围都不相交），
+// 放不下且预算允许时新开一层
+void PortRangeEncoder::build_layers(const std::vector<std::pair<uint16_t, uint16_t>>& ranges) {
+    map<uint32_t, size_t> freq;
+    for (const auto& r : ranges) freq[((uint32_t)r.first << 16) | r.second]++;
+
+    struct Candidate {
+        uint32_t range;
+        uint64_t benefit;
+    };
+    vector<Candidate> cands;
+    for (const auto& kv : freq) {
+        uint16_t lo = static_cast<uint16_t>(kv.first >> 16), hi = static_cast<uint16_t>(kv.first & 0xFFFF);
+        pair<uint16_t, uint16_t> prefixes[MAX_PORT_PREFIXES];
+        size_t n = port_range_to_prefixes(lo, hi, prefixes);
+        if (n <= 1) continue;
+        Candidate c = { kv.first, (uint64_t)kv.second * (n - 1) };
+        cands.push_back(c);
+    }
+    sort(cands.begin(), cands.end(), [](const Candidate& a, const Candidate& b) {
+        return a.benefit != b.benefit ? a.benefit > b.benefit : a.range < b.range;
+    });
+
+    struct Layer {
+        map<uint16_t, uint16_t> members;   // lo -> hi
+        vector<uint32_t> order;            // 编号顺序
+    };
+    vector<Layer> layers;
+    unsigned budget = config_.layered_extra_bits, used = 0;
+    for (const auto& c : cands) {
+        uint16_t lo = static_cast<uint16_t>(c.range >> 16), hi = static_cast<uint16_t>(c.range & 0xFFFF);
+        bool placed = false;
+        for (auto& layer : layers) {
+            unsigned cur = code_bits(layer.order.size());
+            unsigned next = code_bits(layer.order.size() + 1);
+            if (used - cur + next > budget) continue;
+            auto it = layer.members.upper_bound(lo);
+            if (it != layer.members.end() && it->first <= hi) continue;
+            if (it != layer.members.begin() && std::prev(it)->second >= lo) continue;
+            layer.members[lo] = hi;
+            layer.order.push_back(c.range);
+            used += next - cur;
+            placed = true;
+            break;
+        }
+        if (!placed && used + 1 <= budget) {
+            layers.push_back(Layer());
+            layers.back().members[lo] = hi;
+            layers.back().order.push_back(c.range);
+            used += 1;
+        }
+    }
+
+    unsigned shift = 16;
+    for (uint32_t l = 0; l < layers.size(); ++l) {
+        unsigned bits = code_bits(layers[l].order.size());
+        layer_bits_.push_back(bits);
+        layer_shift_.push_back(shift);
+        for (size_t i = 0; i < layers[l].order.size(); ++i) {
+            RangeCode rc = { layers[l].order[i], l, (uint64_t)(i + 1) };
+            range_code_.push_back(rc);
+            uint32_t lo = rc.range >> 16, hi = rc.range & 0xFFFF;
+            for (uint32_t p = lo; p <= hi; ++p) keys_[p] |= rc.code << shift;
+        }
+        shift += bits;
+    }
+    width_ = shift;
+    sort(range_code_.begin(), range_code_.end(), [](const RangeCode& a, const RangeCode& b) {
+        return a.range < b.range;
+    });
+}
+
+// 反射 Gray 码下的范围覆盖：当前处理低 k 位，[lo, hi] 为块内相对端口。
+// 左半块 Gray 码低 k-1 位等于 gray(r)，右半块是左半块的镜像，
+// 因而跨越中点的范围可以用最高位 '*' 一次覆盖较短一侧及其镜像，较长一侧的剩余部分另行覆盖
+void PortRangeEncoder::srge_range(unsigned k, uint32_t lo, uint32_t hi, uint64_t value, uint64_t mask,
+                                  std::vector<TernaryWord>& out) const {
+    if (k == 0 || (lo == 0 && hi == (1u << k) - 1)) {
+        TernaryWord w = { value, mask };
+        out.push_back(w);
+        return;
+    }
+    uint32_t half = 1u << (k - 1);
+    uint64_t bit = half;
+    if (hi < half) {
+        srge_range(k - 1, lo, hi, value, mask | bit, out);
+        return;
+    }
+    if (lo >= half) {
+        srge_range(k - 1, 2 * half - 1 - hi, 2 * half - 1 - lo, value | bit, mask | bit, out);
+        return;
+    }
+
+    // 两侧都表示为左半块中的后缀 [start, half-1]
+    uint32_t left = lo, right = 2 * half - 1 - hi;
+    uint32_t core = std::max(left, right);
+    srge_range(k - 1, core, half - 1, value, mask, out);
+    if (left == right) return;
+
+    uint32_t start = std::min(left, right);
+    uint64_t side = left < right ? 0 : bit;
+    // 剩余部分可以只覆盖 [start, core-1]，也可以覆盖整个后缀（与核心重叠），取条数少者
+    vector<TernaryWord> whole, rest;
+    srge_range(k - 1, start, half - 1, value | side, mask | bit, whole);
+    srge_range(k - 1, start, core - 1, value | side, mask | bit, rest);
+    const vector<TernaryWord>& best = rest.size() < whole.size() ? rest : whole;
+    out.insert(out.end(), best.begin(), best.end());
+}
+
+// DIRPE：chunk 为当前处理的段（从最高段向下），[lo, hi] 为 chunk 及以下各段组成的值
+void PortRangeEncoder::dirpe_range(int chunk, uint32_t lo, uint32_t hi, uint64_t value, uint64_t mask,
+                                   std::vector<TernaryWord>& out) const {
+    if (chunk < 0) {
+        TernaryWord w = { value, mask };
+        out.push_back(w);
+        return;
+    }
+    unsigned lower = 0;
+    for (int i = 0; i < chunk; ++i) lower += chunk_bits_[i];
+    unsigned b = chunk_bits_[chunk];
+    uint32_t lower_max = (1u << lower) - 1;
+    if (lo == 0 && hi == (1u << (lower + b)) - 1) {
+        TernaryWord w = { value, mask };
+        out.push_back(w);
+        return;
+    }
+
+    // 段值区间 [a, c] 的模式：位 j < a 为 1，a <= j < c 为 '*'，j >= c 为 0
+    unsigned shift = chunk_shift_[chunk];
+    uint64_t field = low_bits((1u << b) - 1) << shift;
+    auto digit = [&](uint32_t a, uint32_t c, uint64_t& v, uint64_t& m) {
+        v = value | (low_bits(a) << shift);
+        m = (mask | field) & ~((low_bits(c) & ~low_bits(a)) << shift);
+    };
+
+    uint32_t dl = lo >> lower, dh = hi >> lower;
+    uint32_t lo_r = lo & lower_max, hi_r = hi & lower_max;
+    uint64_t v, m;
+    if (dl == dh) {
+        digit(dl, dl, v, m);
+        dirpe_range(chunk - 1, lo_r, hi_r, v, m, out);
+        return;
+    }
+    uint32_t a = dl, c = dh;
+    if (lo_r != 0) {
+        digit(dl, dl, v, m);
+        dirpe_range(chunk - 1, lo_r, lower_max, v, m, out);
+        a = dl + 1;
+    }
+    if (hi_r != lower_max) {
+        digit(dh, dh, v, m);
+        dirpe_range(chunk - 1, 0, hi_r, v, m, out);
+        c = dh - 1;
+    }
+    if (a <= c) {
+        digit(a, c, v, m);
+        TernaryWord w = { v, m };
+        out.push_back(w);
+    }
+}
+
+size_t PortRangeEncoder::encode_range(uint16_t lo, uint16_t hi, std::vector<TernaryWord>& out) const {
+    size_t before = out.size();
+    if (lo == 0 && hi == 65535) {
+        TernaryWord w = { 0, 0 };
+        out.push_back(w);
+        return 1;
+    }
+    switch (config_.encoding) {
+        case ENC_SRGE:
+            srge_range(16, lo, hi, 0, 0, out);
+            break;
+        case ENC_DIRPE:
+            dirpe_range(static_cast<int>(chunk_bits_.size()) - 1, lo, hi, 0, 0, out);
+            break;
+        case ENC_LAYERED: {
+            uint32_t range = ((uint32_t)lo << 16) | hi;
+            auto it = lower_bound(range_code_.begin(), range_code_.end(), range,
+                                  [](const RangeCode& rc, uint32_t r) { return rc.range < r; });
+            if (it != range_code_.end() && it->range == range) {
+                unsigned shift = layer_shift_[it->layer];
+                TernaryWord w = { it->code << shift, low_bits(layer_bits_[it->layer]) << shift };
+                out.push_back(w);
+                break;
+            }
+        }
+        // 未分层的范围退回前缀展开
+        /* fallthrough */
+        default: {
+            pair<uint16_t, uint16_t> prefixes[MAX_PORT_PREFIXES];
+            size_t n = port_range_to_prefixes(lo, hi, prefixes);
+            for (size_t i = 0; i < n; ++i) {
+                TernaryWord w = { prefixes[i].first, prefixes[i].second };
+                out.push_back(w);
+            }
+            break;
+        }
+    }
+    return out.size() - before;
+}
+
+// ---------------Encoded TCAM Expansion---------------------
+void TCAM_Encoded_Expansion(
+    const std::vector<Rule5D>& rules,
+    const RangeEncodingConfig& config,
+    PortRangeEncoder& src_encoder,
+    PortRangeEncoder& dst_encoder,
+    std::vector<TernaryTCAMEntry>& tcam_entries,
+    TCAMEncodingReport* report
+) {
+    auto t0 = chrono::steady_clock::now();
+    tcam_entries.clear();
+
+    vector<pair<uint16_t, uint16_t>> src_ranges, dst_ranges;
+    src_ranges.reserve(rules.size());
+    dst_ranges.reserve(rules.size());
+    for (const auto& r : rules) {
+        src_ranges.push_back(make_pair((uint16_t)r.range[2][0], (uint16_t)r.range[2][1]));
+        dst_ranges.push_back(make_pair((uint16_t)r.range[3][0], (uint16_t)r.range[3][1]));
+    }
+    src_encoder.build(config, src_ranges);
+    dst_encoder.build(config, dst_ranges);
+
+    vector<TernaryWord> src_words, dst_words;
+    for (size_t rule_idx = 0; rule_idx < rules.size(); ++rule_idx) {
+        const auto& rule = rules[rule_idx];
+        src_words.clear();
+        dst_words.clear();
+        src_encoder.encode_range(src_ranges[rule_idx].first, src_ranges[rule_idx].second, src_words);
+        dst_encoder.encode_range(dst_ranges[rule_idx].first, dst_ranges[rule_idx].second, dst_words);
+
+        for (const auto& sw : src_words) {
+            for (const auto& dw : dst_words) {
+                TernaryTCAMEntry entry;
+                entry.Src_IP_lo = rule.range[0][0];
+                entry.Src_IP_hi = rule.range[0][1];
+                entry.Dst_IP_lo = rule.range[1][0];
+                entry.Dst_IP_hi = rule.range[1][1];
+                entry.Src_Port = sw;
+                entry.Dst_Port = dw;
+                entry.Proto = static_cast<uint8_t>(rule.range[4][0]);
+                entry.action = rule.action;
+                entry.rule_id = static_cast<uint32_t>(rule_idx);
+                tcam_entries.push_back(entry);
+            }
+        }
+    }
+
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    cout << "[TCAM_Encoded_Expansion] " << range_encoding_name(config.encoding) << ": "
+         << rules.size() << " rules -> " << tcam_entries.size() << " entries, port key "
+         << src_encoder.width() << "+" << dst_encoder.width() << " bits" << endl;
+
+    if (report) {
+        report->encoding = config.encoding;
+        report->rules = rules.size();
+        report->entries = tcam_entries.size();
+        report->src_port_bits = src_encoder.width();
+        report->dst_port_bits = dst_encoder.width();
+        report->entry_bits = 32 + 32 + 8 + report->src_port_bits + report->dst_port_bits;
+        report->expansion_ratio = rules.empty() ? 0.0 : (double)tcam_entries.size() / rules.size();
+        report->total_mbits = (double)tcam_entries.size() * report->entry_bits / 1e6;
+        report->build_ms = ms;
+    }
+}
+
+void print_tcam_encoding_report(const std::vector<TCAMEncodingReport>& reports) {
+    cout << left << setw(10) << "Encoding"
+         << right << setw(12) << "Entries"
+         << setw(10) << "Ratio"
+         << setw(14) << "Port bits"
+         << setw(12) << "Entry bits"
+         << setw(14) << "TCAM Mbit"
+         << setw(12) << "Build ms" << "\n";
+    cout << string(84, '-') << "\n";
+    for (const auto& r : reports) {
+        cout << left << setw(10) << range_encoding_name(r.encoding)
+             << right << setw(12) << r.entries
+             << fixed << setprecision(2) << setw(9) << r.expansion_ratio << "x"
+             << setw(14) << (to_string(r.src_port_bits) + "+" + to_string(r.dst_port_bits))
+             << setw(12) << r.entry_bits
+             << setw(14) << r.total_mbits
+             << setprecision(1) << setw(12) << r.build_ms << "\n";
+        cout.unsetf(ios::fixed);
+    }
+    cout << setprecision(6);
+}
+
+// ---------------EncodedTCAMClassifier---------------------
+void EncodedTCAMClassifier::build(
+    const std::vector<TernaryTCAMEntry>& tcam_entries,
+    const PortRangeEncoder& src_encoder,
+    const PortRangeEncoder& dst_encoder
+) {
+    entries_.clear();
+    entries_.reserve(tcam_entries.size());
+    for (const auto& e : tcam_entries) {
+        Node n;
+        n.src_lo = e.Src_IP_lo;
+        n.src_hi = e.Src_IP_hi;
+        n.dst_lo = e.Dst_IP_lo;
+        n.dst_hi = e.Dst_IP_hi;
+        n.sport_value = e.Src_Port.value & e.Src_Port.mask;
+        n.sport_mask = e.Src_Port.mask;
+        n.dport_value = e.Dst_Port.value & e.Dst_Port.mask;
+        n.dport_mask = e.Dst_Port.mask;
+        n.rule_id = e.rule_id;
+        n.action = e.action;
+        n.proto = e.Proto;
+        entries_.push_back(n);
+    }
+    src_keys_.resize(65536);
+    dst_keys_.resize(65536);
+    for (uint32_t p = 0; p < 65536; ++p) {
+        src_keys_[p] = src_encoder.encode_key(static_cast<uint16_t>(p));
+        dst_keys_[p] = dst_encoder.encode_key(static_cast<uint16_t>(p));
+    }
+}
+
+MatchResult EncodedTCAMClassifier::classify(const Tuple5& t) const {
+    uint64_t skey = src_keys_[t.src_port], dkey = dst_keys_[t.dst_port];
+    for (const auto& n : entries_) {
+        if (t.src_ip < n.src_lo || t.src_ip > n.src_hi) continue;
+        if (t.dst_ip < n.dst_lo || t.dst_ip > n.dst_hi) continue;
+        if (((skey ^ n.sport_value) & n.sport_mask) != 0) continue;
+        if (((dkey ^ n.dport_value) & n.dport_mask) != 0) continue;
+        if (n.proto != 0 && n.proto != t.proto) continue;
+        MatchResult r = { n.rule_id, n.action };
+        return r;
+    }
+    MatchResult miss = { NO_MATCH_RULE, 0 };
+    return miss;
+}
+
+size_t EncodedTCAMClassifier::memory_bytes() const {
+    return entries_.capacity() * sizeof(Node) + (src_keys_.capacity() + dst_keys_.capacity()) * sizeof(uint64_t);
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "Classifier.hpp"
+
+// ---------------TCAM Range Encoding---------------------
+// 端口范围到三态（value / mask）表项的编码方式，按端口维度各自构建：
+//   prefix  : 原始 16 位前缀展开（与 port_range_to_prefixes 相同）
+//   srge    : 端口按反射 Gray 码存放，跨越中点的范围用最高位 '*' 同时覆盖两侧的镜像部分
+//   dirpe   : 端口按 chunk 位分段，每段值 v 编码为 2^chunk-1 位的 0..01..1（v 个 1），
+//             一段值区间只需一个三态模式，范围按段做前缀式分解
+//   layered : 依赖规则集的编码：出现频繁、前缀展开代价高的范围分配到若干层额外位，
+//             同层范围互不相交，层内编号 1..m（0 表示不在该层任何范围内），总额外位不超过预算；
+//             未分到层的范围退回前缀展开
+// 查找时包的端口先按同一编码器转换为 key（最多 64 位），再与表项做 (key ^ value) & mask == 0
+enum RangeEncoding {
+    ENC_PREFIX = 0,
+    ENC_SRGE = 1,
+    ENC_DIRPE = 2,
+    ENC_LAYERED = 3
+};
+
+const char* range_encoding_name(RangeEncoding encoding);
+bool parse_range_encoding(const std::string& name, RangeEncoding& encoding);
+
+struct RangeEncodingConfig {
+    RangeEncoding encoding = ENC_PREFIX;
+    unsigned dirpe_chunk_bits = 2;     // 1~4，编码宽度为各段 2^chunk-1 位之和
+    unsigned layered_extra_bits = 16;  // 每个端口维度的额外位预算，1~48
+};
+
+struct TernaryWord {
+    uint64_t value;
+    uint64_t mask;     // 1 表示该位参与比较
+};
+
+class PortRangeEncoder {
+public:
+    // ranges：该维度在规则集中出现的全部端口范围（可重复，重复次数作为频率），仅 layered 使用
+    void build(const RangeEncodingConfig& config, const std::vector<std::pair<uint16_t, uint16_t>>& ranges);
+
+    RangeEncoding encoding() const { return config_.encoding; }
+    unsigned width() const { return width_; }             // key 位宽
+    size_t layers() const { return layer_bits_.size(); }  // layered：层数
+    size_t layered_ranges() const { return range_code_.size(); }
+
+    uint64_t encode_key(uint16_t port) const { return keys_[port]; }
+    // 追加覆盖 [lo, hi] 的三态表项，返回追加条数
+    size_t encode_range(uint16_t lo, uint16_t hi, std::vector<TernaryWord>& out) const;
+
+private:
+    struct RangeCode {
+        uint32_t range;      // lo << 16 | hi
+        uint32_t layer;
+        uint64_t code;
+    };
+
+    void build_layers(const std::vector<std::pair<uint16_t, uint16_t>>& ranges);
+    void srge_range(unsigned k, uint32_t lo, uint32_t hi, uint64_t value, uint64_t mask, std::vector<TernaryWord>& out) const;
+    void dirpe_range(int chunk, uint32_t lo, uint32_t hi, uint64_t value, uint64_t mask, std::vector<TernaryWord>& out) const;
+
+    RangeEncodingConfig config_;
+    unsigned width_ = 16;
+    std::vector<uint64_t> keys_;                 // port -> key，65536 项
+    // dirpe：各段（从低位起）的端口位数与在 key 中的起始位
+    std::vector<unsigned> chunk_bits_, chunk_shift_;
+    // layered：每层的位数与在 key 中的起始位（位于 16 个端口位之上）
+    std::vector<unsigned> layer_bits_, layer_shift_;
+    std::vector<RangeCode> range_code_;          // 按 range 排序
+};
+
+// ---------------Encoded TCAM Expansion---------------------
+struct TernaryTCAMEntry {
+    uint32_t Src_IP_lo, Src_IP_hi;
+    uint32_t Dst_IP_lo, Dst_IP_hi;
+    TernaryWord Src_Port;
+    TernaryWord Dst_Port;
+    uint8_t  Proto;
+    uint16_t action;
+    uint32_t rule_id;
+};
+
+struct TCAMEncodingReport {
+    RangeEncoding encoding;
+    size_t rules = 0;
+    size_t entries = 0;
+    unsigned src_port_bits = 0, dst_port_bits = 0;
+    unsigned entry_bits = 0;     // 32 + 32 (IP) + 8 (Proto) + 两个端口字段
+    double expansion_ratio = 0;
+    double total_mbits = 0;      // entries * entry_bits / 1e6
+    double build_ms = 0;
+};
+
+// 由规则集构建两个维度的编码器并展开为三态表项（源 × 目的端口表项的交叉乘积）
+void TCAM_Encoded_Expansion(
+    const std::vector<Rule5D>& rules,
+    const RangeEncodingConfig& config,
+    PortRangeEncoder& src_encoder,
+    PortRangeEncoder& dst_encoder,
+    std::vector<TernaryTCAMEntry>& tcam_entries,
+    TCAMEncodingReport* report = nullptr
+);
+
+void print_tcam_encoding_report(const std::vector<TCAMEncodingReport>& reports);
+
+// ---------------Encoded TCAM Classifier---------------------
+// 软件模拟编码后的三态表：包的端口经编码器转换为 key 后按顺序比较，首个命中即返回
+class EncodedTCAMClassifier {
+public:
+    void build(
+        const std::vector<TernaryTCAMEntry>& tcam_entries,
+        const PortRangeEncoder& src_encoder,
+        const PortRangeEncoder& dst_encoder
+    );
+
+    MatchResult classify(const Tuple5& t) const;
+
+    size_t entries() const { return entries_.size(); }
+    size_t memory_bytes() const;
+
+private:
+    struct Node {
+        uint32_t src_lo, src_hi;
+        uint32_t dst_lo, dst_hi;
+        uint64_t sport_value, sport_mask;
+        uint64_t dport_value, dport_mask;
+        uint32_t rule_id;
+        uint16_t action;
+        uint8_t  proto;
+    };
+    std::vector<Node> entries_;
+    std::vector<uint64_t> src_keys_, dst_keys_;
+};
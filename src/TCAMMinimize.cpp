@@ -0,0 +1,338 @@
+/** *************************************************************/
+// @Name: TCAMMinimize.cpp
+// @Function: Redundancy removal and sibling merging of expanded TCAM entries
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "TCAMMinimize.hpp"
+
+using namespace std;
+
+static const size_t MAX_MINIMIZE_ROUNDS = 16;
+static const int NOT_PREFIX = -1;
+
+const char* tcam_minimize_mode_name(TCAMMinimizeMode mode) {
+    return mode == TCAM_MIN_ACTION ? "action" : "exact";
+}
+
+bool parse_tcam_minimize_mode(const std::string& name, TCAMMinimizeMode& mode) {
+    if (name == "exact") mode = TCAM_MIN_EXACT;
+    else if (name == "action") mode = TCAM_MIN_ACTION;
+    else return false;
+    return true;
+}
+
+// [lo, hi] 为对齐的 2 的幂大小块时返回前缀长度，否则返回 NOT_PREFIX
+static int ip_prefix_length(uint32_t lo, uint32_t hi) {
+    uint64_t size = (uint64_t)hi - lo + 1;
+    if ((size & (size - 1)) != 0 || (lo & (size - 1)) != 0) return NOT_PREFIX;
+    return size == (1ull << 32) ? 0 : 32 - __builtin_ctzll(size);
+}
+
+static inline uint32_t prefix_mask(int len) {
+    return len == 0 ? 0 : 0xFFFFFFFFu << (32 - len);
+}
+
+static inline bool port_covers(uint16_t f_prefix, uint16_t f_mask, uint16_t e_prefix, uint16_t e_mask) {
+    // f 比较的位 e 都比较，且取值一致
+    return (f_mask & ~e_mask) == 0 && (e_prefix & f_mask) == f_prefix;
+}
+
+static bool entry_covers(const TCAM_Entry& f, const TCAM_Entry& e) {
+    return f.Src_IP_lo <= e.Src_IP_lo && e.Src_IP_hi <= f.Src_IP_hi &&
+           f.Dst_IP_lo <= e.Dst_IP_lo && e.Dst_IP_hi <= f.Dst_IP_hi &&
+           (f.Proto == 0 || f.Proto == e.Proto) &&
+           port_covers(f.Src_Port_prefix, f.Src_Port_mask, e.Src_Port_prefix, e.Src_Port_mask) &&
+           port_covers(f.Dst_Port_prefix, f.Dst_Port_mask, e.Dst_Port_prefix, e.Dst_Port_mask);
+}
+
+// 表项匹配空间大小的 log2，段内按从大到小处理，使覆盖者先于被覆盖者进入索引
+static double entry_volume(const TCAM_Entry& e) {
+    return log2((double)e.Src_IP_hi - e.Src_IP_lo + 1) + log2((double)e.Dst_IP_hi - e.Dst_IP_lo + 1) +
+           (16 - __builtin_popcount(e.Src_Port_mask)) + (16 - __builtin_popcount(e.Dst_Port_mask)) +
+           (e.Proto == 0 ? 8 : 0);
+}
+
+static bool same_run(const TCAM_Entry& a, const TCAM_Entry& b, TCAMMinimizeMode mode) {
+    if (a.action != b.action) return false;
+    return mode == TCAM_MIN_ACTION || a.rule_id == b.rule_id;
+}
+
+// 连续且 key 相同的表项编为同一段，返回段数
+static size_t assign_runs(const vector<TCAM_Entry>& entries, TCAMMinimizeMode mode, vector<uint32_t>& run) {
+    run.resize(entries.size());
+    uint32_t id = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (i > 0 && !same_run(entries[i - 1], entries[i], mode)) id++;
+        run[i] = id;
+    }
+    return entries.empty() ? 0 : id + 1;
+}
+
+static size_t compact_entries(vector<TCAM_Entry>& entries, const vector<char>& dead) {
+    size_t out = 0;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (!dead[i]) entries[out++] = entries[i];
+    }
+    size_t removed = entries.size() - out;
+    entries.resize(out);
+    return removed;
+}
+
+// ---------------Cover Index---------------------
+// 已保留表项按 (Src 区间, Dst 区间) 分桶。查询 e 时只需枚举 e 的 Src 区间在已出现的前缀长度上的祖先，
+// 再对每个存在的 Src 区间枚举其下出现过的 Dst 前缀长度，桶内逐条比较端口与协议。
+// 非前缀形式的区间（规则文件不会产生，这里只为完整）单独记录，查询时逐个判断是否包含
+class CoverIndex {
+public:
+    explicit CoverIndex(size_t expected)
+        : cells_(expected), srcs_(expected) {}
+
+    void insert(const vector<TCAM_Entry>& entries, uint32_t id) {
+        const TCAM_Entry& e = entries[id];
+        uint64_t src = (uint64_t)e.Src_IP_lo << 32 | e.Src_IP_hi;
+        uint32_t s = srcs_.find_or_insert(src, static_cast<uint32_t>(dst_lens_.size()));
+        if (s == dst_lens_.size()) {
+            dst_lens_.push_back(0);
+            int len = ip_prefix_length(e.Src_IP_lo, e.Src_IP_hi);
+            if (len == NOT_PREFIX) src_other_.push_back(make_pair(e.Src_IP_lo, e.Src_IP_hi));
+            else src_lens_ |= 1ull << len;
+        }
+        int dlen = ip_prefix_length(e.Dst_IP_lo, e.Dst_IP_hi);
+        dst_lens_[s] |= 1ull << (dlen == NOT_PREFIX ? 33 : dlen);
+
+        IPKey key = { e.Src_IP_lo, e.Src_IP_hi, e.Dst_IP_lo, e.Dst_IP_hi, 0 };
+        uint32_t c = cells_.find_or_insert(key, static_cast<uint32_t>(lists_.size()));
+        if (c == lists_.size()) {
+            lists_.push_back(vector<uint32_t>());
+            if (dlen == NOT_PREFIX) dst_other_.push_back(make_pair(e.Dst_IP_lo, e.Dst_IP_hi));
+        }
+        lists_[c].push_back(id);
+    }
+
+    bool covered(const vector<TCAM_Entry>& entries, const TCAM_Entry& e) const {
+        int slen = ip_prefix_length(e.Src_IP_lo, e.Src_IP_hi);
+        if (slen != NOT_PREFIX) {
+            for (int len = 0; len <= slen; ++len) {
+                if (!(src_lens_ >> len & 1)) continue;
+                uint32_t lo = e.Src_IP_lo & prefix_mask(len);
+                if (covered_under_src(entries, e, lo, lo | ~prefix_mask(len))) return true;
+            }
+        }
+        for (const auto& r : src_other_) {
+            if (r.first <= e.Src_IP_lo && e.Src_IP_hi <= r.second &&
+                covered_under_src(entries, e, r.first, r.second)) return true;
+        }
+        return false;
+    }
+
+private:
+    bool covered_under_src(const vector<TCAM_Entry>& entries, const TCAM_Entry& e, uint32_t src_lo, uint32_t src_hi) const {
+        uint32_t s = srcs_.find((uint64_t)src_lo << 32 | src_hi);
+        if (s == FlatKeyIndex<uint64_t, U64KeyHash>::NOT_FOUND) return false;
+        uint64_t lens = dst_lens_[s];
+        int dlen = ip_prefix_length(e.Dst_IP_lo, e.Dst_IP_hi);
+        if (dlen != NOT_PREFIX) {
+            for (int len = 0; len <= dlen; ++len) {
+                if (!(lens >> len & 1)) continue;
+                uint32_t lo = e.Dst_IP_lo & prefix_mask(len);
+                if (covered_in_cell(entries, e, src_lo, src_hi, lo, lo | ~prefix_mask(len))) return true;
+            }
+        }
+        if (lens >> 33 & 1) {
+            for (const auto& r : dst_other_) {
+                if (r.first <= e.Dst_IP_lo && e.Dst_IP_hi <= r.second &&
+                    covered_in_cell(entries, e, src_lo, src_hi, r.first, r.second)) return true;
+            }
+        }
+        return false;
+    }
+
+    bool covered_in_cell(const vector<TCAM_Entry>& entries, const TCAM_Entry& e,
+                         uint32_t src_lo, uint32_t src_hi, uint32_t dst_lo, uint32_t dst_hi) const {
+        IPKey key = { src_lo, src_hi, dst_lo, dst_hi, 0 };
+        uint32_t c = cells_.find(key);
+        if (c == FlatKeyIndex<IPKey, IPKeyHash>::NOT_FOUND) return false;
+        for (uint32_t id : lists_[c]) {
+            if (entry_covers(entries[id], e)) return true;
+        }
+        return false;
+    }
+
+    FlatKeyIndex<IPKey, IPKeyHash> cells_;            // (Src, Dst) 区间 -> lists_ 下标
+    vector<vector<uint32_t>> lists_;
+    FlatKeyIndex<uint64_t, U64KeyHash> srcs_;         // Src 区间 -> dst_lens_ 下标
+    vector<uint64_t> dst_lens_;                       // 该 Src 区间下出现过的 Dst 前缀长度，bit 33 为非前缀区间
+    uint64_t src_lens_ = 0;
+    vector<pair<uint32_t, uint32_t>> src_other_, dst_other_;
+};
+
+// 删除被更高优先级表项或同段表项覆盖的表项，返回删除条数
+static size_t remove_covered_entries(vector<TCAM_Entry>& entries, TCAMMinimizeMode mode) {
+    vector<uint32_t> run;
+    assign_runs(entries, mode, run);
+    vector<char> dead(entries.size(), 0);
+    CoverIndex index(entries.size());
+    vector<pair<double, uint32_t>> order;
+    for (size_t begin = 0; begin < entries.size();) {
+        size_t end = begin;
+        while (end < entries.size() && run[end] == run[begin]) end++;
+        order.clear();
+        for (size_t i = begin; i < end; ++i) order.push_back(make_pair(-entry_volume(entries[i]), static_cast<uint32_t>(i)));
+        sort(order.begin(), order.end());
+        for (const auto& o : order) {
+            if (index.covered(entries, entries[o.second])) dead[o.second] = 1;
+            else index.insert(entries, o.second);
+        }
+        begin = end;
+    }
+    return compact_entries(entries, dead);
+}
+
+// ---------------Sibling Merge---------------------
+// 每个字段拆成 (value, shape)：IP 为 (lo, hi - lo)，端口为 (prefix, mask)。
+// 对字段 d，按 (段, 协议, 其余字段, d 的 shape) 分组，组内按 d 的 value 排序后找兄弟：
+//   IP   : value 按 2 * size 对齐，兄弟为 value + size，合并为两倍大小的块
+//   端口 : 对 mask 中 value 为 0 的位 b，兄弟为 value | b，合并后 mask 清除 b
+typedef array<uint32_t, 10> MergeKey;
+
+static void entry_fields(const TCAM_Entry& e, uint32_t f[8]) {
+    f[0] = e.Src_IP_lo;        f[1] = e.Src_IP_hi - e.Src_IP_lo;
+    f[2] = e.Dst_IP_lo;        f[3] = e.Dst_IP_hi - e.Dst_IP_lo;
+    f[4] = e.Src_Port_prefix;  f[5] = e.Src_Port_mask;
+    f[6] = e.Dst_Port_prefix;  f[7] = e.Dst_Port_mask;
+}
+
+// 返回 rows[lo, hi) 中 value 为 v 且未使用的行，不存在时返回 hi
+static size_t find_partner(const vector<pair<MergeKey, uint32_t>>& rows, size_t lo, size_t hi,
+                           uint32_t v, const vector<char>& used) {
+    auto cmp = [](const pair<MergeKey, uint32_t>& r, uint32_t value) { return r.first[9] < value; };
+    size_t p = lower_bound(rows.begin() + lo, rows.begin() + hi, v, cmp) - rows.begin();
+    for (; p < hi && rows[p].first[9] == v; ++p) {
+        if (!used[rows[p].second]) return p;
+    }
+    return hi;
+}
+
+static size_t merge_dimension(vector<TCAM_Entry>& entries, const vector<uint32_t>& run,
+                              vector<char>& dead, int dim) {
+    vector<pair<MergeKey, uint32_t>> rows;
+    rows.reserve(entries.size());
+    uint32_t f[8];
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (dead[i]) continue;
+        entry_fields(entries[i], f);
+        MergeKey key;
+        size_t k = 0;
+        key[k++] = run[i];
+        key[k++] = entries[i].Proto;
+        for (int j = 0; j < 8; ++j) {
+            if (j != 2 * dim) key[k++] = f[j];
+        }
+        key[k++] = f[2 * dim];
+        rows.push_back(make_pair(key, static_cast<uint32_t>(i)));
+    }
+    sort(rows.begin(), rows.end());
+
+    vector<char> used(entries.size(), 0);
+    size_t merged = 0;
+    for (size_t begin = 0; begin < rows.size();) {
+        size_t end = begin + 1;
+        while (end < rows.size() && equal(rows[end].first.begin(), rows[end].first.begin() + 9, rows[begin].first.begin())) end++;
+        if (end - begin < 2) {
+            begin = end;
+            continue;
+        }
+        for (size_t r = begin; r < end; ++r) {
+            uint32_t a = rows[r].second;
+            if (used[a]) continue;
+            uint32_t value = rows[r].first[9];
+            uint32_t shape = rows[begin].first[2 + 2 * dim];   // 同组 shape 相同，位于其余字段中 d 的位置
+            size_t p = end;
+            uint32_t bit = 0;
+            if (dim < 2) {
+                uint64_t size = (uint64_t)shape + 1;
+                if (size < (1ull << 32) && ((uint64_t)value & (2 * size - 1)) == 0) {
+                    p = find_partner(rows, r + 1, end, static_cast<uint32_t>(value + size), used);
+                }
+            } else {
+                for (uint32_t m = shape & ~value; m != 0 && p == end; m &= m - 1) {
+                    bit = m & (~m + 1);
+                    p = find_partner(rows, r + 1, end, value | bit, used);
+                }
+            }
+            if (p == end) continue;
+
+            uint32_t b = rows[p].second;
+            uint32_t keep = min(a, b), drop = max(a, b);
+            TCAM_Entry parent = entries[a];
+            switch (dim) {
+                case 0: parent.Src_IP_hi = static_cast<uint32_t>(value + 2 * ((uint64_t)shape + 1) - 1); break;
+                case 1: parent.Dst_IP_hi = static_cast<uint32_t>(value + 2 * ((uint64_t)shape + 1) - 1); break;
+                case 2: parent.Src_Port_mask = static_cast<uint16_t>(shape & ~bit); break;
+                default: parent.Dst_Port_mask = static_cast<uint16_t>(shape & ~bit); break;
+            }
+            parent.rule_id = min(entries[a].rule_id, entries[b].rule_id);
+            entries[keep] = parent;
+            dead[drop] = 1;
+            used[a] = used[b] = 1;
+            merged++;
+        }
+        begin = end;
+    }
+    return merged;
+}
+
+// 段内反复合并兄弟表项直到没有可合并的，返回合并次数
+static size_t merge_sibling_entries(vector<TCAM_Entry>& entries, TCAMMinimizeMode mode) {
+    vector<uint32_t> run;
+    assign_runs(entries, mode, run);
+    vector<char> dead(entries.size(), 0);
+    size_t total = 0;
+    while (true) {
+        size_t merged = 0;
+        for (int dim = 0; dim < 4; ++dim) merged += merge_dimension(entries, run, dead, dim);
+        if (merged == 0) break;
+        total += merged;
+    }
+    compact_entries(entries, dead);
+    return total;
+}
+
+void TCAM_Minimize_Entries(
+    std::vector<TCAM_Entry>& tcam_entries,
+    TCAMMinimizeMode mode,
+    TCAMMinimizeReport* report
+) {
+    auto t0 = chrono::steady_clock::now();
+    TCAMMinimizeReport rep;
+    rep.mode = mode;
+    rep.before = tcam_entries.size();
+
+    // 合并出的大表项可能覆盖后面的表项，删除表项又可能让相邻的段连成一段，交替进行直到不再变化
+    while (rep.rounds < MAX_MINIMIZE_ROUNDS) {
+        rep.rounds++;
+        size_t covered = remove_covered_entries(tcam_entries, mode);
+        size_t merged = merge_sibling_entries(tcam_entries, mode);
+        rep.covered += covered;
+        rep.merged += merged;
+        if (covered + merged == 0) break;
+    }
+
+    rep.after = tcam_entries.size();
+    rep.build_ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    cout << "[TCAM_Minimize_Entries] " << tcam_minimize_mode_name(mode) << ": " << rep.before << " -> "
+         << rep.after << " entries (" << fixed << setprecision(2)
+         << (rep.before ? 100.0 * (rep.before - rep.after) / rep.before : 0.0) << "% saved), "
+         << rep.covered << " covered, " << rep.merged << " merged, " << rep.rounds << " rounds, "
+         << setprecision(1) << rep.build_ms << " ms\n";
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+    if (report) *report = rep;
+}
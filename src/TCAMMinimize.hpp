@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+
+// ---------------TCAM Entry Minimization---------------------
+// TCAM_Port_Expansion 之后的表项压缩，压缩后的表仍按顺序首个命中即返回：
+//   1) 冗余删除：被某条更高优先级表项完全覆盖的表项永远不会命中，直接删除
+//   2) 连续且 key 相同的表项构成一段（exact：rule_id 与 action 都相同；action：action 相同），
+//      包无论命中段内哪一条结果都相同，所以段内顺序无关：被段内另一条覆盖的表项也可删除，
+//      只在一个字段上互为兄弟的两条表项合并为一条（IP 为相邻的等长对齐块；
+//      端口为掩码相同、前缀只差一个被比较位的两条，合并后该位变为 '*'，即 Bit Weaving 的 bit merging）
+// 两步交替直到表项数不再减少。
+// exact 保证每个包命中的 rule_id 与 action 都不变；
+// action 只保证 action（及命中 / 未命中）不变，合并后的表项取两者中较小的 rule_id。
+// 合并可能产生非前缀形式的端口掩码，TCAMClassifier 与 output_TCAM_table 均按任意掩码处理
+enum TCAMMinimizeMode {
+    TCAM_MIN_EXACT = 0,
+    TCAM_MIN_ACTION = 1
+};
+
+const char* tcam_minimize_mode_name(TCAMMinimizeMode mode);
+bool parse_tcam_minimize_mode(const std::string& name, TCAMMinimizeMode& mode);
+
+struct TCAMMinimizeReport {
+    TCAMMinimizeMode mode = TCAM_MIN_EXACT;
+    size_t before = 0, after = 0;
+    size_t covered = 0;     // 冗余删除的表项数
+    size_t merged = 0;      // 兄弟合并次数（每次减少一条）
+    size_t rounds = 0;
+    double build_ms = 0;
+};
+
+void TCAM_Minimize_Entries(
+    std::vector<TCAM_Entry>& tcam_entries,
+    TCAMMinimizeMode mode,
+    TCAMMinimizeReport* report = nullptr
+);
@@ -0,0 +1,768 @@
+/** *************************************************************/
+// @Name: TableExport.cpp
+// @Function: Buffered binary and P4Runtime (JSON / protobuf text) export of generated tables
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "TableExport.hpp"
+#include "BinaryIO.hpp"
+
+using namespace std;
+
+// ---------------Buffered Writer---------------------
+BufferedWriter::BufferedWriter(size_t buffer_bytes)
+    : buf_(std::max<size_t>(buffer_bytes, 64)) {}
+
+BufferedWriter::~BufferedWriter() {
+    if (fp_) close();
+}
+
+bool BufferedWriter::open(const std::string& file) {
+    if (fp_) close();
+    fp_ = fopen(file.c_str(), "wb");
+    if (!fp_) {
+        ok_ = false;
+        return false;
+    }
+    setvbuf(fp_, nullptr, _IONBF, 0);   // 已经整块写出，不需要 FILE 再缓冲一次
+    len_ = 0;
+    written_ = 0;
+    ok_ = true;
+    return true;
+}
+
+void BufferedWriter::flush() {
+    if (len_ == 0) return;
+    if (!fp_ || fwrite(buf_.data(), 1, len_, fp_) != len_) ok_ = false;
+    written_ += len_;
+    len_ = 0;
+}
+
+bool BufferedWriter::close() {
+    if (!fp_) return false;
+    flush();
+    if (fclose(fp_) != 0) ok_ = false;
+    fp_ = nullptr;
+    return ok_;
+}
+
+void BufferedWriter::write(const void* data, size_t n) {
+    const char* p = static_cast<const char*>(data);
+    if (n >= buf_.size()) {
+        flush();
+        if (!fp_ || fwrite(p, 1, n, fp_) != n) ok_ = false;
+        written_ += n;
+        return;
+    }
+    if (len_ + n > buf_.size()) flush();
+    memcpy(buf_.data() + len_, p, n);
+    len_ += n;
+}
+
+void BufferedWriter::put_uint(uint64_t v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[sizeof(tmp) - ++n] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    write(tmp + sizeof(tmp) - n, n);
+}
+
+void BufferedWriter::put_hex(uint64_t v, unsigned digits) {
+    static const char HEX[] = "0123456789abcdef";
+    char tmp[16];
+    if (digits > 16) digits = 16;
+    for (unsigned i = 0; i < digits; ++i) tmp[digits - 1 - i] = HEX[(v >> (4 * i)) & 0xF];
+    write(tmp, digits);
+}
+
+void BufferedWriter::patch(uint64_t offset, const void* data, size_t n) {
+    flush();
+    if (!fp_ || offset + n > written_ ||
+        fseeko(fp_, static_cast<off_t>(offset), SEEK_SET) != 0 ||
+        fwrite(data, 1, n, fp_) != n ||
+        fseeko(fp_, 0, SEEK_END) != 0) {
+        ok_ = false;
+    }
+}
+
+// ---------------Binary Table Export---------------------
+static const char TABLE_MAGIC[8] = {'P','C','T','A','B','L','E','\0'};
+static const uint32_t TABLE_VERSION = 1;
+static const size_t TABLE_HEADER_SIZE = 32;
+static const size_t TABLE_NAME_SIZE = 16;
+static const size_t TABLE_FIELD_SIZE = 24;
+
+struct BinaryField {
+    const char* name;
+    uint16_t offset;
+    uint16_t width;
+};
+
+// 逐条写出定长记录并累计 checksum（记录长度为 8 的倍数，按 64 位字做 FNV-1a，与规则快照一致）
+class RecordSink {
+public:
+    RecordSink(BufferedWriter& out, size_t record_size) : out_(out), record_size_(record_size) {}
+
+    void add(const unsigned char* rec) {
+        checksum_ = fnv1a64_words(rec, record_size_, checksum_);
+        out_.write(rec, record_size_);
+        count_++;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t checksum() const { return checksum_; }
+
+private:
+    BufferedWriter& out_;
+    size_t record_size_;
+    uint64_t count_ = 0;
+    uint64_t checksum_ = FNV1A64_OFFSET;
+};
+
+// 写文件头与 schema，调用 produce(sink) 流式写出记录，最后回填条数与 checksum
+static bool export_binary_table(
+    const string& output_file,
+    const char* func,
+    const char* table_name,
+    const BinaryField* fields,
+    size_t n_fields,
+    size_t record_size,
+    const function<void(RecordSink&)>& produce
+) {
+    auto t0 = chrono::steady_clock::now();
+    BufferedWriter out;
+    if (!out.open(output_file)) {
+        cerr << "[ERROR] Failed to open output file: " << output_file << endl;
+        return false;
+    }
+
+    unsigned char hdr[TABLE_HEADER_SIZE];
+    memset(hdr, 0, sizeof(hdr));
+    memcpy(hdr, TABLE_MAGIC, 8);
+    put_u32(hdr + 8, TABLE_VERSION);
+    put_u32(hdr + 12, static_cast<uint32_t>(record_size));
+    out.write(hdr, sizeof(hdr));
+
+    unsigned char schema[TABLE_NAME_SIZE + 8];
+    memset(schema, 0, sizeof(schema));
+    strncpy(reinterpret_cast<char*>(schema), table_name, TABLE_NAME_SIZE);
+    put_u32(schema + TABLE_NAME_SIZE, static_cast<uint32_t>(n_fields));
+    out.write(schema, sizeof(schema));
+    for (size_t i = 0; i < n_fields; ++i) {
+        unsigned char f[TABLE_FIELD_SIZE];
+        memset(f, 0, sizeof(f));
+        strncpy(reinterpret_cast<char*>(f), fields[i].name, TABLE_NAME_SIZE);
+        put_u16(f + 16, fields[i].offset);
+        put_u16(f + 18, fields[i].width);
+        out.write(f, sizeof(f));
+    }
+
+    RecordSink sink(out, record_size);
+    produce(sink);
+
+    unsigned char tail[16];
+    put_u64(tail, sink.count());
+    put_u64(tail + 8, sink.checksum());
+    out.patch(16, tail, sizeof(tail));
+    uint64_t bytes = out.position();
+    if (!out.close()) {
+        cerr << "[ERROR] Failed to write output file: " << output_file << endl;
+        return false;
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    cout << "[" << func << "] Wrote " << sink.count() << " records to: " << output_file << " ("
+         << bytes / 1024 << " KB, " << fixed << setprecision(1) << ms << " ms)" << endl;
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+    return true;
+}
+
+bool export_IP_table_binary(const std::vector<IP_Table_Entry>& final_ip_table, const std::string& output_file) {
+    static const BinaryField fields[] = {
+        {"Src_IP_lo", 0, 4}, {"Src_IP_hi", 4, 4}, {"Dst_IP_lo", 8, 4}, {"Dst_IP_hi", 12, 4},
+        {"Proto", 16, 1}, {"Flags", 17, 1},
+        {"Src_ANY_LRMID", 18, 2}, {"Dst_ANY_LRMID", 20, 2}, {"No_ANY_LRMID", 22, 2}
+    };
+    return export_binary_table(output_file, "export_IP_table_binary", "IP_table", fields,
+                               sizeof(fields) / sizeof(fields[0]), 24, [&](RecordSink& sink) {
+        unsigned char rec[24];
+        for (const auto& e : final_ip_table) {
+            put_u32(rec, e.Src_IP_lo);
+            put_u32(rec + 4, e.Src_IP_hi);
+            put_u32(rec + 8, e.Dst_IP_lo);
+            put_u32(rec + 12, e.Dst_IP_hi);
+            rec[16] = e.Proto;
+            rec[17] = (unsigned char)((e.Src_ANY_REV_Flag ? 1 : 0) | (e.Dst_ANY_REV_Flag ? 2 : 0) |
+                                      (e.No_ANY_REV_Flag ? 4 : 0) | (e.drop_flag ? 8 : 0));
+            put_u16(rec + 18, e.Src_ANY_LRMID);
+            put_u16(rec + 20, e.Dst_ANY_LRMID);
+            put_u16(rec + 22, e.No_ANY_LRMID);
+            sink.add(rec);
+        }
+    });
+}
+
+bool export_LRME_entries_binary(const std::vector<LRME_Entry>& LRME_Entries, const std::string& output_file) {
+    static const BinaryField fields[] = {
+        {"LRMID", 0, 4}, {"ANY_Flag", 4, 1}, {"SrcPAI", 6, 2}, {"DstPAI", 8, 2},
+        {"Src_32bitmap", 12, 4}, {"Dst_32bitmap", 16, 4}
+    };
+    return export_binary_table(output_file, "export_LRME_entries_binary", "LRME_table", fields,
+                               sizeof(fields) / sizeof(fields[0]), 24, [&](RecordSink& sink) {
+        unsigned char rec[24];
+        memset(rec, 0, sizeof(rec));
+        for (const auto& e : LRME_Entries) {
+            put_u32(rec, e.LRMID);
+            rec[4] = static_cast<unsigned char>(e.ANY_Flag);
+            put_u16(rec + 6, e.SrcPAI);
+            put_u16(rec + 8, e.DstPAI);
+            put_u32(rec + 12, e.Src_32bitmap);
+            put_u32(rec + 16, e.Dst_32bitmap);
+            sink.add(rec);
+        }
+    });
+}
+
+bool export_metainfo_binary(const MergedItemTable& metainfo, const std::string& output_file) {
+    static const BinaryField fields[] = {
+        {"LRMID", 0, 4}, {"Src_Port_lo", 4, 2}, {"Src_Port_hi", 6, 2},
+        {"Dst_Port_lo", 8, 2}, {"Dst_Port_hi", 10, 2}, {"action", 12, 2}
+    };
+    return export_binary_table(output_file, "export_metainfo_binary", "metainfo", fields,
+                               sizeof(fields) / sizeof(fields[0]), 16, [&](RecordSink& sink) {
+        unsigned char rec[16];
+        memset(rec, 0, sizeof(rec));
+        for (const auto& entry : metainfo) {
+            for (const auto& item : entry.second) {
+                put_u32(rec, entry.first);
+                put_u16(rec + 4, static_cast<uint16_t>(item.Src_Port_lo));
+                put_u16(rec + 6, static_cast<uint16_t>(item.Src_Port_hi));
+                put_u16(rec + 8, static_cast<uint16_t>(item.Dst_Port_lo));
+                put_u16(rec + 10, static_cast<uint16_t>(item.Dst_Port_hi));
+                put_u16(rec + 12, item.action);
+                sink.add(rec);
+            }
+        }
+    });
+}
+
+bool export_TCAM_table_binary(const std::vector<TCAM_Entry>& tcam_entries, const std::string& output_file) {
+    static const BinaryField fields[] = {
+        {"Src_IP_lo", 0, 4}, {"Src_IP_hi", 4, 4}, {"Dst_IP_lo", 8, 4}, {"Dst_IP_hi", 12, 4},
+        {"Src_Port_prefix", 16, 2}, {"Src_Port_mask", 18, 2}, {"Dst_Port_prefix", 20, 2}, {"Dst_Port_mask", 22, 2},
+        {"Proto", 24, 1}, {"action", 26, 2}, {"rule_id", 28, 4}
+    };
+    return export_binary_table(output_file, "export_TCAM_table_binary", "TCAM_table", fields,
+                               sizeof(fields) / sizeof(fields[0]), 32, [&](RecordSink& sink) {
+        unsigned char rec[32];
+        memset(rec, 0, sizeof(rec));
+        for (const auto& e : tcam_entries) {
+            put_u32(rec, e.Src_IP_lo);
+            put_u32(rec + 4, e.Src_IP_hi);
+            put_u32(rec + 8, e.Dst_IP_lo);
+            put_u32(rec + 12, e.Dst_IP_hi);
+            put_u16(rec + 16, e.Src_Port_prefix);
+            put_u16(rec + 18, e.Src_Port_mask);
+            put_u16(rec + 20, e.Dst_Port_prefix);
+            put_u16(rec + 22, e.Dst_Port_mask);
+            rec[24] = e.Proto;
+            put_u16(rec + 26, e.action);
+            put_u32(rec + 28, e.rule_id);
+            sink.add(rec);
+        }
+    });
+}
+
+// ---------------P4Runtime Export---------------------
+struct P4Field {
+    const char* name;
+    unsigned bits;
+    bool ternary;       // false 为 exact
+};
+
+struct P4Param {
+    const char* name;
+    unsigned bits;
+};
+
+struct P4TableSchema {
+    const char* name;
+    const P4Field* fields;
+    size_t n_fields;
+    const char* action;
+    const P4Param* params;
+    size_t n_params;
+};
+
+static const P4Field IP_TABLE_FIELDS[] = {
+    {"hdr.ipv4.srcAddr", 32, true}, {"hdr.ipv4.dstAddr", 32, true}, {"hdr.ipv4.protocol", 8, true}
+};
+static const P4Param IP_TABLE_PARAMS[] = {
+    {"src_any_lrmid", 16}, {"src_any_rev", 1}, {"dst_any_lrmid", 16}, {"dst_any_rev", 1},
+    {"no_any_lrmid", 16}, {"no_any_rev", 1}, {"drop", 1}
+};
+static const P4Field LRME_TABLE_FIELDS[] = {
+    {"meta.lrmid", 16, false}, {"meta.any_flag", 2, false}, {"meta.src_pai", 16, false}, {"meta.dst_pai", 16, false}
+};
+static const P4Param LRME_TABLE_PARAMS[] = {
+    {"src_bitmap", 32}, {"dst_bitmap", 32}
+};
+static const P4Field TCAM_TABLE_FIELDS[] = {
+    {"hdr.ipv4.srcAddr", 32, true}, {"hdr.ipv4.dstAddr", 32, true},
+    {"meta.src_port", 16, true}, {"meta.dst_port", 16, true}, {"hdr.ipv4.protocol", 8, true}
+};
+static const P4Param TCAM_TABLE_PARAMS[] = {
+    {"action", 16}, {"rule_id", 32}
+};
+
+// 下标 + 1 即 action_id；ip_table 按层展开为 P4_IP_TABLE_LAYERS 张表，见 p4_schema
+static const P4TableSchema P4_TABLES[] = {
+    {"PortCatcherIngress.ip_table", IP_TABLE_FIELDS, 3, "PortCatcherIngress.set_lrmids", IP_TABLE_PARAMS, 7},
+    {"PortCatcherIngress.lrme_table", LRME_TABLE_FIELDS, 4, "PortCatcherIngress.set_bitmaps", LRME_TABLE_PARAMS, 2},
+    {"PortCatcherIngress.tcam_table", TCAM_TABLE_FIELDS, 5, "PortCatcherIngress.set_rule", TCAM_TABLE_PARAMS, 2}
+};
+static const size_t P4_MAX_FIELDS = 5;
+static const size_t P4_MAX_PARAMS = 7;
+
+// table 下标：[0, P4_IP_TABLE_LAYERS) 为 ip_table_<层>，其后为 lrme_table、tcam_table；下标 + 1 即 table_id
+static const size_t P4_IP_TABLE_LAYERS = 16;
+static const size_t P4_LRME_TABLE = P4_IP_TABLE_LAYERS;
+static const size_t P4_TCAM_TABLE = P4_IP_TABLE_LAYERS + 1;
+static const size_t P4_TABLE_COUNT = P4_IP_TABLE_LAYERS + 2;
+
+static size_t p4_schema_index(size_t table) {
+    return table < P4_IP_TABLE_LAYERS ? 0 : table - P4_IP_TABLE_LAYERS + 1;
+}
+static const P4TableSchema& p4_schema(size_t table) {
+    return P4_TABLES[p4_schema_index(table)];
+}
+static string p4_table_name(size_t table) {
+    if (table < P4_IP_TABLE_LAYERS) return string(P4_TABLES[0].name) + "_" + to_string(table);
+    return P4_TABLES[p4_schema_index(table)].name;
+}
+
+// 一条待下发表项：present 为 false 的 ternary 字段为通配（省略），priority 为 0 表示无优先级（exact 表）
+struct P4EntryValues {
+    uint64_t value[P4_MAX_FIELDS];
+    uint64_t mask[P4_MAX_FIELDS];
+    bool present[P4_MAX_FIELDS];
+    uint64_t params[P4_MAX_PARAMS];
+    uint32_t priority;
+};
+
+// IP 区间 -> 最少的对齐前缀块 (value, mask)，最多 62 个
+static void ip_range_prefixes(uint32_t lo, uint32_t hi, vector<pair<uint64_t, uint64_t>>& out) {
+    out.clear();
+    uint64_t cur = lo, end = (uint64_t)hi + 1;
+    while (cur < end) {
+        uint64_t size = cur ? (cur & (~cur + 1)) : (1ull << 32);
+        while (cur + size > end) size >>= 1;
+        out.push_back(make_pair(cur, ~(size - 1) & 0xFFFFFFFFull));
+        cur += size;
+    }
+}
+
+static bool ip_entries_overlap(const IP_Table_Entry& a, const IP_Table_Entry& b) {
+    return a.Src_IP_lo <= b.Src_IP_hi && b.Src_IP_lo <= a.Src_IP_hi &&
+           a.Dst_IP_lo <= b.Dst_IP_hi && b.Dst_IP_lo <= a.Dst_IP_hi &&
+           (a.Proto == 0 || b.Proto == 0 || a.Proto == b.Proto);
+}
+
+static void set_match(P4EntryValues& v, size_t i, uint64_t value, uint64_t mask) {
+    v.value[i] = value & mask;
+    v.mask[i] = mask;
+    v.present[i] = mask != 0;
+}
+
+// lrme_table 的 exact key：(LRMID, ANY_Flag, SrcPAI, DstPAI)
+static uint64_t lrme_match_key(const LRME_Entry& e) {
+    return ((uint64_t)e.LRMID << 34) | ((uint64_t)e.ANY_Flag << 32) | ((uint64_t)e.SrcPAI << 16) | e.DstPAI;
+}
+
+// 下发前整理好的表项
+struct P4Prepared {
+    std::vector<size_t> ip_layer;   // 每条 IP 表项所在的层
+    size_t ip_layers = 0;
+    std::vector<LRME_Entry> lrme;   // key 相同的 LRME 表项已按位图 OR 合并为一条
+    size_t lrme_folded = 0;         // 合并掉的表项数
+    size_t lrme_inexact = 0;        // OR 结果比原表项并集更大的单元数
+};
+
+// [begin, end) 为同一单元的表项，merged 为其位图 OR：
+// 每个 src 位上可达的 dst 位都等于整个 dst OR 时，矩形并集恰好等于 OR 出的矩形
+static bool lrme_fold_is_exact(const std::vector<LRME_Entry>& entries, const std::vector<size_t>& order,
+                               size_t begin, size_t end, const LRME_Entry& merged) {
+    if (merged.ANY_Flag != 0) return true;      // 有一侧为 ANY 时只剩一维，OR 即并集
+    for (uint32_t bits = merged.Src_32bitmap; bits; bits &= bits - 1) {
+        uint32_t bit = bits & (~bits + 1);
+        uint32_t dst = 0;
+        for (size_t i = begin; i < end; ++i) {
+            if (entries[order[i]].Src_32bitmap & bit) dst |= entries[order[i]].Dst_32bitmap;
+        }
+        if (dst != merged.Dst_32bitmap) return false;
+    }
+    return true;
+}
+
+// lrme_table 为 exact 表，同一 key 只能有一条表项：把同一单元的表项合并，源 / 目的位图分别取 OR，
+// 交换机命中即表示端口落在 (各表项源位图之并) x (各表项目的位图之并) 中
+static void fold_lrme_entries(const std::vector<LRME_Entry>& entries, P4Prepared& p) {
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return lrme_match_key(entries[a]) < lrme_match_key(entries[b]);
+    });
+    p.lrme.clear();
+    for (size_t i = 0; i < order.size();) {
+        LRME_Entry e = entries[order[i]];
+        uint64_t key = lrme_match_key(e);
+        size_t j = i + 1;
+        for (; j < order.size() && lrme_match_key(entries[order[j]]) == key; ++j) {
+            e.Src_32bitmap |= entries[order[j]].Src_32bitmap;
+            e.Dst_32bitmap |= entries[order[j]].Dst_32bitmap;
+        }
+        if (j - i > 1) {
+            p.lrme_folded += j - i - 1;
+            if (!lrme_fold_is_exact(entries, order, i, j, e)) p.lrme_inexact++;
+        }
+        p.lrme.push_back(e);
+        i = j;
+    }
+}
+
+// IP 阶段是多重匹配：包要用到所有命中 IP 表项的 LRMID，而 ternary 表一次只返回一条。
+// 按表中顺序贪心分层（放入第一个没有与之相交表项的层），同层表项两两不相交，
+// 每层单独成表，包在每层至多命中一条，交换机查完所有层即得到全部命中表项；返回层数
+static size_t assign_ip_layers(const std::vector<IP_Table_Entry>& t, std::vector<size_t>& layer) {
+    std::vector<std::vector<size_t>> members;
+    layer.assign(t.size(), 0);
+    for (size_t i = 0; i < t.size(); ++i) {
+        size_t l = 0;
+        for (; l < members.size(); ++l) {
+            bool overlap = false;
+            for (size_t j : members[l]) {
+                if (ip_entries_overlap(t[i], t[j])) {
+                    overlap = true;
+                    break;
+                }
+            }
+            if (!overlap) break;
+        }
+        if (l == members.size()) members.emplace_back();
+        members[l].push_back(i);
+        layer[i] = l;
+    }
+    return members.size();
+}
+
+// 依次给出各表的每条表项；IP 区间不是前缀块的表项拆成源 / 目的前缀的交叉乘积，priority 相同
+static void for_each_p4_entry(
+    const P4RuntimeTables& tables,
+    const P4Prepared& prep,
+    const function<void(size_t table, const P4EntryValues&)>& emit
+) {
+    P4EntryValues v;
+    vector<pair<uint64_t, uint64_t>> src, dst;
+    if (tables.ip_table) {
+        const auto& t = *tables.ip_table;
+        for (size_t i = 0; i < t.size(); ++i) {
+            const IP_Table_Entry& e = t[i];
+            set_match(v, 2, e.Proto, e.Proto == 0 ? 0 : 0xFF);
+            v.params[0] = e.Src_ANY_LRMID;
+            v.params[1] = e.Src_ANY_REV_Flag;
+            v.params[2] = e.Dst_ANY_LRMID;
+            v.params[3] = e.Dst_ANY_REV_Flag;
+            v.params[4] = e.No_ANY_LRMID;
+            v.params[5] = e.No_ANY_REV_Flag;
+            v.params[6] = e.drop_flag;
+            v.priority = static_cast<uint32_t>(t.size() - i);
+            ip_range_prefixes(e.Src_IP_lo, e.Src_IP_hi, src);
+            ip_range_prefixes(e.Dst_IP_lo, e.Dst_IP_hi, dst);
+            for (const auto& sp : src) {
+                for (const auto& dp : dst) {
+                    set_match(v, 0, sp.first, sp.second);
+                    set_match(v, 1, dp.first, dp.second);
+                    emit(prep.ip_layer[i], v);
+                }
+            }
+        }
+    }
+    if (tables.lrme_entries) {
+        for (const auto& e : prep.lrme) {
+            v.value[0] = e.LRMID;
+            v.value[1] = e.ANY_Flag;
+            v.value[2] = e.SrcPAI;
+            v.value[3] = e.DstPAI;
+            for (size_t i = 0; i < 4; ++i) v.present[i] = true;
+            v.params[0] = e.Src_32bitmap;
+            v.params[1] = e.Dst_32bitmap;
+            v.priority = 0;
+            emit(P4_LRME_TABLE, v);
+        }
+    }
+    if (tables.tcam_entries) {
+        const auto& t = *tables.tcam_entries;
+        for (size_t i = 0; i < t.size(); ++i) {
+            const TCAM_Entry& e = t[i];
+            set_match(v, 2, e.Src_Port_prefix, e.Src_Port_mask);
+            set_match(v, 3, e.Dst_Port_prefix, e.Dst_Port_mask);
+            set_match(v, 4, e.Proto, e.Proto == 0 ? 0 : 0xFF);
+            v.params[0] = e.action;
+            v.params[1] = e.rule_id;
+            v.priority = static_cast<uint32_t>(t.size() - i);
+            ip_range_prefixes(e.Src_IP_lo, e.Src_IP_hi, src);
+            ip_range_prefixes(e.Dst_IP_lo, e.Dst_IP_hi, dst);
+            for (const auto& sp : src) {
+                for (const auto& dp : dst) {
+                    set_match(v, 0, sp.first, sp.second);
+                    set_match(v, 1, dp.first, dp.second);
+                    emit(P4_TCAM_TABLE, v);
+                }
+            }
+        }
+    }
+}
+
+// 同一张表中 match key（ternary 表还包括 priority）相同的两条表项无法同时下发（ALREADY_EXISTS）
+static bool check_p4_keys(const P4RuntimeTables& tables, const P4Prepared& prep, const char* func) {
+    typedef std::array<uint64_t, 2 + 2 * P4_MAX_FIELDS> Key;
+    std::vector<Key> keys;
+    for_each_p4_entry(tables, prep, [&](size_t table, const P4EntryValues& v) {
+        const P4TableSchema& s = p4_schema(table);
+        Key k;
+        k.fill(0);
+        k[0] = table;
+        k[1] = v.priority;
+        for (size_t i = 0; i < s.n_fields; ++i) {
+            if (!v.present[i]) continue;
+            k[2 + i] = v.value[i];
+            if (s.fields[i].ternary) k[2 + P4_MAX_FIELDS + i] = v.mask[i];
+        }
+        keys.push_back(k);
+    });
+    std::sort(keys.begin(), keys.end());
+    auto dup = std::adjacent_find(keys.begin(), keys.end());
+    if (dup != keys.end()) {
+        cerr << "[ERROR] " << func << ": duplicate match key in " << p4_table_name((*dup)[0]) << endl;
+        return false;
+    }
+    return true;
+}
+
+// 给 IP 表项分层、合并 lrme_table 并检查表项唯一，失败时不写文件
+static bool prepare_p4_export(const P4RuntimeTables& tables, P4Prepared& prep, const char* func) {
+    if (tables.ip_table) {
+        prep.ip_layers = assign_ip_layers(*tables.ip_table, prep.ip_layer);
+        if (prep.ip_layers > P4_IP_TABLE_LAYERS) {
+            cerr << "[ERROR] " << func << ": overlapping IP entries need " << prep.ip_layers
+                 << " ip_table layers, more than the " << P4_IP_TABLE_LAYERS << " declared" << endl;
+            return false;
+        }
+        cout << "[" << func << "] Spread " << tables.ip_table->size() << " IP entries over "
+             << prep.ip_layers << " non-overlapping ip_table layers" << endl;
+    }
+    if (tables.lrme_entries) {
+        // ip_table 的 LRMID 参数为 16 位，0xFFFF 表示该类别为空
+        for (const auto& e : *tables.lrme_entries) {
+            if (e.LRMID >= 0xFFFF) {
+                cerr << "[ERROR] " << func << ": LRMID " << e.LRMID << " does not fit the 16-bit meta.lrmid" << endl;
+                return false;
+            }
+        }
+        fold_lrme_entries(*tables.lrme_entries, prep);
+        if (prep.lrme_folded) {
+            cout << "[" << func << "] Folded " << prep.lrme_folded << " lrme_table entries into entries with the same key" << endl;
+        }
+        if (prep.lrme_inexact) {
+            cerr << "[WARN] " << func << ": " << prep.lrme_inexact
+                 << " lrme_table entries match more port pairs than the entries folded into them" << endl;
+        }
+    }
+    return check_p4_keys(tables, prep, func);
+}
+
+static bool finish_p4_export(BufferedWriter& out, const string& output_file, const char* func,
+                             size_t entries, chrono::steady_clock::time_point t0) {
+    uint64_t bytes = out.position();
+    if (!out.close()) {
+        cerr << "[ERROR] Failed to write output file: " << output_file << endl;
+        return false;
+    }
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+    cout << "[" << func << "] Wrote " << entries << " table entries to: " << output_file << " ("
+         << bytes / 1024 << " KB, " << fixed << setprecision(1) << ms << " ms)" << endl;
+    cout.unsetf(ios::fixed);
+    cout << setprecision(6);
+    return true;
+}
+
+bool export_p4runtime_json(const P4RuntimeTables& tables, const std::string& output_file) {
+    auto t0 = chrono::steady_clock::now();
+    P4Prepared prep;
+    if (!prepare_p4_export(tables, prep, "export_p4runtime_json")) return false;
+    BufferedWriter out;
+    if (!out.open(output_file)) {
+        cerr << "[ERROR] Failed to open output file: " << output_file << endl;
+        return false;
+    }
+
+    vector<string> names(P4_TABLE_COUNT);
+    for (size_t t = 0; t < P4_TABLE_COUNT; ++t) names[t] = p4_table_name(t);
+
+    out.put("{\n  \"target\": \"bmv2\",\n  \"table_entries\": [");
+    size_t entries = 0;
+    for_each_p4_entry(tables, prep, [&](size_t table, const P4EntryValues& v) {
+        const P4TableSchema& s = p4_schema(table);
+        out.put(entries++ ? ",\n    {" : "\n    {");
+        out.put("\"table\": \"");
+        out.put(names[table]);
+        out.put("\", \"match\": {");
+        bool first = true;
+        for (size_t i = 0; i < s.n_fields; ++i) {
+            if (!v.present[i]) continue;
+            out.put(first ? "\"" : ", \"");
+            first = false;
+            out.put(s.fields[i].name);
+            out.put("\": ");
+            if (s.fields[i].ternary) {
+                out.put('[');
+                out.put_uint(v.value[i]);
+                out.put(", ");
+                out.put_uint(v.mask[i]);
+                out.put(']');
+            } else {
+                out.put_uint(v.value[i]);
+            }
+        }
+        out.put('}');
+        if (v.priority) {
+            out.put(", \"priority\": ");
+            out.put_uint(v.priority);
+        }
+        out.put(", \"action_name\": \"");
+        out.put(s.action);
+        out.put("\", \"action_params\": {");
+        for (size_t i = 0; i < s.n_params; ++i) {
+            out.put(i ? ", \"" : "\"");
+            out.put(s.params[i].name);
+            out.put("\": ");
+            out.put_uint(v.params[i]);
+        }
+        out.put("}}");
+    });
+    out.put("\n  ]\n}\n");
+    return finish_p4_export(out, output_file, "export_p4runtime_json", entries, t0);
+}
+
+// P4Runtime 字节串：最短大端编码（至少 1 字节），按 protobuf 文本格式转义
+static void put_bytestring(BufferedWriter& out, uint64_t v) {
+    unsigned n = 1;
+    while (n < 8 && (v >> (8 * n)) != 0) n++;
+    out.put('"');
+    for (unsigned i = n; i-- > 0;) {
+        out.put("\\x");
+        out.put_hex((v >> (8 * i)) & 0xFF, 2);
+    }
+    out.put('"');
+}
+
+bool export_p4runtime_text(const P4RuntimeTables& tables, const std::string& output_file) {
+    auto t0 = chrono::steady_clock::now();
+    P4Prepared prep;
+    if (!prepare_p4_export(tables, prep, "export_p4runtime_text")) return false;
+    BufferedWriter out;
+    if (!out.open(output_file)) {
+        cerr << "[ERROR] Failed to open output file: " << output_file << endl;
+        return false;
+    }
+
+    // 文件头注释：id 与名字的对应关系
+    out.put("# P4Runtime WriteRequest (protobuf text format) generated by PortCatcher\n");
+    for (size_t t = 0; t < P4_TABLE_COUNT; ++t) {
+        const P4TableSchema& s = p4_schema(t);
+        out.put("# table_id ");
+        out.put_uint(t + 1);
+        out.put(" = ");
+        out.put(p4_table_name(t));
+        out.put(" -> action_id ");
+        out.put_uint(p4_schema_index(t) + 1);
+        out.put("\n");
+        for (size_t i = 0; i < s.n_fields; ++i) {
+            out.put("#   field_id ");
+            out.put_uint(i + 1);
+            out.put(" = ");
+            out.put(s.fields[i].name);
+            out.put(" (");
+            out.put_uint(s.fields[i].bits);
+            out.put(s.fields[i].ternary ? " bit, ternary)\n" : " bit, exact)\n");
+        }
+    }
+    for (size_t t = 0; t < sizeof(P4_TABLES) / sizeof(P4_TABLES[0]); ++t) {
+        const P4TableSchema& s = P4_TABLES[t];
+        out.put("# action_id ");
+        out.put_uint(t + 1);
+        out.put(" = ");
+        out.put(s.action);
+        out.put("\n");
+        for (size_t i = 0; i < s.n_params; ++i) {
+            out.put("#   param_id ");
+            out.put_uint(i + 1);
+            out.put(" = ");
+            out.put(s.params[i].name);
+            out.put(" (");
+            out.put_uint(s.params[i].bits);
+            out.put(" bit)\n");
+        }
+    }
+
+    size_t entries = 0;
+    for_each_p4_entry(tables, prep, [&](size_t table, const P4EntryValues& v) {
+        const P4TableSchema& s = p4_schema(table);
+        entries++;
+        out.put("updates {\n  type: INSERT\n  entity {\n    table_entry {\n      table_id: ");
+        out.put_uint(table + 1);
+        out.put("\n");
+        for (size_t i = 0; i < s.n_fields; ++i) {
+            if (!v.present[i]) continue;
+            out.put("      match {\n        field_id: ");
+            out.put_uint(i + 1);
+            if (s.fields[i].ternary) {
+                out.put("\n        ternary {\n          value: ");
+                put_bytestring(out, v.value[i]);
+                out.put("\n          mask: ");
+                put_bytestring(out, v.mask[i]);
+                out.put("\n        }\n      }\n");
+            } else {
+                out.put("\n        exact {\n          value: ");
+                put_bytestring(out, v.value[i]);
+                out.put("\n        }\n      }\n");
+            }
+        }
+        out.put("      action {\n        action {\n          action_id: ");
+        out.put_uint(p4_schema_index(table) + 1);
+        out.put("\n");
+        for (size_t i = 0; i < s.n_params; ++i) {
+            out.put("          params {\n            param_id: ");
+            out.put_uint(i + 1);
+            out.put("\n            value: ");
+            put_bytestring(out, v.params[i]);
+            out.put("\n          }\n");
+        }
+        out.put("        }\n      }\n");
+        if (v.priority) {
+            out.put("      priority: ");
+            out.put_uint(v.priority);
+            out.put("\n");
+        }
+        out.put("    }\n  }\n}\n");
+    });
+    return finish_p4_export(out, output_file, "export_p4runtime_text", entries, t0);
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+
+// ---------------Buffered Writer---------------------
+// 大块缓冲的顺序文件写入：数据先拷入缓冲区，满了才整块 fwrite（FILE 自身的缓冲关闭），
+// 数字直接转成十进制 / 十六进制字符，不经过 ostringstream
+class BufferedWriter {
+public:
+    explicit BufferedWriter(size_t buffer_bytes = 1u << 20);
+    ~BufferedWriter();
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    bool open(const std::string& file);
+    bool close();                                 // 写出剩余数据并关闭，出现过任何写错误时返回 false
+
+    void write(const void* data, size_t n);
+    void put(char c) {
+        if (len_ == buf_.size()) flush();
+        buf_[len_++] = c;
+    }
+    void put(const char* s) { write(s, strlen(s)); }
+    void put(const std::string& s) { write(s.data(), s.size()); }
+    void put_uint(uint64_t v);
+    void put_hex(uint64_t v, unsigned digits);    // 固定位数小写十六进制，不带 0x
+
+    // 覆盖已写出的 [offset, offset + n)，用于写完数据后回填文件头
+    void patch(uint64_t offset, const void* data, size_t n);
+
+    uint64_t position() const { return written_ + len_; }
+    bool ok() const { return ok_; }
+
+private:
+    void flush();
+
+    FILE* fp_ = nullptr;
+    std::vector<char> buf_;
+    size_t len_ = 0;
+    uint64_t written_ = 0;
+    bool ok_ = false;
+};
+
+// ---------------Binary Table Export---------------------
+// 与规则快照相同的 32 字节文件头，magic 为 "PCTABLE\0"：
+//   magic[8], u32 version, u32 record_size, u64 count, u64 checksum
+// 其后是 schema：table_name[16], u32 field_count, u32 reserved，
+//   每个字段 name[16], u16 offset, u16 width（字节），u32 reserved（24 字节）
+// 再之后是 count 条定长记录（小端，长度为 8 的倍数），checksum 与快照相同（记录区按 64 位字做 FNV-1a）。
+// 记录布局：
+//   IP     (24 B) : Src_IP_lo, Src_IP_hi, Dst_IP_lo, Dst_IP_hi (u32), Proto (u8),
+//                   Flags (u8：bit0-2 Src/Dst/No ANY REV，bit3 drop), Src/Dst/No ANY LRMID (u16)
+//   LRME   (24 B) : LRMID (u32), ANY_Flag (u8), pad, SrcPAI, DstPAI (u16), pad, Src/Dst bitmap (u32)
+//   metainfo (16 B): LRMID (u32), Src_lo, Src_hi, Dst_lo, Dst_hi, action (u16), pad
+//   TCAM   (32 B) : Src/Dst IP lo/hi (u32), Src/Dst Port prefix/mask (u16), Proto (u8), pad, action (u16), rule_id (u32)
+bool export_IP_table_binary(const std::vector<IP_Table_Entry>& final_ip_table, const std::string& output_file);
+bool export_LRME_entries_binary(const std::vector<LRME_Entry>& LRME_Entries, const std::string& output_file);
+bool export_metainfo_binary(const MergedItemTable& metainfo, const std::string& output_file);
+bool export_TCAM_table_binary(const std::vector<TCAM_Entry>& tcam_entries, const std::string& output_file);
+
+// ---------------P4Runtime Export---------------------
+// 把生成的表写成交换机控制面可直接下发的表项，表 / 字段 / 动作名固定为：
+//   PortCatcherIngress.ip_table_<k> (k = 0..15)
+//                                 : hdr.ipv4.srcAddr, hdr.ipv4.dstAddr, hdr.ipv4.protocol (ternary)
+//                                   -> set_lrmids(src_any_lrmid, src_any_rev, dst_any_lrmid, dst_any_rev,
+//                                                 no_any_lrmid, no_any_rev, drop)
+//                                   LRMID 参数为 16 位，0xFFFF 表示该类别为空。IP 阶段是多重匹配（包要用到所有
+//                                   命中表项的 LRMID），因此按表中顺序把表项贪心分层，同层表项两两不相交，
+//                                   交换机查完所有层、对每层给出的 LRMID 分别查 lrme_table；所需层数超过 16 时报错
+//   PortCatcherIngress.lrme_table : meta.lrmid (16 bit), meta.any_flag, meta.src_pai, meta.dst_pai (exact)
+//                                   -> set_bitmaps(src_bitmap, dst_bitmap)
+//                                   key 相同的 LRME 表项合并为一条，源 / 目的位图分别取 OR；
+//                                   有一侧为 ANY 或各表项的矩形之并仍是矩形时与原表项等价，否则会多命中并打印 [WARN]
+//   PortCatcherIngress.tcam_table : hdr.ipv4.srcAddr, hdr.ipv4.dstAddr, meta.src_port, meta.dst_port,
+//                                   hdr.ipv4.protocol (ternary) -> set_rule(action, rule_id)
+// ternary 表的 priority 按表中顺序递减（第一条最大），掩码为 0 的字段按通配省略；
+// IP 区间不是前缀块的表项拆成源 / 目的前缀块的交叉乘积，各条 priority 与原表项相同。
+// table_id 依次为 ip_table_0..15、lrme_table、tcam_table，action_id 依次为 set_lrmids、set_bitmaps、set_rule。
+// 任何一张表为 nullptr 时不输出该表；同一张表内出现 match key（及 priority）相同的表项时打印 [ERROR]，不写文件并返回 false
+struct P4RuntimeTables {
+    const std::vector<IP_Table_Entry>* ip_table = nullptr;
+    const std::vector<LRME_Entry>* lrme_entries = nullptr;
+    const std::vector<TCAM_Entry>* tcam_entries = nullptr;
+};
+
+// simple_switch_grpc（p4runtime 工具脚本）使用的 runtime JSON：
+//   {"target": "bmv2", "table_entries": [{"table", "match", "priority", "action_name", "action_params"}, ...]}
+// ternary 匹配为 [value, mask]，exact 匹配为整数
+bool export_p4runtime_json(const P4RuntimeTables& tables, const std::string& output_file);
+
+// P4Runtime WriteRequest 的 protobuf 文本格式（updates { type: INSERT entity { table_entry {...} } }），
+// 字节串为最短大端编码；table_id / field_id / action_id / param_id 按上面的顺序从 1 编号，
+// 对应关系写在文件开头的注释中，需与交换机程序的 P4Info 一致
+bool export_p4runtime_text(const P4RuntimeTables& tables, const std::string& output_file);
@@ -0,0 +1,165 @@
+/** *************************************************************/
+// @Name: Trace.cpp
+// @Function: Synthetic 5-tuple trace generation and binary trace files
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Classifier.hpp"
+#include "Trace.hpp"
+#include "BinaryIO.hpp"
+
+using namespace std;
+
+// 规则范围内均匀取点
+static Tuple5 point_in_rule(const Rule5D& r, std::mt19937_64& rng) {
+    auto pick = [&](uint32_t lo, uint32_t hi) -> uint32_t {
+        uint64_t span = (uint64_t)hi - lo + 1;
+        return lo + static_cast<uint32_t>(rng() % span);
+    };
+    Tuple5 t;
+    t.src_ip = pick(r.range[0][0], r.range[0][1]);
+    t.dst_ip = pick(r.range[1][0], r.range[1][1]);
+    t.src_port = static_cast<uint16_t>(pick(r.range[2][0], r.range[2][1]));
+    t.dst_port = static_cast<uint16_t>(pick(r.range[3][0], r.range[3][1]));
+    t.proto = static_cast<uint8_t>(pick(r.range[4][0], std::min<uint32_t>(r.range[4][1], 0xFF)));
+    return t;
+}
+
+std::vector<Tuple5> generate_trace(
+    const std::vector<Rule5D>& rules,
+    const TraceConfig& cfg
+) {
+    std::vector<Tuple5> trace;
+    trace.reserve(cfg.packets);
+    std::mt19937_64 rng(cfg.seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+
+    // Zipf：规则先随机打乱得到排名，再按 1/rank^s 的累积分布抽样
+    std::vector<uint32_t> rank(rules.size());
+    std::vector<double> cdf;
+    for (size_t i = 0; i < rank.size(); ++i) rank[i] = static_cast<uint32_t>(i);
+    std::shuffle(rank.begin(), rank.end(), rng);
+    if (cfg.zipf_s > 0 && !rules.empty()) {
+        cdf.resize(rules.size());
+        double sum = 0;
+        for (size_t k = 0; k < rules.size(); ++k) {
+            sum += 1.0 / std::pow((double)(k + 1), cfg.zipf_s);
+            cdf[k] = sum;
+        }
+        for (auto& c : cdf) c /= sum;
+    }
+
+    size_t window = std::max<size_t>(cfg.locality_window, 1);
+    for (size_t i = 0; i < cfg.packets; ++i) {
+        if (cfg.locality > 0 && !trace.empty() && coin(rng) < cfg.locality) {
+            size_t back = 1 + rng() % std::min(window, trace.size());
+            trace.push_back(trace[trace.size() - back]);
+            continue;
+        }
+        if (!rules.empty() && coin(rng) < cfg.hit_ratio) {
+            size_t k;
+            if (cdf.empty()) {
+                k = rng() % rules.size();
+            } else {
+                k = std::lower_bound(cdf.begin(), cdf.end(), coin(rng)) - cdf.begin();
+                if (k >= cdf.size()) k = cdf.size() - 1;
+            }
+            trace.push_back(point_in_rule(rules[rank[k]], rng));
+        } else {
+            Tuple5 t;
+            uint64_t a = rng(), b = rng();
+            t.src_ip = static_cast<uint32_t>(a);
+            t.dst_ip = static_cast<uint32_t>(a >> 32);
+            t.src_port = static_cast<uint16_t>(b);
+            t.dst_port = static_cast<uint16_t>(b >> 16);
+            t.proto = static_cast<uint8_t>(b >> 32);
+            trace.push_back(t);
+        }
+    }
+    return trace;
+}
+
+// ---------------Binary trace file---------------------
+// Layout (all integers little-endian):
+//   header : magic[8] "PCTRACE\0", u32 version, u32 record_size,
+//            u64 count, u64 checksum                        (32 bytes)
+//   record : u32 src_ip, u32 dst_ip, u16 src_port, u16 dst_port,
+//            u8 proto, u8 pad[3]                            (16 bytes)
+// checksum = FNV-1a over the record area taken as 64-bit LE words.
+static const char TRACE_MAGIC[8] = {'P','C','T','R','A','C','E','\0'};
+static const uint32_t TRACE_VERSION = 1;
+static const size_t TRACE_HEADER_SIZE = 32;
+static const size_t TRACE_RECORD_SIZE = 16;
+
+bool save_trace(const std::vector<Tuple5>& trace, const std::string& file) {
+    vector<unsigned char> body(trace.size() * TRACE_RECORD_SIZE, 0);
+    for (size_t i = 0; i < trace.size(); ++i) {
+        unsigned char *p = body.data() + i * TRACE_RECORD_SIZE;
+        put_u32(p, trace[i].src_ip);
+        put_u32(p + 4, trace[i].dst_ip);
+        put_u16(p + 8, trace[i].src_port);
+        put_u16(p + 10, trace[i].dst_port);
+        p[12] = trace[i].proto;
+    }
+
+    unsigned char hdr[TRACE_HEADER_SIZE];
+    memcpy(hdr, TRACE_MAGIC, 8);
+    put_u32(hdr + 8, TRACE_VERSION);
+    put_u32(hdr + 12, (uint32_t)TRACE_RECORD_SIZE);
+    put_u64(hdr + 16, (uint64_t)trace.size());
+    put_u64(hdr + 24, fnv1a64_words(body.data(), body.size()));
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        fprintf(stderr, "[ERROR] Failed to open trace file: %s\n", file.c_str());
+        return false;
+    }
+    bool ok = fwrite(hdr, 1, sizeof(hdr), fp) == sizeof(hdr) &&
+              fwrite(body.data(), 1, body.size(), fp) == body.size();
+    ok = (fclose(fp) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "[ERROR] Failed to write trace file: %s\n", file.c_str());
+    }
+    return ok;
+}
+
+void load_trace(const std::string& file, std::vector<Tuple5>& trace_out) {
+    std::ifstream ifs(file, std::ios::binary);
+    if (!ifs) {
+        throw std::runtime_error("cannot open trace file: " + file);
+    }
+    std::vector<unsigned char> buf((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    if (buf.size() < TRACE_HEADER_SIZE || memcmp(buf.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+        throw std::runtime_error("not a trace file: " + file);
+    }
+    const unsigned char *hdr = buf.data();
+    if (get_u32(hdr + 8) != TRACE_VERSION || get_u32(hdr + 12) != TRACE_RECORD_SIZE) {
+        throw std::runtime_error("unsupported trace version/record size in " + file);
+    }
+    uint64_t count = get_u64(hdr + 16);
+    uint64_t body_size = buf.size() - TRACE_HEADER_SIZE;
+    if (count > body_size / TRACE_RECORD_SIZE || count * TRACE_RECORD_SIZE != body_size) {
+        throw std::runtime_error("truncated trace: " + file);
+    }
+    const unsigned char *body = hdr + TRACE_HEADER_SIZE;
+    if (fnv1a64_words(body, (size_t)body_size) != get_u64(hdr + 24)) {
+        throw std::runtime_error("trace checksum mismatch: " + file);
+    }
+
+    size_t base = trace_out.size();
+    trace_out.resize(base + (size_t)count);
+    for (size_t i = 0; i < (size_t)count; ++i) {
+        const unsigned char *p = body + i * TRACE_RECORD_SIZE;
+        Tuple5& t = trace_out[base + i];
+        t.src_ip = get_u32(p);
+        t.dst_ip = get_u32(p + 4);
+        t.src_port = get_u16(p + 8);
+        t.dst_port = get_u16(p + 10);
+        t.proto = p[12];
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Loader.hpp"
+#include "Classifier.hpp"
+
+// ---------------Synthetic Trace Generator---------------------
+// 每个包按下面的顺序决定来源：
+//   1) 以 locality 的概率重放最近 locality_window 个包之一（时间局部性）
+//   2) 否则以 hit_ratio 的概率从规则中取点（规则按 Zipf(zipf_s) 选择，
+//      zipf_s = 0 为均匀分布），其余为均匀随机的 5 元组（大多落空）
+struct TraceConfig {
+    size_t   packets = 1000000;
+    double   hit_ratio = 0.9;
+    double   zipf_s = 0.0;
+    double   locality = 0.0;
+    size_t   locality_window = 16;
+    uint32_t seed = 1;
+};
+
+std::vector<Tuple5> generate_trace(
+    const std::vector<Rule5D>& rules,
+    const TraceConfig& cfg
+);
+
+// ---------------Binary Trace File---------------------
+// 与规则快照相同的 32 字节文件头，magic 为 "PCTRACE\0"，每条记录 16 字节
+bool save_trace(const std::vector<Tuple5>& trace, const std::string& file);
+void load_trace(const std::string& file, std::vector<Tuple5>& trace_out);
@@ -0,0 +1,234 @@
+/** *************************************************************/
+// @Name: TupleSpace.cpp
+// @Function: Tuple Space Search classifier with O(1) rule insert / erase
+// @Author: weijzh (weijzh@pcl.ac.cn)
+// @Created: 2026-10-16
+/************************************************************* */
+
+#include <bits/stdc++.h>
+#include <iostream>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "Classifier.hpp"
+#include "TupleSpace.hpp"
+
+using namespace std;
+
+const uint32_t TupleSpaceClassifier::NIL;
+
+static inline uint32_t len_mask(uint32_t len) {
+    return len == 0 ? 0 : (0xFFFFFFFFu << (32 - len));
+}
+
+// IP 范围的掩码长度：与 prefix_length 一致时直接采用，
+// 否则取 lo / hi 的公共前缀长度（保证范围内的地址 key 相同，命中后再核对范围）
+static uint32_t ip_key_len(uint32_t lo, uint32_t hi, int prefix_length) {
+    if (prefix_length >= 0 && prefix_length <= 32) {
+        uint32_t m = len_mask(prefix_length);
+        if ((lo & ~m) == 0 && hi == (lo | ~m)) return static_cast<uint32_t>(prefix_length);
+    }
+    uint32_t diff = lo ^ hi;
+    return diff == 0 ? 32 : static_cast<uint32_t>(__builtin_clz(diff));
+}
+
+TupleSpaceClassifier::Key TupleSpaceClassifier::make_key(
+    const Tuple& tp, uint32_t src, uint32_t dst, uint32_t sport, uint32_t dport, uint32_t proto
+) {
+    Key k;
+    k.ips = ((uint64_t)(src & tp.src_mask) << 32) | (dst & tp.dst_mask);
+    k.rest = ((uint64_t)((tp.exact & 1) ? sport : 0) << 24) |
+             ((uint64_t)((tp.exact & 2) ? dport : 0) << 8) |
+             ((tp.exact & 4) ? proto : 0);
+    return k;
+}
+
+void TupleSpaceClassifier::build(const std::vector<Rule5D>& rules) {
+    tuples_.clear();
+    tuple_index_ = FlatKeyIndex<uint64_t, U64KeyHash>();
+    order_.clear();
+    pool_.clear();
+    free_entries_.clear();
+    buckets_.clear();
+    free_buckets_.clear();
+    slot_of_.clear();
+    live_ = 0;
+    pool_.reserve(rules.size());
+    slot_of_.reserve(rules.size());
+    for (size_t i = 0; i < rules.size(); ++i) insert(static_cast<uint32_t>(i), rules[i]);
+
+    std::cout << "[TupleSpaceClassifier] Built: " << live_ << " rules in " << tuples_.size()
+              << " tuples, " << buckets_.size() << " buckets, " << memory_bytes() / 1024 << " KB" << std::endl;
+}
+
+uint32_t TupleSpaceClassifier::tuple_of(const Rule5D& rule) {
+    uint32_t src_len = ip_key_len(rule.range[0][0], rule.range[0][1], rule.prefix_length[0]);
+    uint32_t dst_len = ip_key_len(rule.range[1][0], rule.range[1][1], rule.prefix_length[1]);
+    uint32_t exact = (rule.range[2][0] == rule.range[2][1] ? 1u : 0u) |
+                     (rule.range[3][0] == rule.range[3][1] ? 2u : 0u) |
+                     (rule.range[4][0] == rule.range[4][1] ? 4u : 0u);
+    uint64_t sig = (src_len << 16) | (dst_len << 8) | exact;
+
+    uint32_t id = tuple_index_.find(sig);
+    if (id != FlatKeyIndex<uint64_t, U64KeyHash>::NOT_FOUND) return id;
+
+    if ((tuple_index_.size() + 1) * 2 > tuple_index_.capacity()) tuple_index_.rehash(tuple_index_.size() * 2 + 1);
+    id = static_cast<uint32_t>(tuples_.size());
+    tuple_index_.find_or_insert(sig, id);
+    Tuple tp;
+    tp.src_len = static_cast<uint8_t>(src_len);
+    tp.dst_len = static_cast<uint8_t>(dst_len);
+    tp.exact = static_cast<uint8_t>(exact);
+    tp.src_mask = len_mask(src_len);
+    tp.dst_mask = len_mask(dst_len);
+    tp.min_id = NIL;
+    tp.count = 0;
+    tuples_.push_back(tp);
+    order_.push_back(id);
+    return id;
+}
+
+void TupleSpaceClassifier::sort_order() {
+    std::sort(order_.begin(), order_.end(), [&](uint32_t a, uint32_t b) {
+        return tuples_[a].min_id < tuples_[b].min_id;
+    });
+}
+
+// 单个元组的 min_id 变化后，在已排序的 order_ 中把它移到正确位置（O(元组数)）
+void TupleSpaceClassifier::reposition(uint32_t tuple) {
+    size_t pos = std::find(order_.begin(), order_.end(), tuple) - order_.begin();
+    uint32_t key = tuples_[tuple].min_id;
+    while (pos > 0 && tuples_[order_[pos - 1]].min_id > key) {
+        order_[pos] = order_[pos - 1];
+        --pos;
+    }
+    while (pos + 1 < order_.size() && tuples_[order_[pos + 1]].min_id < key) {
+        order_[pos] = order_[pos + 1];
+        ++pos;
+    }
+    order_[pos] = tuple;
+}
+
+bool TupleSpaceClassifier::insert(uint32_t rule_id, const Rule5D& rule) {
+    if (rule_id == NIL) return false;
+    if (rule_id < slot_of_.size() && slot_of_[rule_id] != NIL) return false;
+    if (rule_id >= slot_of_.size()) slot_of_.resize(rule_id + 1, NIL);
+
+    uint32_t t = tuple_of(rule);
+    Tuple& tp = tuples_[t];
+
+    Entry e;
+    for (int d = 0; d < 5; ++d) {
+        e.lo[d] = rule.range[d][0];
+        e.hi[d] = rule.range[d][1];
+    }
+    e.hi[4] = std::min<uint32_t>(e.hi[4], 0xFF);
+    e.rule_id = rule_id;
+    e.next = NIL;
+    e.tuple = t;
+    e.action = rule.action;
+
+    uint32_t idx;
+    if (!free_entries_.empty()) {
+        idx = free_entries_.back();
+        free_entries_.pop_back();
+    } else {
+        idx = static_cast<uint32_t>(pool_.size());
+        pool_.push_back(Entry());
+    }
+
+    // 桶：同 key 的规则链表，按 rule_id 升序
+    Key key = make_key(tp, e.lo[0], e.lo[1], e.lo[2], e.lo[3], e.lo[4]);
+    if ((tp.table.size() + 1) * 2 > tp.table.capacity()) tp.table.rehash(tp.table.size() * 2 + 1);
+    uint32_t fresh = free_buckets_.empty() ? static_cast<uint32_t>(buckets_.size()) : free_buckets_.back();
+    uint32_t b = tp.table.find_or_insert(key, fresh);
+    if (b == fresh) {
+        if (free_buckets_.empty()) buckets_.push_back(NIL);
+        else free_buckets_.pop_back();
+        buckets_[b] = NIL;
+    }
+    e.bucket = b;
+
+    uint32_t* link = &buckets_[b];
+    while (*link != NIL && pool_[*link].rule_id < rule_id) link = &pool_[*link].next;
+    e.next = *link;
+    pool_[idx] = e;
+    *link = idx;
+
+    slot_of_[rule_id] = idx;
+    tp.count++;
+    ++live_;
+    if (rule_id < tp.min_id) {
+        tp.min_id = rule_id;
+        reposition(t);
+    }
+    return true;
+}
+
+bool TupleSpaceClassifier::erase(uint32_t rule_id) {
+    if (rule_id >= slot_of_.size() || slot_of_[rule_id] == NIL) return false;
+    uint32_t idx = slot_of_[rule_id];
+    Entry& e = pool_[idx];
+    Tuple& tp = tuples_[e.tuple];
+
+    uint32_t* link = &buckets_[e.bucket];
+    while (*link != idx) link = &pool_[*link].next;
+    *link = e.next;
+    if (buckets_[e.bucket] == NIL) {
+        tp.table.erase(make_key(tp, e.lo[0], e.lo[1], e.lo[2], e.lo[3], e.lo[4]));
+        free_buckets_.push_back(e.bucket);
+    }
+
+    // min_id 保留为下界；元组清空时移到探测顺序末尾
+    if (--tp.count == 0) {
+        tp.min_id = NIL;
+        reposition(e.tuple);
+    }
+    free_entries_.push_back(idx);
+    slot_of_[rule_id] = NIL;
+    --live_;
+    return true;
+}
+
+void TupleSpaceClassifier::compact_order() {
+    for (auto& tp : tuples_) tp.min_id = NIL;
+    for (uint32_t id = 0; id < slot_of_.size(); ++id) {
+        if (slot_of_[id] == NIL) continue;
+        Tuple& tp = tuples_[pool_[slot_of_[id]].tuple];
+        tp.min_id = std::min(tp.min_id, id);
+    }
+    sort_order();
+}
+
+MatchResult TupleSpaceClassifier::classify(const Tuple5& t) const {
+    MatchResult best = { NO_MATCH_RULE, 0 };
+    const uint32_t v[5] = { t.src_ip, t.dst_ip, t.src_port, t.dst_port, t.proto };
+    for (uint32_t ti : order_) {
+        const Tuple& tp = tuples_[ti];
+        if (tp.min_id >= best.rule_id) break;   // 后面的元组都不可能更优
+        uint32_t b = tp.table.find(make_key(tp, t.src_ip, t.dst_ip, t.src_port, t.dst_port, t.proto));
+        if (b == FlatKeyIndex<Key, KeyHash>::NOT_FOUND) continue;
+        for (uint32_t k = buckets_[b]; k != NIL; k = pool_[k].next) {
+            const Entry& e = pool_[k];
+            if (e.rule_id >= best.rule_id) break;
+            bool hit = true;
+            for (int d = 0; d < 5 && hit; ++d) hit = v[d] >= e.lo[d] && v[d] <= e.hi[d];
+            if (hit) {
+                best.rule_id = e.rule_id;
+                best.action = e.action;
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+size_t TupleSpaceClassifier::memory_bytes() const {
+    size_t bytes = tuples_.capacity() * sizeof(Tuple) + tuple_index_.memory_bytes() +
+                   order_.capacity() * sizeof(uint32_t) +
+                   pool_.capacity() * sizeof(Entry) +
+                   (free_entries_.capacity() + buckets_.capacity() + free_buckets_.capacity() +
+                    slot_of_.capacity()) * sizeof(uint32_t);
+    for (const auto& tp : tuples_) bytes += tp.table.memory_bytes();
+    return bytes;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vector>
+
+#include "Loader.hpp"
+#include "Function.hpp"
+#include "Classifier.hpp"
+
+// ---------------Tuple Space Search---------------------
+// 按 (源掩码长度, 目的掩码长度, 源端口精确?, 目的端口精确?, 协议精确?) 元组分组，
+// 即 Rule5D::prefix_length 记录的信息；每个元组一张开放寻址哈希表：
+//   key = (src & mask, dst & mask, 精确端口 / 协议值)，值为桶编号，
+//   桶内规则按 rule_id 升序链接，端口范围等非精确字段在命中后逐条核对。
+// 查找按元组的最小 rule_id 升序探测，当前最优 rule_id 不大于元组最小值时提前结束。
+// insert / erase 为均摊 O(1)，适合频繁变化的策略；
+// erase 后元组的最小 rule_id 只作为下界保留（不影响正确性），需要时可 compact_order 重算
+class TupleSpaceClassifier {
+public:
+    void build(const std::vector<Rule5D>& rules);
+
+    // rule_id 越小优先级越高；rule_id 已存在时返回 false
+    bool insert(uint32_t rule_id, const Rule5D& rule);
+    // rule_id 不存在时返回 false
+    bool erase(uint32_t rule_id);
+    // 重新计算各元组的最小 rule_id 并排序探测顺序（O(N)）
+    void compact_order();
+
+    MatchResult classify(const Tuple5& t) const;
+
+    size_t entries() const { return live_; }
+    size_t tuples() const { return tuples_.size(); }
+    size_t memory_bytes() const;
+
+private:
+    static const uint32_t NIL = 0xFFFFFFFFu;
+
+    struct Key {
+        uint64_t ips;    // (src & smask) << 32 | (dst & dmask)
+        uint64_t rest;   // sport << 24 | dport << 8 | proto（非精确字段为 0）
+        bool operator==(const Key& o) const { return ips == o.ips && rest == o.rest; }
+    };
+    struct KeyHash {
+        uint64_t operator()(const Key& k) const { return mix64(k.ips ^ mix64(k.rest)); }
+    };
+
+    struct Tuple {
+        uint8_t  src_len, dst_len;
+        uint8_t  exact;      // bit0 源端口，bit1 目的端口，bit2 协议
+        uint32_t src_mask, dst_mask;
+        uint32_t min_id;     // 元组内最小 rule_id（下界）
+        uint32_t count;
+        FlatKeyIndex<Key, KeyHash> table;   // key -> buckets_ 下标
+    };
+
+    struct Entry {
+        uint32_t lo[5], hi[5];
+        uint32_t rule_id;
+        uint32_t next;       // 同一桶内下一条（rule_id 更大）
+        uint32_t tuple;
+        uint32_t bucket;
+        uint16_t action;
+    };
+
+    static Key make_key(const Tuple& tp, uint32_t src, uint32_t dst, uint32_t sport, uint32_t dport, uint32_t proto);
+    uint32_t tuple_of(const Rule5D& rule);
+    void sort_order();
+    void reposition(uint32_t tuple);
+
+    std::vector<Tuple> tuples_;
+    FlatKeyIndex<uint64_t, U64KeyHash> tuple_index_;   // 元组签名 -> tuples_ 下标
+    std::vector<uint32_t> order_;          // 探测顺序（按 min_id 升序）
+    std::vector<Entry> pool_;
+    std::vector<uint32_t> free_entries_;
+    std::vector<uint32_t> buckets_;        // 桶 -> 链表头
+    std::vector<uint32_t> free_buckets_;
+    std::vector<uint32_t> slot_of_;        // rule_id -> pool_ 下标
+    size_t live_ = 0;
+};